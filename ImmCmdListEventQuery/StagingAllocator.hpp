@@ -0,0 +1,152 @@
+// Pinned host staging memory for copy sources and destinations.
+//
+// Copies to or from pageable memory (stack variables, new[]) go through the
+// driver's internal bounce buffers. StagingAllocator hands out zeMemAllocHost
+// memory instead, from per-thread arenas so the hot path takes no lock and
+// makes no driver call:
+//   - each thread bump-allocates from its own list of pinned blocks
+//   - free() only decrements the live count of the block's arena; once a
+//     thread's arena has no live allocations it rewinds to the first block
+//   - requests larger than a block go straight to zeMemAllocHost
+// Every allocation is preceded by a small header naming its arena, so free()
+// may be called from any thread.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ze_api.h"
+
+class StagingAllocator {
+public:
+  static constexpr size_t kHeaderSize = 64;
+
+  StagingAllocator(ze_context_handle_t context, size_t blockSize = 2 << 20)
+      : context(context), blockSize(blockSize), id(nextId()) {}
+
+  ~StagingAllocator() { release(); }
+
+  // Return every block to the driver. Must run after all staging memory is
+  // freed and before the context is destroyed.
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : arenas)
+      for (void *block : entry.second->blocks)
+        ZE_CHECK(zeMemFree(context, block));
+    arenas.clear();
+    // Threads re-resolve their arena on the next alloc
+    id = nextId();
+  }
+
+  void *alloc(size_t size, size_t alignment = 64) {
+    size_t alignedHeader = std::max(kHeaderSize, alignment);
+    if (size + alignedHeader > blockSize)
+      return allocLarge(size, alignedHeader);
+
+    Arena &arena = local();
+    if (arena.live.load(std::memory_order_acquire) == 0) {
+      arena.block = 0;
+      arena.offset = 0;
+    }
+    size_t start = (arena.offset + alignment - 1) / alignment * alignment;
+    if (arena.blocks.empty() || start + alignedHeader + size > blockSize) {
+      // Move on to the next block, allocating one once all are in use
+      if (!arena.blocks.empty())
+        arena.block++;
+      if (arena.block == arena.blocks.size())
+        arena.blocks.push_back(allocBlock());
+      start = 0;
+    }
+    char *ptr =
+        static_cast<char *>(arena.blocks[arena.block]) + start + alignedHeader;
+    arena.offset = start + alignedHeader + size;
+    arena.live.fetch_add(1, std::memory_order_relaxed);
+    header(ptr)->arena = &arena;
+    return ptr;
+  }
+
+  template <typename T> T *alloc(size_t count = 1) {
+    return static_cast<T *>(alloc(count * sizeof(T), alignof(T)));
+  }
+
+  void free(void *ptr) {
+    Arena *arena = header(ptr)->arena;
+    if (!arena) {
+      ZE_CHECK(zeMemFree(context, header(ptr)->base));
+      return;
+    }
+    arena->live.fetch_sub(1, std::memory_order_release);
+  }
+
+private:
+  struct Arena {
+    std::vector<void *> blocks;
+    size_t block = 0;  // block currently bump-allocated from
+    size_t offset = 0; // next free byte in that block
+    std::atomic<uint64_t> live{0};
+  };
+
+  struct Header {
+    Arena *arena; // nullptr for the large path
+    void *base;   // driver allocation to free on the large path
+  };
+
+  static Header *header(void *ptr) {
+    return reinterpret_cast<Header *>(static_cast<char *>(ptr) -
+                                      sizeof(Header));
+  }
+
+  static uint64_t nextId() {
+    static std::atomic<uint64_t> counter{1};
+    return counter.fetch_add(1);
+  }
+
+  // Arena of the calling thread. The thread_local cache keeps the lookup
+  // lock-free after the first call; the id guards against a new allocator
+  // at the address of a released one.
+  Arena &local() {
+    struct Cache {
+      const StagingAllocator *owner = nullptr;
+      uint64_t id = 0;
+      Arena *arena = nullptr;
+    };
+    thread_local Cache cache;
+    if (cache.owner == this && cache.id == id)
+      return *cache.arena;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &arena = arenas[std::this_thread::get_id()];
+    if (!arena)
+      arena.reset(new Arena);
+    cache = {this, id, arena.get()};
+    return *arena;
+  }
+
+  void *allocBlock() {
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+    void *block = nullptr;
+    ZE_CHECK(zeMemAllocHost(context, &hostDesc, blockSize, 4096, &block));
+    return block;
+  }
+
+  void *allocLarge(size_t size, size_t alignedHeader) {
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+    void *base = nullptr;
+    ZE_CHECK(
+        zeMemAllocHost(context, &hostDesc, size + alignedHeader, 4096, &base));
+    char *ptr = static_cast<char *>(base) + alignedHeader;
+    *header(ptr) = {nullptr, base};
+    return ptr;
+  }
+
+  ze_context_handle_t context;
+  size_t blockSize;
+  uint64_t id;
+  std::mutex mutex;
+  std::unordered_map<std::thread::id, std::unique_ptr<Arena>> arenas;
+};
@@ -13,9 +13,21 @@
 
 #define IMMEDIATE
 #include "common.hpp"
+#include "StagingAllocator.hpp"
 #include "ze_api.h"
 
+// The timestamp is copied into a stack variable, as in the original
+// reproducer. --staging copies into pinned StagingAllocator memory instead,
+// which avoids the driver's bounce buffer and so may change what the event
+// query below observes.
+//
+// Usage: ./driver [--staging]
 int main(int argc, char **argv) {
+  bool useStaging = argc > 1 && !strcmp(argv[1], "--staging");
+  if (argc > 2 || (argc > 1 && !useStaging)) {
+    std::cout << "Usage: " << argv[0] << " [--staging]\n";
+    return 1;
+  }
   setupLevelZero();
   compileKernel("SlowKernel.spv", "myKernel");
 
@@ -67,7 +79,13 @@ int main(int argc, char **argv) {
 
   void *startTime = nullptr;
   void *endTime = nullptr;
-  uint64_t startTimestamp, endTimestamp;
+  uint64_t pageableTimestamp = 0;
+  std::unique_ptr<StagingAllocator> staging;
+  uint64_t *startTimestamp = &pageableTimestamp;
+  if (useStaging) {
+    staging.reset(new StagingAllocator(context));
+    startTimestamp = staging->alloc<uint64_t>();
+  }
   zeMemAllocDevice(context, &deviceMemDesc, sizeof(uint64_t), 1, device,
                    &startTime);
   zeMemAllocDevice(context, &deviceMemDesc, sizeof(uint64_t), 1, device,
@@ -80,7 +98,7 @@ int main(int argc, char **argv) {
   zeCommandListAppendWriteGlobalTimestamp(
       cmdList, (uint64_t *)startTime, timestampRecordEventStart, 0, nullptr);
     zeCommandListAppendBarrier(cmdList, nullptr, 0, nullptr);
-    zeCommandListAppendMemoryCopy(cmdList, &startTimestamp, startTime, sizeof(uint64_t),
+    zeCommandListAppendMemoryCopy(cmdList, startTimestamp, startTime, sizeof(uint64_t),
                                   timestampMemcopyEventStart, 0, nullptr);
     zeCommandListAppendBarrier(cmdList, myEvent, 0, nullptr);
   std::cout << "Launching Kernel" << std::endl;
@@ -109,7 +127,22 @@ int main(int argc, char **argv) {
   //   Status = zeEventQueryStatus(timestampRecordEventStop);
   //   std::cout << "EndEvent Query: " << resultToString(Status) << std::endl;
 
- 
+
+  // The staging memory can only go once the copy into it has completed. The
+  // copy may never complete, which is what this reproducer probes, so wait
+  // a bounded time and leak the memory otherwise.
+  if (staging) {
+    constexpr uint64_t kTimeoutNs = 1000000000;
+    if (zeEventHostSynchronize(timestampMemcopyEventStart, kTimeoutNs) ==
+        ZE_RESULT_SUCCESS) {
+      staging->free(startTimestamp);
+      staging->release();
+    } else {
+      std::cout << "Copy did not complete, leaking the staging memory"
+                << std::endl;
+      staging.release();
+    }
+  }
   cleanupLevelZero();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+// Input initialization for the mxm buffers.
+//
+// Host memset on shared memory pulls every page to the host, only for the
+// kernel to migrate it back. The device modes create the data in place:
+//   fill    - zeCommandListAppendMemoryFill with the same byte as the memset
+//   pattern - fillPattern kernel, a[i] = base + i * stride
+//   random  - fillRandom kernel, counter-based hash of (i, seed)
+// initOnHost() produces bit-identical data for a host mirror, so the CPU
+// reference never has to read the device-initialized buffers.
+
+#include <cstring>
+#include <string>
+
+#include "ze_api.h"
+
+enum class InitMode { Host, Fill, Pattern, Random };
+
+// How one buffer is initialized in each mode
+struct BufferInit {
+  uint8_t fillByte;
+  int patternBase;
+  int patternStride;
+  uint32_t seed;
+};
+
+// Keep random products small enough that the reference sums stay readable
+constexpr uint32_t kRandomRange = 16;
+
+bool parseInitMode(const std::string &name, InitMode &mode) {
+  if (name == "host")
+    mode = InitMode::Host;
+  else if (name == "fill")
+    mode = InitMode::Fill;
+  else if (name == "pattern")
+    mode = InitMode::Pattern;
+  else if (name == "random")
+    mode = InitMode::Random;
+  else
+    return false;
+  return true;
+}
+
+const char *initModeName(InitMode mode) {
+  switch (mode) {
+  case InitMode::Host:
+    return "host";
+  case InitMode::Fill:
+    return "fill";
+  case InitMode::Pattern:
+    return "pattern";
+  case InitMode::Random:
+    return "random";
+  }
+  return "";
+}
+
+void initOnHost(InitMode mode, void *dst, size_t count,
+                const BufferInit &init) {
+  uint32_t *out = static_cast<uint32_t *>(dst);
+  switch (mode) {
+  case InitMode::Host:
+  case InitMode::Fill:
+    memset(dst, init.fillByte, count * sizeof(uint32_t));
+    break;
+  case InitMode::Pattern:
+    for (size_t i = 0; i < count; i++)
+      out[i] = patternValue(i, init.patternBase, init.patternStride);
+    break;
+  case InitMode::Random:
+    for (size_t i = 0; i < count; i++)
+      out[i] = randomValue(i, init.seed, kRandomRange);
+    break;
+  }
+}
+
+class DeviceInitializer {
+public:
+  DeviceInitializer(ze_module_handle_t module) {
+    ze_kernel_desc_t kernelDesc = {};
+    kernelDesc.pKernelName = "fillPattern";
+    ZE_CHECK(zeKernelCreate(module, &kernelDesc, &patternKernel));
+    kernelDesc.pKernelName = "fillRandom";
+    ZE_CHECK(zeKernelCreate(module, &kernelDesc, &randomKernel));
+  }
+
+  // Must run after the appended work completed and before the module goes
+  void release() {
+    ZE_CHECK(zeKernelDestroy(patternKernel));
+    ZE_CHECK(zeKernelDestroy(randomKernel));
+  }
+
+  // Append the device-side initialization of `count` ints at `dst`.
+  // Kernel arguments are captured at append time, so one kernel handle
+  // serves every buffer.
+  void append(ze_command_list_handle_t cmdList, InitMode mode, void *dst,
+              size_t count, const BufferInit &init) {
+    switch (mode) {
+    case InitMode::Host:
+      initOnHost(mode, dst, count, init);
+      break;
+    case InitMode::Fill:
+      ZE_CHECK(zeCommandListAppendMemoryFill(cmdList, dst, &init.fillByte,
+                                             sizeof(init.fillByte),
+                                             count * sizeof(uint32_t), nullptr,
+                                             0, nullptr));
+      break;
+    case InitMode::Pattern:
+      ZE_CHECK(zeKernelSetArgumentValue(patternKernel, 0, sizeof(dst), &dst));
+      ZE_CHECK(zeKernelSetArgumentValue(patternKernel, 1, sizeof(int),
+                                        &init.patternBase));
+      ZE_CHECK(zeKernelSetArgumentValue(patternKernel, 2, sizeof(int),
+                                        &init.patternStride));
+      launch(cmdList, patternKernel, count);
+      break;
+    case InitMode::Random:
+      ZE_CHECK(zeKernelSetArgumentValue(randomKernel, 0, sizeof(dst), &dst));
+      ZE_CHECK(zeKernelSetArgumentValue(randomKernel, 1, sizeof(uint32_t),
+                                        &init.seed));
+      ZE_CHECK(zeKernelSetArgumentValue(randomKernel, 2, sizeof(uint32_t),
+                                        &kRandomRange));
+      launch(cmdList, randomKernel, count);
+      break;
+    }
+  }
+
+private:
+  // Whole groups covering `count` items; the kernels skip the excess
+  void launch(ze_command_list_handle_t cmdList, ze_kernel_handle_t kernel,
+              size_t count) {
+    uint32_t items = uint32_t(count);
+    ZE_CHECK(zeKernelSetArgumentValue(kernel, 3, sizeof(items), &items));
+    uint32_t groupSizeX = 256u;
+    uint32_t groupSizeY = 1u;
+    uint32_t groupSizeZ = 1u;
+    ZE_CHECK(zeKernelSuggestGroupSize(kernel, count, 1U, 1U, &groupSizeX,
+                                      &groupSizeY, &groupSizeZ));
+    ZE_CHECK(zeKernelSetGroupSize(kernel, groupSizeX, groupSizeY, groupSizeZ));
+    ze_group_count_t dispatch = {
+        uint32_t((count + groupSizeX - 1) / groupSizeX), 1, 1};
+    ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, kernel, &dispatch,
+                                             nullptr, 0, nullptr));
+  }
+
+  ze_kernel_handle_t patternKernel = nullptr;
+  ze_kernel_handle_t randomKernel = nullptr;
+};
@@ -9,3 +9,30 @@ __kernel void mxm(__global int* a, __global int* b, __global int *c, const int n
 
 	c[idx * n + jdx] = sum;
 }
+
+// Counter-based hash, mirrored by randomValue() in KernelGPU.hpp so the host
+// can rebuild the same inputs without reading them back from the device.
+uint hashIndex(uint i, uint seed) {
+	uint x = i * 0x9E3779B9u ^ seed;
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// The generators run in whole work-groups; items past `count` do nothing
+__kernel void fillPattern(__global int *a, const int base, const int stride,
+                          const uint count) {
+	uint i = get_global_id(0);
+	if (i < count)
+		a[i] = base + (int)i * stride;
+}
+
+__kernel void fillRandom(__global int *a, const uint seed, const uint range,
+                         const uint count) {
+	uint i = get_global_id(0);
+	if (i < count)
+		a[i] = (int)(hashIndex(i, seed) % range);
+}
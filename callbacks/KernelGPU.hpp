@@ -8,4 +8,23 @@ void KernelCPU(uint32_t *a, uint32_t *b, uint32_t *c, int n) {
       c[i * n + j] = sum;
     }
   }
-}
\ No newline at end of file
+}
+
+// Host twins of the fillPattern/fillRandom generator kernels in KernelGPU.cl
+uint32_t hashIndex(uint32_t i, uint32_t seed) {
+  uint32_t x = i * 0x9E3779B9u ^ seed;
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint32_t patternValue(uint32_t i, int base, int stride) {
+  return base + i * stride;
+}
+
+uint32_t randomValue(uint32_t i, uint32_t seed, uint32_t range) {
+  return hashIndex(i, seed) % range;
+}
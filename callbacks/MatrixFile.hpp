@@ -0,0 +1,108 @@
+// Memory-mapped n x n int32 matrix files.
+//
+// Layout: a 4 KB header ("MXMI32\0\0" magic, then n as uint64_t) followed by
+// n * n row-major int32 values. The header fills a whole page so the data is
+// page aligned in the mapping and can be handed to
+// zeCommandListAppendMemoryCopy as is, without reading it into a host buffer
+// first. Output files are created at full size and written through the
+// mapping; sync() flushes them.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class MatrixFile {
+public:
+  static constexpr size_t kHeaderSize = 4096;
+  static constexpr char kMagic[8] = {'M', 'X', 'M', 'I', '3', '2', 0, 0};
+
+  MatrixFile() = default;
+  MatrixFile(const MatrixFile &) = delete;
+  MatrixFile &operator=(const MatrixFile &) = delete;
+  ~MatrixFile() { close(); }
+
+  // Map an existing matrix file read-only
+  void open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      fail(path, "cannot open");
+    struct stat st;
+    fstat(fd, &st);
+    if (size_t(st.st_size) < kHeaderSize)
+      fail(path, "too small for a matrix header");
+    map(fd, st.st_size, PROT_READ, path);
+
+    if (memcmp(mapping, kMagic, sizeof(kMagic)) != 0)
+      fail(path, "is not a matrix file");
+    memcpy(&n, static_cast<char *>(mapping) + sizeof(kMagic), sizeof(n));
+    if (size_t(st.st_size) < bytesFor(n))
+      fail(path, "is truncated");
+    // Inputs are streamed front to back once
+    madvise(mapping, mappedBytes, MADV_SEQUENTIAL);
+  }
+
+  // Create (or truncate) a matrix file of size n and map it read-write
+  void create(const std::string &path, uint64_t size) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      fail(path, "cannot create");
+    if (ftruncate(fd, bytesFor(size)) != 0)
+      fail(path, "cannot be resized");
+    map(fd, bytesFor(size), PROT_READ | PROT_WRITE, path);
+    n = size;
+    memcpy(mapping, kMagic, sizeof(kMagic));
+    memcpy(static_cast<char *>(mapping) + sizeof(kMagic), &n, sizeof(n));
+  }
+
+  // Flush a writable mapping to the file
+  void sync() {
+    if (mapping)
+      msync(mapping, mappedBytes, MS_SYNC);
+  }
+
+  void close() {
+    if (mapping)
+      munmap(mapping, mappedBytes);
+    mapping = nullptr;
+    mappedBytes = 0;
+    n = 0;
+  }
+
+  bool isOpen() const { return mapping != nullptr; }
+  uint64_t size() const { return n; }
+  size_t dataBytes() const { return n * n * sizeof(int32_t); }
+  int32_t *data() const {
+    return reinterpret_cast<int32_t *>(static_cast<char *>(mapping) +
+                                       kHeaderSize);
+  }
+
+private:
+  static size_t bytesFor(uint64_t size) {
+    return kHeaderSize + size * size * sizeof(int32_t);
+  }
+
+  void map(int fd, size_t bytes, int prot, const std::string &path) {
+    mapping = mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      mapping = nullptr;
+      fail(path, "cannot be mapped");
+    }
+    mappedBytes = bytes;
+  }
+
+  [[noreturn]] static void fail(const std::string &path, const char *what) {
+    std::cout << "MatrixFile: " << path << " " << what << std::endl;
+    std::terminate();
+  }
+
+  void *mapping = nullptr;
+  size_t mappedBytes = 0;
+  uint64_t n = 0;
+};
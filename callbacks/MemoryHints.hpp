@@ -0,0 +1,47 @@
+// Migration hints for shared allocations.
+//
+// Shared buffers initialized on the host start out resident in host memory,
+// so the first kernel access takes page-migration faults. Prefetching moves
+// the pages to the device ahead of the launch; advice tells the driver where
+// the pages should live and that the inputs are read-only on the device.
+
+#include <string>
+
+#include "ze_api.h"
+
+enum MemoryHintFlags {
+  HINT_NONE = 0,
+  HINT_PREFETCH = 1 << 0,
+  HINT_ADVISE = 1 << 1,
+};
+
+std::string hintName(int hints) {
+  if (hints == HINT_NONE)
+    return "none";
+  std::string name;
+  if (hints & HINT_ADVISE)
+    name += "advise";
+  if (hints & HINT_PREFETCH)
+    name += name.empty() ? "prefetch" : "+prefetch";
+  return name;
+}
+
+// Append hints for the mxm inputs and output. Advice goes first so the
+// prefetch already migrates towards the preferred location.
+void appendMemoryHints(ze_command_list_handle_t cmdList,
+                       ze_device_handle_t device, void *inputA, void *inputB,
+                       void *output, size_t size, int hints) {
+  if (hints & HINT_ADVISE) {
+    for (void *ptr : {inputA, inputB, output})
+      ZE_CHECK(zeCommandListAppendMemAdvise(
+          cmdList, device, ptr, size,
+          ZE_MEMORY_ADVICE_SET_PREFERRED_LOCATION));
+    for (void *ptr : {inputA, inputB})
+      ZE_CHECK(zeCommandListAppendMemAdvise(cmdList, device, ptr, size,
+                                            ZE_MEMORY_ADVICE_SET_READ_MOSTLY));
+  }
+  if (hints & HINT_PREFETCH) {
+    for (void *ptr : {inputA, inputB, output})
+      ZE_CHECK(zeCommandListAppendMemoryPrefetch(cmdList, ptr, size));
+  }
+}
@@ -0,0 +1,249 @@
+// Suballocating pool over zeMemAllocHost/Device/Shared.
+//
+// Requests up to kMaxClassSize are rounded up to a power-of-two size class and
+// carved out of large chunks reserved per memory type, so only the first
+// request that exhausts a class pays for a driver allocation. Larger requests
+// take the large-object path straight to the driver. Chunks are kept until the
+// pool is destroyed.
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ze_api.h"
+
+enum class UsmType { Host = 0, Device = 1, Shared = 2 };
+
+const char *usmTypeName(UsmType type) {
+  switch (type) {
+  case UsmType::Host:
+    return "host";
+  case UsmType::Device:
+    return "device";
+  case UsmType::Shared:
+    return "shared";
+  }
+  return "";
+}
+
+class UsmPool {
+public:
+  static constexpr size_t kMinClassSize = 64;
+  static constexpr size_t kMaxClassSize = 4 << 20;
+  static constexpr size_t kNumClasses = 17; // 64 B .. 4 MB
+  static constexpr size_t kChunkSize = 16 << 20;
+  static constexpr size_t kChunkAlignment = 64 << 10;
+  static constexpr int kNumTypes = 3;
+
+  struct Stats {
+    uint64_t requests = 0;
+    uint64_t hits = 0;       // served from a free slot, no driver call
+    uint64_t misses = 0;     // needed a new chunk first
+    uint64_t largeAllocs = 0;
+    uint64_t driverAllocs = 0;
+    size_t reservedBytes = 0;  // chunks held by the pool
+    size_t slotBytesInUse = 0; // rounded-up size of live pooled allocations
+    size_t requestedInUse = 0; // caller-requested size of live pooled allocs
+    size_t largeBytesInUse = 0;
+    size_t peakReservedBytes = 0;
+  };
+
+  UsmPool(ze_context_handle_t context, ze_device_handle_t device)
+      : context(context), device(device) {
+    for (int t = 0; t < kNumTypes; t++)
+      for (size_t c = 0; c < kNumClasses; c++)
+        classes[t][c].slotSize = kMinClassSize << c;
+  }
+
+  ~UsmPool() { release(); }
+
+  // Return every chunk and large allocation to the driver. Must run before
+  // the context is destroyed; the pool can be reused afterwards.
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : live)
+      if (entry.second.sizeClass < 0)
+        ZE_CHECK(zeMemFree(context, entry.first));
+    live.clear();
+    for (int t = 0; t < kNumTypes; t++) {
+      for (auto &sizeClass : classes[t]) {
+        for (void *chunk : sizeClass.chunks)
+          ZE_CHECK(zeMemFree(context, chunk));
+        sizeClass.chunks.clear();
+        sizeClass.freeSlots.clear();
+      }
+      stats[t].reservedBytes = 0;
+      stats[t].slotBytesInUse = 0;
+      stats[t].requestedInUse = 0;
+      stats[t].largeBytesInUse = 0;
+    }
+  }
+
+  void *alloc(UsmType type, size_t size, size_t alignment = 64) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats[idx(type)].requests++;
+
+    // Slots are naturally aligned to min(slotSize, kChunkAlignment)
+    size_t rounded = std::max(size, alignment);
+    int c = classIndex(rounded);
+    if (c < 0 || alignment > kChunkAlignment)
+      return allocLarge(type, size, alignment);
+
+    SizeClass &sizeClass = classes[idx(type)][c];
+    if (sizeClass.freeSlots.empty()) {
+      stats[idx(type)].misses++;
+      addChunk(type, sizeClass);
+    } else {
+      stats[idx(type)].hits++;
+    }
+    void *ptr = sizeClass.freeSlots.back();
+    sizeClass.freeSlots.pop_back();
+
+    live[ptr] = {type, c, size};
+    stats[idx(type)].slotBytesInUse += sizeClass.slotSize;
+    stats[idx(type)].requestedInUse += size;
+    return ptr;
+  }
+
+  void free(void *ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = live.find(ptr);
+    if (it == live.end()) {
+      std::cout << "UsmPool::free: " << ptr << " was not allocated by the pool"
+                << std::endl;
+      std::terminate();
+    }
+    Allocation allocation = it->second;
+    live.erase(it);
+
+    Stats &s = stats[idx(allocation.type)];
+    if (allocation.sizeClass < 0) {
+      s.largeBytesInUse -= allocation.size;
+      ZE_CHECK(zeMemFree(context, ptr));
+      return;
+    }
+    SizeClass &sizeClass = classes[idx(allocation.type)][allocation.sizeClass];
+    s.slotBytesInUse -= sizeClass.slotSize;
+    s.requestedInUse -= allocation.size;
+    sizeClass.freeSlots.push_back(ptr);
+  }
+
+  Stats getStats(UsmType type) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats[idx(type)];
+  }
+
+  void printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "\nUSM pool statistics\n";
+    std::cout << std::left << std::setw(8) << "type" << std::right
+              << std::setw(10) << "requests" << std::setw(10) << "hit rate"
+              << std::setw(8) << "large" << std::setw(10) << "drv alloc"
+              << std::setw(14) << "reserved [B]" << std::setw(14)
+              << "in use [B]" << std::setw(12) << "int. frag" << std::setw(12)
+              << "idle" << std::endl;
+    for (int t = 0; t < kNumTypes; t++) {
+      const Stats &s = stats[t];
+      uint64_t pooled = s.hits + s.misses;
+      double hitRate = pooled ? double(s.hits) / pooled : 0.0;
+      // Internal: bytes lost to size-class rounding in live allocations.
+      // Idle: reserved chunk bytes not backing any live allocation.
+      double internal = s.slotBytesInUse
+                            ? 1.0 - double(s.requestedInUse) / s.slotBytesInUse
+                            : 0.0;
+      double idle = s.reservedBytes
+                        ? 1.0 - double(s.slotBytesInUse) / s.reservedBytes
+                        : 0.0;
+      std::cout << std::left << std::setw(8) << usmTypeName(UsmType(t))
+                << std::right << std::setw(10) << s.requests << std::setw(9)
+                << std::fixed << std::setprecision(1) << hitRate * 100 << "%"
+                << std::setw(8) << s.largeAllocs << std::setw(10)
+                << s.driverAllocs << std::setw(14) << s.reservedBytes
+                << std::setw(14) << s.requestedInUse + s.largeBytesInUse
+                << std::setw(11) << internal * 100 << "%" << std::setw(11)
+                << idle * 100 << "%" << std::endl;
+    }
+  }
+
+private:
+  struct SizeClass {
+    size_t slotSize = 0;
+    std::vector<void *> chunks;
+    std::vector<void *> freeSlots;
+  };
+
+  struct Allocation {
+    UsmType type;
+    int sizeClass; // -1 for the large-object path
+    size_t size;
+  };
+
+  static int idx(UsmType type) { return static_cast<int>(type); }
+
+  static int classIndex(size_t size) {
+    if (size > kMaxClassSize)
+      return -1;
+    int c = 0;
+    while ((kMinClassSize << c) < size)
+      c++;
+    return c;
+  }
+
+  void *driverAlloc(UsmType type, size_t size, size_t alignment) {
+    ze_device_mem_alloc_desc_t deviceDesc = {
+        ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+    deviceDesc.ordinal = 0;
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+
+    void *ptr = nullptr;
+    switch (type) {
+    case UsmType::Host:
+      ZE_CHECK(zeMemAllocHost(context, &hostDesc, size, alignment, &ptr));
+      break;
+    case UsmType::Device:
+      ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, size, alignment, device,
+                                &ptr));
+      break;
+    case UsmType::Shared:
+      ZE_CHECK(zeMemAllocShared(context, &deviceDesc, &hostDesc, size,
+                                alignment, device, &ptr));
+      break;
+    }
+    stats[idx(type)].driverAllocs++;
+    return ptr;
+  }
+
+  void addChunk(UsmType type, SizeClass &sizeClass) {
+    size_t chunkSize = std::max(kChunkSize, sizeClass.slotSize);
+    char *chunk =
+        static_cast<char *>(driverAlloc(type, chunkSize, kChunkAlignment));
+    sizeClass.chunks.push_back(chunk);
+    // Push in reverse so slots are handed out in address order
+    for (size_t offset = chunkSize; offset >= sizeClass.slotSize;
+         offset -= sizeClass.slotSize)
+      sizeClass.freeSlots.push_back(chunk + offset - sizeClass.slotSize);
+
+    Stats &s = stats[idx(type)];
+    s.reservedBytes += chunkSize;
+    s.peakReservedBytes = std::max(s.peakReservedBytes, s.reservedBytes);
+  }
+
+  void *allocLarge(UsmType type, size_t size, size_t alignment) {
+    void *ptr = driverAlloc(type, size, std::max(alignment, kChunkAlignment));
+    live[ptr] = {type, -1, size};
+    stats[idx(type)].largeAllocs++;
+    stats[idx(type)].largeBytesInUse += size;
+    return ptr;
+  }
+
+  ze_context_handle_t context;
+  ze_device_handle_t device;
+  std::mutex mutex;
+  SizeClass classes[kNumTypes][kNumClasses];
+  std::unordered_map<void *, Allocation> live;
+  Stats stats[kNumTypes];
+};
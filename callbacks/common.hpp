@@ -1,3 +1,5 @@
+#include "ze_api.h"
+
 #define ZE_CHECK(myZeCall)                                            \
   if (myZeCall != ZE_RESULT_SUCCESS) {                                    \
     std::cout << "Error at " << #myZeCall << ": " << __FUNCTION__ << ": " \
@@ -6,3 +8,16 @@
               << "0x" << std::hex << myZeCall << std::dec << std::endl;   \
     std::terminate();                                                     \
   }
+
+float timestampToMsKernel(ze_device_handle_t device, uint64_t start,
+                          uint64_t stop) {
+  // query device properties to get timer resolution
+  ze_device_properties_t Props = {ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
+  ZE_CHECK(zeDeviceGetProperties(device, &Props));
+  uint64_t TimerResolution = Props.timerResolution;
+  uint32_t TimestampValidBits = Props.kernelTimestampValidBits;
+
+  uint64_t T = ((stop - start) & (((uint64_t)1 << TimestampValidBits) - 1));
+  T = T * TimerResolution;
+  return T / 1000000.0;
+}
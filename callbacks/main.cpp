@@ -3,19 +3,121 @@
 //      https://github.com/intel/compute-runtime/blob/master/level_zero/core/test/black_box_tests/zello_world_gpu.cpp
 
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "KernelGPU.hpp"
 #include "common.hpp"
+#include "DeviceInit.hpp"
+#include "MatrixFile.hpp"
+#include "MemoryHints.hpp"
+#include "UsmPool.hpp"
 #include "ze_api.h"
 
+struct Options {
+  int hints = HINT_NONE;
+  bool compareHints = false;
+  InitMode init = InitMode::Host;
+  bool hostMirror = false;
+  std::string fileA, fileB, fileOut;
+};
+
+void printUsage(const char *prog) {
+  std::cout << "Usage: " << prog << " [options]\n"
+            << "  --prefetch       prefetch inputs and output to the device\n"
+            << "  --advise         set preferred location and read-mostly\n"
+            << "  --compare-hints  time mxm on fresh buffers with every hint "
+               "combination\n"
+            << "  --init=MODE      input initialization: host (memset), fill,\n"
+            << "                   pattern or random (created on the device)\n"
+            << "  --host-mirror    build the CPU reference inputs on the host\n"
+            << "                   instead of reading the shared buffers\n"
+            << "  --a=FILE --b=FILE  read A and B from matrix files (see\n"
+            << "                   mkmatrix); n is taken from the files\n"
+            << "  --out=FILE       write C to a matrix file\n";
+}
+
+Options parseOptions(int argc, char **argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--prefetch") {
+      opts.hints |= HINT_PREFETCH;
+    } else if (arg == "--advise") {
+      opts.hints |= HINT_ADVISE;
+    } else if (arg == "--compare-hints") {
+      opts.compareHints = true;
+    } else if (arg.rfind("--init=", 0) == 0 &&
+               parseInitMode(arg.substr(7), opts.init)) {
+    } else if (arg == "--host-mirror") {
+      opts.hostMirror = true;
+    } else if (arg.rfind("--a=", 0) == 0) {
+      opts.fileA = arg.substr(4);
+    } else if (arg.rfind("--b=", 0) == 0) {
+      opts.fileB = arg.substr(4);
+    } else if (arg.rfind("--out=", 0) == 0) {
+      opts.fileOut = arg.substr(6);
+    } else {
+      printUsage(argv[0]);
+      std::exit(arg == "--help" ? 0 : 1);
+    }
+  }
+  if (opts.fileA.empty() != opts.fileB.empty()) {
+    std::cout << "--a and --b must be given together\n";
+    std::exit(1);
+  }
+  return opts;
+}
+
+// Run mxm once on freshly allocated, host-initialized shared buffers with the
+// given hints. A new pool per run guarantees the pages have never been
+// migrated. Returns the device kernel time; wallMs also covers the hints.
+float timeMxmWithHints(ze_context_handle_t context, ze_device_handle_t device,
+                       ze_command_list_handle_t cmdList,
+                       ze_kernel_handle_t kernel, ze_event_handle_t event,
+                       const ze_group_count_t &dispatch, uint32_t items,
+                       int hints, float &wallMs) {
+  size_t allocSize = size_t(items) * items * sizeof(int);
+  UsmPool pool(context, device);
+  void *sharedA = pool.alloc(UsmType::Shared, allocSize);
+  void *sharedB = pool.alloc(UsmType::Shared, allocSize);
+  void *dstResult = pool.alloc(UsmType::Shared, allocSize);
+  memset(sharedA, 2, allocSize);
+  memset(sharedB, 3, allocSize);
+  memset(dstResult, 0, allocSize);
+
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(sharedA), &sharedA));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(sharedB), &sharedB));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(dstResult), &dstResult));
+  ZE_CHECK(zeEventHostReset(event));
+
+  auto begin = std::chrono::steady_clock::now();
+  appendMemoryHints(cmdList, device, sharedA, sharedB, dstResult, allocSize,
+                    hints);
+  ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, kernel, &dispatch, event,
+                                           0, nullptr));
+  ZE_CHECK(zeEventHostSynchronize(event, std::numeric_limits<uint64_t>::max()));
+  auto end = std::chrono::steady_clock::now();
+  wallMs = std::chrono::duration<float, std::milli>(end - begin).count();
+
+  ze_kernel_timestamp_result_t res{};
+  ZE_CHECK(zeEventQueryKernelTimestamp(event, &res));
+  pool.release();
+  return timestampToMsKernel(device, res.global.kernelStart,
+                             res.global.kernelEnd);
+}
+
 #define IMMEDIATE 1
 int main(int argc, char **argv) {
+  Options opts = parseOptions(argc, argv);
 #if IMMEDIATE
   std::cout << "Using immediate command list\n";
 #else
@@ -98,7 +200,7 @@ int main(int argc, char **argv) {
   ze_event_handle_t Event;
   ze_event_pool_handle_t EventPool_;
   unsigned int PoolFlags =
-      ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+      ZE_EVENT_POOL_FLAG_HOST_VISIBLE | ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP;
 
   ze_event_pool_desc_t EventPoolDesc = {
       ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,  // stype
@@ -130,32 +232,32 @@ int main(int argc, char **argv) {
   EventDesc.index++;
   ZE_CHECK(zeEventCreate(EventPool_, &EventDesc, &GpuReady));
 
-  // Create two buffers
-  const uint32_t items = 1024;
-  constexpr size_t allocSize = items * items * sizeof(int);
-  ze_device_mem_alloc_desc_t memAllocDesc = {
-      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
-  memAllocDesc.ordinal = 0;
-
-  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
-
-  void *sharedA = nullptr;
-  ZE_CHECK(zeMemAllocShared(context, &memAllocDesc, &hostDesc, allocSize, 1,
-                                device, &sharedA));
-
-  void *sharedB = nullptr;
-  ZE_CHECK(zeMemAllocShared(context, &memAllocDesc, &hostDesc, allocSize, 1,
-                                device, &sharedB));
+  // Matrix files are mapped, not read; their pages stream straight into the
+  // copies below
+  MatrixFile fileA, fileB;
+  bool fromFiles = !opts.fileA.empty();
+  uint32_t items = 1024;
+  if (fromFiles) {
+    fileA.open(opts.fileA);
+    fileB.open(opts.fileB);
+    if (fileA.size() != fileB.size()) {
+      std::cout << "A is " << fileA.size() << " x " << fileA.size()
+                << " but B is " << fileB.size() << " x " << fileB.size()
+                << "\n";
+      std::terminate();
+    }
+    items = static_cast<uint32_t>(fileA.size());
+    std::cout << "Matrices from " << opts.fileA << " and " << opts.fileB
+              << ", n = " << items << "\n";
+  }
 
-  void *dstResult = nullptr;
-  ZE_CHECK(zeMemAllocShared(context, &memAllocDesc, &hostDesc, allocSize, 1,
-                                device, &dstResult));
+  // Create two buffers
+  const size_t allocSize = size_t(items) * items * sizeof(int);
+  UsmPool pool(context, device);
 
-  // memory initialization
-  constexpr uint8_t val = 2;
-  memset(sharedA, val, allocSize);
-  memset(sharedB, 3, allocSize);
-  memset(dstResult, 0, allocSize);
+  void *sharedA = pool.alloc(UsmType::Shared, allocSize);
+  void *sharedB = pool.alloc(UsmType::Shared, allocSize);
+  void *dstResult = pool.alloc(UsmType::Shared, allocSize);
 
   // Module Initialization
   ze_module_handle_t module = nullptr;
@@ -200,6 +302,42 @@ int main(int argc, char **argv) {
   kernelDesc.pKernelName = "mxm";
   ZE_CHECK(zeKernelCreate(module, &kernelDesc, &kernel));
 
+  // memory initialization
+  const size_t count = size_t(items) * items;
+  const BufferInit initA = {2, 1, 1, 0x1234u};
+  const BufferInit initB = {3, 2, 3, 0x5678u};
+  const BufferInit initC = {0, 0, 0, 0u};
+  std::cout << "Input initialization: "
+            << (fromFiles ? "file" : initModeName(opts.init)) << "\n";
+  DeviceInitializer initializer(module);
+  if (fromFiles) {
+    ZE_CHECK(zeCommandListAppendMemoryCopy(cmdListImm, sharedA, fileA.data(),
+                                           allocSize, nullptr, 0, nullptr));
+    ZE_CHECK(zeCommandListAppendMemoryCopy(cmdListImm, sharedB, fileB.data(),
+                                           allocSize, nullptr, 0, nullptr));
+  } else {
+    initializer.append(cmdListImm, opts.init, sharedA, count, initA);
+    initializer.append(cmdListImm, opts.init, sharedB, count, initB);
+  }
+  // The output only needs zeroing, a fill does that in place for every mode
+  initializer.append(cmdListImm,
+                     opts.init == InitMode::Host ? InitMode::Host
+                                                 : InitMode::Fill,
+                     dstResult, count, initC);
+  // Commands on an immediate list may overlap: the hints and mxm below must
+  // not start before the inputs (copied from the files or initialized) and
+  // the output are written
+  ZE_CHECK(zeCommandListAppendBarrier(cmdListImm, nullptr, 0, nullptr));
+
+  // Optional host copy of the inputs for the CPU reference
+  std::vector<uint32_t> mirrorA, mirrorB;
+  if (opts.hostMirror && !fromFiles) {
+    mirrorA.resize(count);
+    mirrorB.resize(count);
+    initOnHost(opts.init, mirrorA.data(), count, initA);
+    initOnHost(opts.init, mirrorB.data(), count, initB);
+  }
+
   uint32_t groupSizeX = 32u;
   uint32_t groupSizeY = 32u;
   uint32_t groupSizeZ = 1u;
@@ -211,11 +349,11 @@ int main(int argc, char **argv) {
   std::cout << "Group X: " << groupSizeX << std::endl;
   std::cout << "Group Y: " << groupSizeY << std::endl;
 
-  // Push arguments
+  // Push arguments in the order of mxm(a, b, c, n)
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(sharedA), &sharedA));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(sharedB), &sharedB));
   ZE_CHECK(
-      zeKernelSetArgumentValue(kernel, 0, sizeof(dstResult), &dstResult));
-  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(sharedA), &sharedA));
-  ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(sharedB), &sharedB));
+      zeKernelSetArgumentValue(kernel, 2, sizeof(dstResult), &dstResult));
   ZE_CHECK(zeKernelSetArgumentValue(kernel, 3, sizeof(int), &items));
 
   // Kernel thread-dispatch
@@ -233,6 +371,10 @@ int main(int argc, char **argv) {
   ZE_CHECK(zeEventHostReset(GpuReady));
   ZE_CHECK(zeEventHostReset(HostSignalEvent));
 //   ZE_CHECK(zeCommandListAppendBarrier(cmdList, GpuReady, 0, nullptr));
+  // Migration hints run ahead of the kernel on the same immediate list
+  std::cout << "Memory hints: " << hintName(opts.hints) << "\n";
+  appendMemoryHints(cmdListImm, device, sharedA, sharedB, dstResult, allocSize,
+                    opts.hints);
   // Launch kernel on the GPU
   std::cout << "Launching kernel\n";
   //enqueue HostSignalEvent signal
@@ -261,18 +403,51 @@ int main(int argc, char **argv) {
   ze_kernel_timestamp_result_t res{};
   ZE_CHECK(zeEventQueryKernelTimestamp(Event, &res));
   std::cout << "Kernel Event Query: " << res.context.kernelEnd << std::endl;
+  std::cout << "Kernel time (hints: " << hintName(opts.hints) << "): "
+            << timestampToMsKernel(device, res.global.kernelStart,
+                                   res.global.kernelEnd)
+            << " ms" << std::endl;
 
   // Validate
   bool outputValidationSuccessful = true;
 
-  uint32_t *resultSeq = (uint32_t *)malloc(allocSize);
   uint32_t *dstInt = static_cast<uint32_t *>(dstResult);
-  uint32_t *srcA = static_cast<uint32_t *>(sharedA);
-  uint32_t *srcB = static_cast<uint32_t *>(sharedB);
+  uint32_t *srcA = opts.hostMirror ? mirrorA.data()
+                                   : static_cast<uint32_t *>(sharedA);
+  uint32_t *srcB = opts.hostMirror ? mirrorB.data()
+                                   : static_cast<uint32_t *>(sharedB);
+  // The mapped files are the host mirror when inputs come from files
+  if (fromFiles) {
+    srcA = reinterpret_cast<uint32_t *>(fileA.data());
+    srcB = reinterpret_cast<uint32_t *>(fileB.data());
+  }
 
+  // Production-sized matrices make the O(n^3) reference impractical, so
+  // file inputs are checked on a random sample of entries instead, and
+  // only the sampled entries of the reference are kept
+  const int kSamples = 1024;
+  struct Sample {
+    uint32_t i, j, expected;
+  };
+  std::vector<Sample> samples;
+  std::vector<uint32_t> resultSeq;
   std::chrono::steady_clock::time_point beginSeq =
       std::chrono::steady_clock::now();
-  KernelCPU(srcA, srcB, resultSeq, items);
+  if (fromFiles) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> index(0, items - 1);
+    for (int s = 0; s < kSamples; s++) {
+      uint32_t i = index(rng);
+      uint32_t j = index(rng);
+      int sum = 0;
+      for (size_t k = 0; k < items; k++)
+        sum += srcA[size_t(i) * items + k] * srcB[k * items + j];
+      samples.push_back({i, j, uint32_t(sum)});
+    }
+  } else {
+    resultSeq.resize(count);
+    KernelCPU(srcA, srcB, resultSeq.data(), items);
+  }
   std::chrono::steady_clock::time_point endSeq =
       std::chrono::steady_clock::now();
 
@@ -287,22 +462,66 @@ int main(int argc, char **argv) {
   std::cout << "Speedup = " << speedup << "x" << std::endl;
 
   int n = items;
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      if (resultSeq[i * n + j] != dstInt[i * n + j]) {
+  if (fromFiles) {
+    for (const Sample &sample : samples) {
+      if (sample.expected != dstInt[size_t(sample.i) * n + sample.j]) {
         outputValidationSuccessful = false;
         break;
       }
     }
+  } else {
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        if (resultSeq[i * n + j] != dstInt[i * n + j]) {
+          outputValidationSuccessful = false;
+          break;
+        }
+      }
+    }
   }
 
   std::cout << "\nMatrix Multiply validation "
             << (outputValidationSuccessful ? "PASSED" : "FAILED") << "\n";
 
+  // The result goes from the device buffer straight into the output mapping
+  if (!opts.fileOut.empty()) {
+    MatrixFile fileOut;
+    fileOut.create(opts.fileOut, items);
+    ze_event_handle_t CopyDone;
+    EventDesc.index++;
+    ZE_CHECK(zeEventCreate(EventPool_, &EventDesc, &CopyDone));
+    ZE_CHECK(zeCommandListAppendMemoryCopy(cmdListImm, fileOut.data(),
+                                           dstResult, allocSize, CopyDone, 0,
+                                           nullptr));
+    ZE_CHECK(zeEventHostSynchronize(CopyDone,
+                                    std::numeric_limits<uint64_t>::max()));
+    fileOut.sync();
+    ZE_CHECK(zeEventDestroy(CopyDone));
+    std::cout << "Wrote C to " << opts.fileOut << "\n";
+  }
+
+  if (opts.compareHints) {
+    std::cout << "\nKernel time on fresh host-initialized shared buffers\n";
+    std::cout << "hints               kernel [ms]   with hints [ms]\n";
+    const int hintModes[] = {HINT_NONE, HINT_PREFETCH, HINT_ADVISE,
+                             HINT_ADVISE | HINT_PREFETCH};
+    for (int hints : hintModes) {
+      float wallMs = 0;
+      float kernelMs = timeMxmWithHints(context, device, cmdListImm, kernel,
+                                        Event, dispatch, items, hints, wallMs);
+      std::cout << std::left << std::setw(20) << hintName(hints) << std::right
+                << std::setw(11) << kernelMs << std::setw(18) << wallMs
+                << std::endl;
+    }
+  }
+
   // Cleanup
-  ZE_CHECK(zeMemFree(context, dstResult));
-  ZE_CHECK(zeMemFree(context, sharedA));
-  ZE_CHECK(zeMemFree(context, sharedB));
+  initializer.release();
+  pool.free(dstResult);
+  pool.free(sharedA);
+  pool.free(sharedB);
+  pool.printStats();
+  pool.release();
   ZE_CHECK(zeCommandListDestroy(cmdList));
   ZE_CHECK(zeCommandQueueDestroy(cmdQueue));
   ZE_CHECK(zeContextDestroy(context));
@@ -0,0 +1,33 @@
+// Write an n x n matrix file for the driver's --a/--b options.
+//
+// Values come from the same counter-based hash as the fillRandom kernel, so a
+// file with seed s holds what --init=random produces with that seed.
+//
+// Usage: ./mkmatrix FILE n [seed=1] [range=16]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "KernelGPU.hpp"
+#include "MatrixFile.hpp"
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cout << "Usage: " << argv[0] << " FILE n [seed=1] [range=16]\n";
+    return 1;
+  }
+  uint64_t n = std::strtoull(argv[2], nullptr, 10);
+  uint32_t seed = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+  uint32_t range = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16;
+
+  MatrixFile file;
+  file.create(argv[1], n);
+  int32_t *data = file.data();
+  for (uint64_t i = 0; i < n * n; i++)
+    data[i] = static_cast<int32_t>(randomValue(uint32_t(i), seed, range));
+  file.sync();
+  std::cout << "Wrote " << n << " x " << n << " matrix to " << argv[1]
+            << "\n";
+  return 0;
+}
@@ -0,0 +1,166 @@
+// Pipelined host<->device transfer engine.
+//
+// A large transfer from pageable host memory is split into chunks that go
+// through a ring of 2 or 3 pinned (zeMemAllocHost) staging buffers on the copy
+// engine. While chunk i is in flight the host is already filling the staging
+// buffer for chunk i+1, and an optional per-chunk compute stage can run on
+// chunk i on the compute engine while chunk i+1 uploads.
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "ze_api.h"
+
+class ChunkedCopy {
+public:
+  // Append work on `computeList` for the chunk [deviceChunk, +bytes) that
+  // waits on `ready` and signals `done` when it has finished.
+  using ChunkStage = std::function<void(
+      ze_command_list_handle_t computeList, void *deviceChunk, size_t offset,
+      size_t bytes, ze_event_handle_t ready, ze_event_handle_t done)>;
+
+  ChunkedCopy(ze_context_handle_t context, ze_device_handle_t device,
+              size_t chunkSize, uint32_t numBuffers = 2)
+      : context(context), chunkSize(chunkSize), numBuffers(numBuffers) {
+    uint32_t computeOrdinal = 0;
+    findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                     computeOrdinal);
+    uint32_t copyOrdinal = computeOrdinal;
+    dedicatedCopyEngine =
+        findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY,
+                         ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE,
+                         copyOrdinal);
+    copyList = createImmediateList(context, device, copyOrdinal);
+    computeList = createImmediateList(context, device, computeOrdinal);
+
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE,
+                                          2 * numBuffers};
+    ZE_CHECK(
+        zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+    slots.resize(numBuffers);
+    for (uint32_t i = 0; i < numBuffers; i++) {
+      ZE_CHECK(zeMemAllocHost(context, &hostDesc, chunkSize, 4096,
+                              &slots[i].staging));
+      ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr,
+                                   2 * i, ZE_EVENT_SCOPE_FLAG_HOST,
+                                   ZE_EVENT_SCOPE_FLAG_HOST};
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &slots[i].copyDone));
+      eventDesc.index++;
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &slots[i].stageDone));
+    }
+  }
+
+  ~ChunkedCopy() {
+    for (auto &slot : slots) {
+      zeEventDestroy(slot.copyDone);
+      zeEventDestroy(slot.stageDone);
+      zeMemFree(context, slot.staging);
+    }
+    zeEventPoolDestroy(eventPool);
+    zeCommandListDestroy(copyList);
+    zeCommandListDestroy(computeList);
+  }
+
+  bool hasDedicatedCopyEngine() const { return dedicatedCopyEngine; }
+
+  // Copy `bytes` from pageable `src` to device memory `dst`. Returns once
+  // every chunk and its compute stage (if any) have completed.
+  void upload(void *dst, const void *src, size_t bytes,
+              const ChunkStage &stage = nullptr) {
+    size_t numChunks = (bytes + chunkSize - 1) / chunkSize;
+    for (size_t i = 0; i < numChunks; i++) {
+      Slot &slot = acquire(i);
+      size_t offset = i * chunkSize;
+      size_t len = std::min(chunkSize, bytes - offset);
+      char *deviceChunk = static_cast<char *>(dst) + offset;
+
+      memcpy(slot.staging, static_cast<const char *>(src) + offset, len);
+      ZE_CHECK(zeCommandListAppendMemoryCopy(copyList, deviceChunk,
+                                             slot.staging, len, slot.copyDone,
+                                             0, nullptr));
+      if (stage) {
+        stage(computeList, deviceChunk, offset, len, slot.copyDone,
+              slot.stageDone);
+        slot.staged = true;
+      }
+      slot.busy = true;
+    }
+    drain();
+  }
+
+  // Copy `bytes` from device memory `src` to pageable `dst`. Up to
+  // numBuffers chunks are in flight while the host drains finished ones.
+  void download(void *dst, const void *src, size_t bytes) {
+    size_t numChunks = (bytes + chunkSize - 1) / chunkSize;
+    auto issue = [&](size_t i) {
+      Slot &slot = slots[i % numBuffers];
+      size_t offset = i * chunkSize;
+      size_t len = std::min(chunkSize, bytes - offset);
+      ZE_CHECK(zeCommandListAppendMemoryCopy(
+          copyList, slot.staging, static_cast<const char *>(src) + offset, len,
+          slot.copyDone, 0, nullptr));
+      slot.busy = true;
+    };
+    for (size_t i = 0; i < std::min<size_t>(numBuffers, numChunks); i++)
+      issue(i);
+    for (size_t i = 0; i < numChunks; i++) {
+      Slot &slot = acquire(i);
+      size_t offset = i * chunkSize;
+      size_t len = std::min(chunkSize, bytes - offset);
+      memcpy(static_cast<char *>(dst) + offset, slot.staging, len);
+      if (i + numBuffers < numChunks)
+        issue(i + numBuffers);
+    }
+  }
+
+private:
+  struct Slot {
+    void *staging = nullptr;
+    ze_event_handle_t copyDone = nullptr;  // staging buffer consumed/filled
+    ze_event_handle_t stageDone = nullptr; // compute stage finished
+    bool busy = false;
+    bool staged = false;
+  };
+
+  // Wait until the slot for chunk i is free again and reset its events.
+  // The compute stage waits on copyDone, so it has to finish before that
+  // event can be reset and reused.
+  Slot &acquire(size_t i) {
+    Slot &slot = slots[i % numBuffers];
+    if (slot.staged)
+      ZE_CHECK(zeEventHostSynchronize(slot.stageDone,
+                                      std::numeric_limits<uint64_t>::max()));
+    if (slot.busy) {
+      ZE_CHECK(zeEventHostSynchronize(slot.copyDone,
+                                      std::numeric_limits<uint64_t>::max()));
+      ZE_CHECK(zeEventHostReset(slot.copyDone));
+      slot.busy = false;
+    }
+    if (slot.staged) {
+      ZE_CHECK(zeEventHostReset(slot.stageDone));
+      slot.staged = false;
+    }
+    return slot;
+  }
+
+  void drain() {
+    for (size_t i = 0; i < numBuffers; i++)
+      acquire(i);
+  }
+
+  ze_context_handle_t context;
+  size_t chunkSize;
+  uint32_t numBuffers;
+  bool dedicatedCopyEngine = false;
+  ze_command_list_handle_t copyList = nullptr;
+  ze_command_list_handle_t computeList = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  std::vector<Slot> slots;
+};
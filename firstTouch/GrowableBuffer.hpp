@@ -0,0 +1,86 @@
+// Device buffer that grows in place.
+//
+// The full capacity is reserved up front as virtual address space with
+// zeVirtualMemReserve, but only the committed prefix is backed. Growing maps
+// new physical pages (zePhysicalMemCreate + zeVirtualMemMap) directly after
+// the committed range, so data() never changes and nothing is copied.
+// Commits round up to the device page size and at least double the committed
+// size, so an ingest loop of small appends does not map a page at a time.
+
+#include <algorithm>
+#include <vector>
+
+#include "ze_api.h"
+
+class GrowableBuffer {
+public:
+  GrowableBuffer(ze_context_handle_t context, ze_device_handle_t device,
+                 size_t maxBytes)
+      : context(context), device(device) {
+    ZE_CHECK(zeVirtualMemQueryPageSize(context, device, maxBytes, &pageSize));
+    reserved = roundUp(maxBytes);
+    ZE_CHECK(zeVirtualMemReserve(context, nullptr, reserved, &base));
+  }
+
+  ~GrowableBuffer() { release(); }
+
+  // Unmap and free everything. Must run before the context is destroyed.
+  void release() {
+    if (!base)
+      return;
+    for (const Segment &segment : segments) {
+      ZE_CHECK(zeVirtualMemUnmap(context, segment.ptr, segment.size));
+      ZE_CHECK(zePhysicalMemDestroy(context, segment.physical));
+    }
+    segments.clear();
+    ZE_CHECK(zeVirtualMemFree(context, base, reserved));
+    base = nullptr;
+    committed = 0;
+  }
+
+  void *data() const { return base; }
+  size_t capacity() const { return committed; }
+  size_t maxCapacity() const { return reserved; }
+  size_t numMappings() const { return segments.size(); }
+
+  // Back at least `bytes` from the start of the buffer. Returns false if
+  // that is beyond the reservation; the buffer is unchanged in that case.
+  bool ensureCapacity(size_t bytes) {
+    if (bytes <= committed)
+      return true;
+    if (bytes > reserved)
+      return false;
+    size_t target = std::min(reserved, std::max(roundUp(bytes), 2 * committed));
+    size_t size = target - committed;
+
+    ze_physical_mem_desc_t physicalDesc = {
+        ZE_STRUCTURE_TYPE_PHYSICAL_MEM_DESC, nullptr, 0, size};
+    Segment segment = {static_cast<char *>(base) + committed, size, nullptr};
+    ZE_CHECK(zePhysicalMemCreate(context, device, &physicalDesc,
+                                 &segment.physical));
+    ZE_CHECK(zeVirtualMemMap(context, segment.ptr, size, segment.physical, 0,
+                             ZE_MEMORY_ACCESS_ATTRIBUTE_READWRITE));
+    segments.push_back(segment);
+    committed = target;
+    return true;
+  }
+
+private:
+  struct Segment {
+    void *ptr;
+    size_t size;
+    ze_physical_mem_handle_t physical;
+  };
+
+  size_t roundUp(size_t bytes) const {
+    return (bytes + pageSize - 1) / pageSize * pageSize;
+  }
+
+  ze_context_handle_t context;
+  ze_device_handle_t device;
+  size_t pageSize = 0;
+  size_t reserved = 0;
+  size_t committed = 0;
+  void *base = nullptr;
+  std::vector<Segment> segments;
+};
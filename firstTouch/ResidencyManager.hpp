@@ -0,0 +1,155 @@
+// Explicit residency for pooled allocations.
+//
+// Callers register allocations with track() and call prepare() on the
+// buffers a kernel is about to use, off the latency-critical path. prepare()
+// makes them resident with zeContextMakeMemoryResident and, if the device
+// budget would be exceeded, evicts the least recently prepared buffers with
+// zeContextEvictMemory first. Buffers passed to the same prepare() call are
+// never evicted to make room for each other.
+//
+// Ranges are passed to the driver as registered, so sub-allocations from
+// UsmPool are made resident slot by slot rather than chunk by chunk.
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ze_api.h"
+
+class ResidencyManager {
+public:
+  struct Stats {
+    uint64_t prepares = 0;      // buffers passed to prepare()
+    uint64_t hits = 0;          // already resident, no driver call
+    uint64_t makeResident = 0;  // zeContextMakeMemoryResident calls
+    uint64_t evictions = 0;     // zeContextEvictMemory calls
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+  };
+
+  ResidencyManager(ze_context_handle_t context, ze_device_handle_t device,
+                   size_t budgetBytes)
+      : context(context), device(device), budget(budgetBytes) {}
+
+  ~ResidencyManager() { release(); }
+
+  // Evict everything still resident. Must run before the tracked
+  // allocations are freed and before the context is destroyed.
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : entries)
+      if (entry.second.resident)
+        evictLocked(entry.first, entry.second);
+    entries.clear();
+    lru.clear();
+  }
+
+  void track(void *ptr, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[ptr];
+    entry.size = size;
+  }
+
+  // Stop managing `ptr`, evicting it if it is resident. Call before freeing.
+  void untrack(void *ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(ptr);
+    if (it == entries.end())
+      return;
+    if (it->second.resident) {
+      lru.erase(it->second.lruPos);
+      evictLocked(ptr, it->second);
+    }
+    entries.erase(it);
+  }
+
+  void prepare(void *ptr) { prepare(std::vector<void *>{ptr}); }
+
+  // Make every buffer in `ptrs` resident, evicting least recently used
+  // buffers outside `ptrs` while the budget would be exceeded.
+  void prepare(const std::vector<void *> &ptrs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_set<void *> keep(ptrs.begin(), ptrs.end());
+    for (void *ptr : ptrs) {
+      auto it = entries.find(ptr);
+      if (it == entries.end()) {
+        std::cout << "ResidencyManager::prepare: " << ptr
+                  << " is not tracked" << std::endl;
+        std::terminate();
+      }
+      Entry &entry = it->second;
+      stats.prepares++;
+      if (entry.resident) {
+        stats.hits++;
+        lru.erase(entry.lruPos);
+      } else {
+        makeRoom(entry.size, keep);
+        ZE_CHECK(
+            zeContextMakeMemoryResident(context, device, ptr, entry.size));
+        entry.resident = true;
+        stats.makeResident++;
+        stats.residentBytes += entry.size;
+        stats.peakResidentBytes =
+            std::max(stats.peakResidentBytes, stats.residentBytes);
+      }
+      lru.push_front(ptr);
+      entry.lruPos = lru.begin();
+    }
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+
+  void printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "\nResidency: budget " << budget << " B, resident "
+              << stats.residentBytes << " B (peak "
+              << stats.peakResidentBytes << " B), prepares " << stats.prepares
+              << ", hits " << stats.hits << ", made resident "
+              << stats.makeResident << ", evictions " << stats.evictions
+              << std::endl;
+  }
+
+private:
+  struct Entry {
+    size_t size = 0;
+    bool resident = false;
+    std::list<void *>::iterator lruPos;
+  };
+
+  // Evict from the LRU tail until `incoming` more bytes fit in the budget.
+  // A single buffer larger than the budget is still made resident.
+  void makeRoom(size_t incoming, const std::unordered_set<void *> &keep) {
+    auto it = lru.end();
+    while (stats.residentBytes + incoming > budget && it != lru.begin()) {
+      --it;
+      if (keep.count(*it))
+        continue;
+      void *victim = *it;
+      it = lru.erase(it);
+      evictLocked(victim, entries[victim]);
+    }
+  }
+
+  void evictLocked(void *ptr, Entry &entry) {
+    ZE_CHECK(zeContextEvictMemory(context, device, ptr, entry.size));
+    entry.resident = false;
+    stats.evictions++;
+    stats.residentBytes -= entry.size;
+  }
+
+  ze_context_handle_t context;
+  ze_device_handle_t device;
+  size_t budget;
+  std::mutex mutex;
+  std::unordered_map<void *, Entry> entries;
+  std::list<void *> lru; // most recently prepared first
+  Stats stats;
+};
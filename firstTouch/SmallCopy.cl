@@ -0,0 +1,7 @@
+// Byte copy for transfers too small to be worth the copy engine. A single
+// work-item writes straight into the (host) destination.
+__kernel void copyBytes(__global const uchar *src, __global uchar *dst,
+                        uint bytes) {
+  for (uint i = 0; i < bytes; i++)
+    dst[i] = src[i];
+}
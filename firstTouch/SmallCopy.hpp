@@ -0,0 +1,146 @@
+// Read-back path for values of a few bytes.
+//
+// A 4-8 byte read through zeCommandListAppendMemoryCopy pays for a full copy
+// engine submission. SmallCopy::read() picks the cheapest path by source:
+//   host, shared or pageable source - wait for `ready`, then memcpy on the host
+//   device source up to threshold   - copyBytes kernel on the compute engine
+//                                     writes straight into pinned host memory
+//   larger device source            - regular copy on the copy engine
+// The threshold is a constructor argument. It defaults to SMALL_COPY_THRESHOLD
+// (bytes) when that is set, else 1024; smallCopy measures the crossover on
+// the current device and prints the value to export. Include
+// StagingAllocator.hpp first.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "ze_api.h"
+
+class SmallCopy {
+public:
+  static constexpr size_t kDefaultThreshold = 1024;
+
+  enum class Path { Direct, Kernel, CopyEngine };
+
+  // SMALL_COPY_THRESHOLD if it holds a byte count, else kDefaultThreshold
+  static size_t defaultThreshold() {
+    const char *env = getenv("SMALL_COPY_THRESHOLD");
+    if (!env || !*env)
+      return kDefaultThreshold;
+    char *end = nullptr;
+    unsigned long long bytes = strtoull(env, &end, 10);
+    return *end || *env == '-' ? kDefaultThreshold : size_t(bytes);
+  }
+
+  SmallCopy(ze_context_handle_t context, ze_device_handle_t device,
+            ze_module_handle_t module, size_t threshold = defaultThreshold())
+      : context(context), threshold(threshold), staging(context) {
+    ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+    kernelDesc.pKernelName = "copyBytes";
+    ZE_CHECK(zeKernelCreate(module, &kernelDesc, &kernel));
+    ZE_CHECK(zeKernelSetGroupSize(kernel, 1, 1, 1));
+
+    uint32_t computeOrdinal = 0;
+    findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                     computeOrdinal);
+    uint32_t copyOrdinal = computeOrdinal;
+    findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY,
+                     ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, copyOrdinal);
+    computeList = createImmediateList(context, device, computeOrdinal);
+    copyList = createImmediateList(context, device, copyOrdinal);
+
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+    ZE_CHECK(
+        zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                 ZE_EVENT_SCOPE_FLAG_HOST,
+                                 ZE_EVENT_SCOPE_FLAG_HOST};
+    ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &done));
+    slot = staging.alloc(threshold);
+  }
+
+  // Must run before the module and the context are destroyed
+  void release() {
+    staging.free(slot);
+    staging.release();
+    ZE_CHECK(zeEventDestroy(done));
+    ZE_CHECK(zeEventPoolDestroy(eventPool));
+    ZE_CHECK(zeCommandListDestroy(computeList));
+    ZE_CHECK(zeCommandListDestroy(copyList));
+    ZE_CHECK(zeKernelDestroy(kernel));
+  }
+
+  // Path read() would take for this source and size
+  Path choose(const void *src, size_t bytes) {
+    ze_memory_allocation_properties_t props = {
+        ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES};
+    ZE_CHECK(zeMemGetAllocProperties(context, src, &props, nullptr));
+    if (props.type != ZE_MEMORY_TYPE_DEVICE)
+      return Path::Direct;
+    return bytes <= threshold ? Path::Kernel : Path::CopyEngine;
+  }
+
+  // Copy `bytes` from `src` to host memory `dst` once `ready` (may be
+  // nullptr) has signaled. Returns after the data has arrived in `dst`.
+  void read(void *dst, const void *src, size_t bytes,
+            ze_event_handle_t ready = nullptr) {
+    read(choose(src, bytes), dst, src, bytes, ready);
+  }
+
+  // Same, with the path forced; used by smallCopy to find the threshold
+  void read(Path path, void *dst, const void *src, size_t bytes,
+            ze_event_handle_t ready = nullptr) {
+    uint32_t numWait = ready ? 1 : 0;
+    ze_event_handle_t *wait = ready ? &ready : nullptr;
+    switch (path) {
+    case Path::Direct:
+      if (ready)
+        ZE_CHECK(zeEventHostSynchronize(ready,
+                                        std::numeric_limits<uint64_t>::max()));
+      memcpy(dst, src, bytes);
+      return;
+    case Path::Kernel: {
+      if (bytes > threshold) {
+        std::cout << "SmallCopy: kernel path is limited to " << threshold
+                  << " bytes, got " << bytes << std::endl;
+        std::terminate();
+      }
+      uint32_t count = static_cast<uint32_t>(bytes);
+      ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(src), &src));
+      ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(slot), &slot));
+      ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(count), &count));
+      ze_group_count_t dispatch = {1, 1, 1};
+      ZE_CHECK(zeCommandListAppendLaunchKernel(computeList, kernel, &dispatch,
+                                               done, numWait, wait));
+      sync();
+      memcpy(dst, slot, bytes);
+      return;
+    }
+    case Path::CopyEngine:
+      ZE_CHECK(zeCommandListAppendMemoryCopy(copyList, dst, src, bytes, done,
+                                             numWait, wait));
+      sync();
+      return;
+    }
+  }
+
+private:
+  void sync() {
+    ZE_CHECK(zeEventHostSynchronize(done, std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(done));
+  }
+
+  ze_context_handle_t context;
+  size_t threshold;
+  StagingAllocator staging;
+  void *slot = nullptr; // pinned landing zone of the kernel path
+  ze_kernel_handle_t kernel = nullptr;
+  ze_command_list_handle_t computeList = nullptr;
+  ze_command_list_handle_t copyList = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t done = nullptr;
+};
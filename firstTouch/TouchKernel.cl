@@ -0,0 +1,18 @@
+// Write one int per page of `a`, so every page of the buffer is touched once
+__kernel void touchPages(__global int *a, uint intsPerPage, uint numPages) {
+  size_t page = get_global_id(0);
+  if (page < numPages)
+    a[page * intsPerPage] = 1;
+}
+
+// Add up the first `words` uints of a chunk into sums[slot], 1024 per
+// work-item: the per-chunk compute stage of streamCopy
+__kernel void sumChunk(__global const uint *src, uint words,
+                       __global uint *sums, uint slot) {
+  size_t first = get_global_id(0) * 1024;
+  size_t last = min(first + 1024, (size_t)words);
+  uint sum = 0;
+  for (size_t i = first; i < last; i++)
+    sum += src[i];
+  atomic_add(&sums[slot], sum);
+}
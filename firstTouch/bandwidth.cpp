@@ -0,0 +1,249 @@
+// Host<->device bandwidth and latency sweep.
+//
+// For every source/destination pair of {pageable, host, shared, device}
+// memory, every engine ({compute, copy} x {immediate, regular list}) and
+// power-of-four sizes from 4 B up to maxSizeMB, time one
+// zeCommandListAppendMemoryCopy. Regular lists are recorded once per size and
+// re-executed, so their numbers include queue submission but not recording.
+//
+// Output is CSV (one curve per src,dst,engine) on stdout:
+//   src,dst,engine,bytes,latency_us,GBps
+// latency_us is the median wall time of one copy, GBps is bytes / latency.
+//
+// Usage: ./bandwidth [maxSizeMB=4096] [repetitions=20]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "ze_api.h"
+
+enum class MemKind { Pageable, Host, Shared, Device };
+
+const char *memKindName(MemKind kind) {
+  switch (kind) {
+  case MemKind::Pageable:
+    return "pageable";
+  case MemKind::Host:
+    return "host";
+  case MemKind::Shared:
+    return "shared";
+  case MemKind::Device:
+    return "device";
+  }
+  return "";
+}
+
+struct Engine {
+  std::string name;
+  uint32_t ordinal;
+  bool immediate;
+};
+
+void *allocMem(ze_context_handle_t context, ze_device_handle_t device,
+               MemKind kind, size_t bytes) {
+  ze_device_mem_alloc_desc_t deviceDesc = {
+      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+  void *ptr = nullptr;
+  switch (kind) {
+  case MemKind::Pageable:
+    ptr = std::aligned_alloc(4096, (bytes + 4095) / 4096 * 4096);
+    // Back every page now so the first timed copy doesn't fault them in
+    memset(ptr, 1, bytes);
+    break;
+  case MemKind::Host:
+    ZE_CHECK(zeMemAllocHost(context, &hostDesc, bytes, 4096, &ptr));
+    memset(ptr, 1, bytes);
+    break;
+  case MemKind::Shared:
+    ZE_CHECK(zeMemAllocShared(context, &deviceDesc, &hostDesc, bytes, 4096,
+                              device, &ptr));
+    memset(ptr, 1, bytes);
+    break;
+  case MemKind::Device:
+    ZE_CHECK(
+        zeMemAllocDevice(context, &deviceDesc, bytes, 4096, device, &ptr));
+    break;
+  }
+  return ptr;
+}
+
+void freeMem(ze_context_handle_t context, MemKind kind, void *ptr) {
+  if (kind == MemKind::Pageable)
+    std::free(ptr);
+  else
+    ZE_CHECK(zeMemFree(context, ptr));
+}
+
+// Times copies of one size on one engine. Immediate lists signal an event
+// per copy; regular lists are closed once and re-executed on their queue.
+class CopyTimer {
+public:
+  CopyTimer(ze_context_handle_t context, ze_device_handle_t device,
+            const Engine &engine)
+      : immediate(engine.immediate) {
+    ze_command_queue_desc_t cmdQueueDesc = {
+        ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+    cmdQueueDesc.ordinal = engine.ordinal;
+    cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    if (immediate) {
+      ZE_CHECK(zeCommandListCreateImmediate(context, device, &cmdQueueDesc,
+                                            &cmdList));
+      ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                            nullptr,
+                                            ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+      ZE_CHECK(
+          zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+      ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                   ZE_EVENT_SCOPE_FLAG_HOST,
+                                   ZE_EVENT_SCOPE_FLAG_HOST};
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &event));
+    } else {
+      ZE_CHECK(
+          zeCommandQueueCreate(context, device, &cmdQueueDesc, &cmdQueue));
+      ze_command_list_desc_t cmdListDesc = {
+          ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC};
+      cmdListDesc.commandQueueGroupOrdinal = engine.ordinal;
+      ZE_CHECK(zeCommandListCreate(context, device, &cmdListDesc, &cmdList));
+    }
+  }
+
+  ~CopyTimer() {
+    if (immediate) {
+      zeEventDestroy(event);
+      zeEventPoolDestroy(eventPool);
+    } else {
+      zeCommandQueueDestroy(cmdQueue);
+    }
+    zeCommandListDestroy(cmdList);
+  }
+
+  // Median wall time of one copy in microseconds, after one warm-up copy
+  double time(void *dst, const void *src, size_t bytes, int repetitions) {
+    if (!immediate) {
+      ZE_CHECK(zeCommandListReset(cmdList));
+      ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, dst, src, bytes, nullptr,
+                                             0, nullptr));
+      ZE_CHECK(zeCommandListClose(cmdList));
+    }
+    std::vector<double> samples;
+    for (int i = 0; i <= repetitions; i++) {
+      auto begin = std::chrono::steady_clock::now();
+      copy(dst, src, bytes);
+      auto end = std::chrono::steady_clock::now();
+      if (i > 0)
+        samples.push_back(
+            std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                     samples.end());
+    return samples[samples.size() / 2];
+  }
+
+private:
+  void copy(void *dst, const void *src, size_t bytes) {
+    if (immediate) {
+      ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, dst, src, bytes, event,
+                                             0, nullptr));
+      ZE_CHECK(
+          zeEventHostSynchronize(event, std::numeric_limits<uint64_t>::max()));
+      ZE_CHECK(zeEventHostReset(event));
+    } else {
+      ZE_CHECK(zeCommandQueueExecuteCommandLists(cmdQueue, 1, &cmdList,
+                                                 nullptr));
+      ZE_CHECK(zeCommandQueueSynchronize(cmdQueue,
+                                         std::numeric_limits<uint64_t>::max()));
+    }
+  }
+
+  bool immediate;
+  ze_command_queue_handle_t cmdQueue = nullptr;
+  ze_command_list_handle_t cmdList = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t event = nullptr;
+};
+
+int main(int argc, char **argv) {
+  long maxSizeMB = argc > 1 ? std::atol(argv[1]) : 4096;
+  int maxRepetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+  // Every buffer is sized for the largest copy, so there must be at least one
+  if (maxSizeMB < 1 || maxRepetitions < 1) {
+    std::cerr << "Usage: " << argv[0] << " [maxSizeMB=4096] [repetitions=20]\n";
+    return 1;
+  }
+  size_t maxSize = size_t(maxSizeMB) << 20;
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+
+  ze_device_properties_t deviceProperties = {
+      ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
+  ZE_CHECK(zeDeviceGetProperties(device, &deviceProperties));
+  if (maxSize > deviceProperties.maxMemAllocSize) {
+    maxSize = deviceProperties.maxMemAllocSize;
+    std::cerr << "Clamping max size to maxMemAllocSize = " << maxSize
+              << " bytes\n";
+  }
+
+  std::vector<Engine> engines;
+  uint32_t computeOrdinal = 0;
+  findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                   computeOrdinal);
+  engines.push_back({"compute-imm", computeOrdinal, true});
+  engines.push_back({"compute-reg", computeOrdinal, false});
+  uint32_t copyOrdinal = 0;
+  if (findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY,
+                       ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE,
+                       copyOrdinal)) {
+    engines.push_back({"copy-imm", copyOrdinal, true});
+    engines.push_back({"copy-reg", copyOrdinal, false});
+  } else {
+    std::cerr << "No dedicated copy engine, skipping copy-* engines\n";
+  }
+
+  std::vector<size_t> sizes;
+  for (size_t size = 4; size <= maxSize; size *= 4)
+    sizes.push_back(size);
+
+  const MemKind kinds[] = {MemKind::Pageable, MemKind::Host, MemKind::Shared,
+                           MemKind::Device};
+  std::cout << "src,dst,engine,bytes,latency_us,GBps\n";
+  for (MemKind src : kinds) {
+    for (MemKind dst : kinds) {
+      // Pageable to pageable never touches the device
+      if (src == MemKind::Pageable && dst == MemKind::Pageable)
+        continue;
+      // One pair of buffers per src/dst combination keeps the footprint at
+      // 2 x maxSize
+      void *srcBuf = allocMem(context, device, src, sizes.back());
+      void *dstBuf = allocMem(context, device, dst, sizes.back());
+      for (const Engine &engine : engines) {
+        CopyTimer timer(context, device, engine);
+        for (size_t size : sizes) {
+          // Fewer repetitions once a copy moves more than 64 MB
+          int repetitions = static_cast<int>(std::max<size_t>(
+              3, std::min<size_t>(maxRepetitions, (64 << 20) / size)));
+          double us = timer.time(dstBuf, srcBuf, size, repetitions);
+          std::cout << memKindName(src) << "," << memKindName(dst) << ","
+                    << engine.name << "," << size << "," << us << ","
+                    << size / us / 1e3 << std::endl;
+        }
+      }
+      freeMem(context, src, srcBuf);
+      freeMem(context, dst, dstBuf);
+    }
+  }
+
+  ZE_CHECK(zeContextDestroy(context));
+  return 0;
+}
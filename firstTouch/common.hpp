@@ -1,3 +1,10 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "ze_api.h"
+
 #define ZE_CHECK(myZeCall)                                            \
   if (myZeCall != ZE_RESULT_SUCCESS) {                                    \
     std::cout << "Error at " << #myZeCall << ": " << __FUNCTION__ << ": " \
@@ -6,3 +13,98 @@
               << "0x" << std::hex << myZeCall << std::dec << std::endl;   \
     std::terminate();                                                     \
   }
+
+// Ordinal of the first queue group that has all of `required` and none of
+// `excluded` flags, e.g. a dedicated copy engine is
+// findQueueOrdinal(device, COPY, COMPUTE). Returns false if there is none.
+bool findQueueOrdinal(ze_device_handle_t device,
+                      ze_command_queue_group_property_flags_t required,
+                      ze_command_queue_group_property_flags_t excluded,
+                      uint32_t &ordinal) {
+  uint32_t numQueueGroups = 0;
+  ZE_CHECK(
+      zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups, nullptr));
+  std::vector<ze_command_queue_group_properties_t> queueProperties(
+      numQueueGroups);
+  for (auto &props : queueProperties)
+    props.stype = ZE_STRUCTURE_TYPE_COMMAND_QUEUE_GROUP_PROPERTIES;
+  ZE_CHECK(zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups,
+                                                  queueProperties.data()));
+  for (uint32_t i = 0; i < numQueueGroups; i++) {
+    if ((queueProperties[i].flags & required) == required &&
+        !(queueProperties[i].flags & excluded)) {
+      ordinal = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Immediate command list on the given queue group ordinal
+ze_command_list_handle_t createImmediateList(ze_context_handle_t context,
+                                             ze_device_handle_t device,
+                                             uint32_t ordinal) {
+  ze_command_queue_desc_t cmdQueueDesc = {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+  cmdQueueDesc.ordinal = ordinal;
+  cmdQueueDesc.index = 0;
+  cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+  ze_command_list_handle_t cmdList;
+  ZE_CHECK(
+      zeCommandListCreateImmediate(context, device, &cmdQueueDesc, &cmdList));
+  return cmdList;
+}
+
+// zeInit, first driver, first device and a context on it
+void initLevelZero(ze_driver_handle_t &driverHandle, ze_device_handle_t &device,
+                   ze_context_handle_t &context) {
+  ZE_CHECK(zeInit(ZE_INIT_FLAG_GPU_ONLY));
+
+  uint32_t driverCount = 1;
+  ZE_CHECK(zeDriverGet(&driverCount, &driverHandle));
+
+  ze_context_desc_t contextDescription = {};
+  contextDescription.stype = ZE_STRUCTURE_TYPE_CONTEXT_DESC;
+  ZE_CHECK(zeContextCreate(driverHandle, &contextDescription, &context));
+
+  uint32_t deviceCount = 1;
+  ZE_CHECK(zeDeviceGet(driverHandle, &deviceCount, &device));
+
+  ze_device_properties_t deviceProperties = {
+      ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
+  ZE_CHECK(zeDeviceGetProperties(device, &deviceProperties));
+  std::cout << "Device   : " << deviceProperties.name << "\n";
+}
+
+// Build a SPIR-V module from `spvFile`, printing the build log on failure
+ze_module_handle_t loadModule(ze_context_handle_t context,
+                              ze_device_handle_t device,
+                              const char *spvFile) {
+  std::ifstream file(spvFile, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << spvFile << " not found\n";
+    std::terminate();
+  }
+  std::vector<char> spirv((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+
+  ze_module_desc_t moduleDesc = {ZE_STRUCTURE_TYPE_MODULE_DESC};
+  moduleDesc.format = ZE_MODULE_FORMAT_IL_SPIRV;
+  moduleDesc.pInputModule = reinterpret_cast<const uint8_t *>(spirv.data());
+  moduleDesc.inputSize = spirv.size();
+  moduleDesc.pBuildFlags = "";
+
+  ze_module_handle_t module = nullptr;
+  ze_module_build_log_handle_t buildLog;
+  if (zeModuleCreate(context, device, &moduleDesc, &module, &buildLog) !=
+      ZE_RESULT_SUCCESS) {
+    size_t szLog = 0;
+    zeModuleBuildLogGetString(buildLog, &szLog, nullptr);
+    std::vector<char> log(szLog);
+    zeModuleBuildLogGetString(buildLog, &szLog, log.data());
+    std::cout << "zeModuleCreate failed: Build log: " << log.data()
+              << std::endl;
+    std::abort();
+  }
+  ZE_CHECK(zeModuleBuildLogDestroy(buildLog));
+  return module;
+}
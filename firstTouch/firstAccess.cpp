@@ -0,0 +1,287 @@
+// First-access latency of fresh allocations.
+//
+// main.cpp only passes when a host copy touches the device buffer before the
+// kernel does. This harness measures that one-time cost directly: for each
+// allocation type, size, access origin and residency hint it allocates a fresh
+// buffer straight from the driver (not through UsmPool, which would hand back
+// already-touched memory), applies the hint, times the first full access and
+// then the median of `steadyRuns` repeated accesses.
+//
+// Origins: kernel - touchPages writes one int per 4 KB page
+//          copy   - zeCommandListAppendMemoryCopy from a warm pinned buffer
+//          host   - memset on the host (host and shared allocations only)
+// Hints:   none, resident (zeContextMakeMemoryResident), and for shared
+//          allocations prefetch (zeCommandListAppendMemoryPrefetch) and
+//          advise (preferred location = device)
+//
+// Output is CSV on stdout:
+//   type,bytes,origin,hint,alloc_us,hint_us,first_us,steady_us,penalty_us
+//
+// Usage: ./firstAccess [steadyRuns=10] [sizeKB ...]
+//        default sizes 4 KB, 64 KB, 1 MB, 16 MB, 256 MB
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "UsmPool.hpp"
+#include "ze_api.h"
+
+enum class Origin { Kernel, Copy, Host };
+enum class Hint { None, Resident, Prefetch, Advise };
+
+const char *originName(Origin origin) {
+  switch (origin) {
+  case Origin::Kernel:
+    return "kernel";
+  case Origin::Copy:
+    return "copy";
+  case Origin::Host:
+    return "host";
+  }
+  return "";
+}
+
+const char *hintName(Hint hint) {
+  switch (hint) {
+  case Hint::None:
+    return "none";
+  case Hint::Resident:
+    return "resident";
+  case Hint::Prefetch:
+    return "prefetch";
+  case Hint::Advise:
+    return "advise";
+  }
+  return "";
+}
+
+constexpr uint32_t kPageSize = 4096;
+
+double elapsedUs(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+class FirstAccess {
+public:
+  FirstAccess(ze_context_handle_t context, ze_device_handle_t device,
+              ze_kernel_handle_t touchKernel, size_t maxBytes)
+      : context(context), device(device), touchKernel(touchKernel) {
+    uint32_t ordinal = 0;
+    findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                     ordinal);
+    cmdList = createImmediateList(context, device, ordinal);
+
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+    ZE_CHECK(
+        zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                 ZE_EVENT_SCOPE_FLAG_HOST,
+                                 ZE_EVENT_SCOPE_FLAG_HOST};
+    ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &done));
+
+    // Copy source, touched up front so only the destination is cold
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+    ZE_CHECK(zeMemAllocHost(context, &hostDesc, maxBytes, kPageSize, &pinned));
+    memset(pinned, 0, maxBytes);
+
+    // The first copy and the first launch of touchPages pay for engine setup,
+    // JIT and kernel residency; keep that out of the first-touch numbers. The
+    // copy goes to a scratch buffer: `pinned` is also the source.
+    void *scratch = allocate(UsmType::Device, kPageSize);
+    access(UsmType::Device, Origin::Copy, scratch, kPageSize);
+    access(UsmType::Device, Origin::Kernel, scratch, kPageSize);
+    ZE_CHECK(zeMemFree(context, scratch));
+  }
+
+  ~FirstAccess() {
+    zeMemFree(context, pinned);
+    zeEventDestroy(done);
+    zeEventPoolDestroy(eventPool);
+    zeCommandListDestroy(cmdList);
+  }
+
+  static bool supported(UsmType type, Origin origin, Hint hint) {
+    if (origin == Origin::Host && type == UsmType::Device)
+      return false;
+    if ((hint == Hint::Prefetch || hint == Hint::Advise) &&
+        type != UsmType::Shared)
+      return false;
+    return true;
+  }
+
+  void run(UsmType type, size_t bytes, Origin origin, Hint hint,
+           int steadyRuns) {
+    auto begin = std::chrono::steady_clock::now();
+    void *ptr = allocate(type, bytes);
+    double allocUs = elapsedUs(begin);
+
+    begin = std::chrono::steady_clock::now();
+    applyHint(hint, ptr, bytes);
+    double hintUs = elapsedUs(begin);
+
+    begin = std::chrono::steady_clock::now();
+    access(type, origin, ptr, bytes);
+    double firstUs = elapsedUs(begin);
+
+    std::vector<double> steady;
+    for (int i = 0; i < steadyRuns; i++) {
+      begin = std::chrono::steady_clock::now();
+      access(type, origin, ptr, bytes);
+      steady.push_back(elapsedUs(begin));
+    }
+    std::nth_element(steady.begin(), steady.begin() + steady.size() / 2,
+                     steady.end());
+    double steadyUs = steady[steady.size() / 2];
+    ZE_CHECK(zeMemFree(context, ptr));
+
+    std::cout << usmTypeName(type) << "," << bytes << "," << originName(origin)
+              << "," << hintName(hint) << "," << allocUs << "," << hintUs
+              << "," << firstUs << "," << steadyUs << ","
+              << firstUs - steadyUs << std::endl;
+  }
+
+private:
+  void *allocate(UsmType type, size_t bytes) {
+    ze_device_mem_alloc_desc_t deviceDesc = {
+        ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+    ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+    void *ptr = nullptr;
+    switch (type) {
+    case UsmType::Host:
+      ZE_CHECK(zeMemAllocHost(context, &hostDesc, bytes, kPageSize, &ptr));
+      break;
+    case UsmType::Device:
+      ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, bytes, kPageSize, device,
+                                &ptr));
+      break;
+    case UsmType::Shared:
+      ZE_CHECK(zeMemAllocShared(context, &deviceDesc, &hostDesc, bytes,
+                                kPageSize, device, &ptr));
+      break;
+    }
+    return ptr;
+  }
+
+  void applyHint(Hint hint, void *ptr, size_t bytes) {
+    switch (hint) {
+    case Hint::None:
+      return;
+    case Hint::Resident:
+      ZE_CHECK(zeContextMakeMemoryResident(context, device, ptr, bytes));
+      return;
+    case Hint::Prefetch:
+      ZE_CHECK(zeCommandListAppendMemoryPrefetch(cmdList, ptr, bytes));
+      break;
+    case Hint::Advise:
+      ZE_CHECK(zeCommandListAppendMemAdvise(
+          cmdList, device, ptr, bytes,
+          ZE_MEMORY_ADVICE_SET_PREFERRED_LOCATION));
+      break;
+    }
+    ZE_CHECK(zeCommandListAppendBarrier(cmdList, done, 0, nullptr));
+    wait();
+  }
+
+  void access(UsmType type, Origin origin, void *ptr, size_t bytes) {
+    switch (origin) {
+    case Origin::Host:
+      memset(ptr, 1, bytes);
+      return;
+    case Origin::Copy:
+      ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, ptr, pinned, bytes, done,
+                                             0, nullptr));
+      break;
+    case Origin::Kernel: {
+      uint32_t intsPerPage = kPageSize / sizeof(int);
+      uint32_t numPages = uint32_t((bytes + kPageSize - 1) / kPageSize);
+      uint32_t groupSizeX = 1u;
+      uint32_t groupSizeY = 1u;
+      uint32_t groupSizeZ = 1u;
+      ZE_CHECK(zeKernelSuggestGroupSize(touchKernel, numPages, 1U, 1U,
+                                        &groupSizeX, &groupSizeY,
+                                        &groupSizeZ));
+      ZE_CHECK(zeKernelSetGroupSize(touchKernel, groupSizeX, 1, 1));
+      ZE_CHECK(zeKernelSetArgumentValue(touchKernel, 0, sizeof(ptr), &ptr));
+      ZE_CHECK(zeKernelSetArgumentValue(touchKernel, 1, sizeof(uint32_t),
+                                        &intsPerPage));
+      ZE_CHECK(zeKernelSetArgumentValue(touchKernel, 2, sizeof(uint32_t),
+                                        &numPages));
+      ze_group_count_t dispatch = {(numPages + groupSizeX - 1) / groupSizeX, 1,
+                                   1};
+      ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, touchKernel, &dispatch,
+                                               done, 0, nullptr));
+      break;
+    }
+    }
+    wait();
+  }
+
+  void wait() {
+    ZE_CHECK(zeEventHostSynchronize(done, std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(done));
+  }
+
+  ze_context_handle_t context;
+  ze_device_handle_t device;
+  ze_kernel_handle_t touchKernel;
+  ze_command_list_handle_t cmdList = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t done = nullptr;
+  void *pinned = nullptr;
+};
+
+int main(int argc, char **argv) {
+  int steadyRuns = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+  std::vector<size_t> sizes;
+  for (int i = 2; i < argc; i++)
+    sizes.push_back(size_t(std::atol(argv[i])) << 10);
+  if (sizes.empty())
+    sizes = {4 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20};
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+
+  ze_module_handle_t module = loadModule(context, device, "TouchKernel.spv");
+  ze_kernel_handle_t touchKernel;
+  ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+  kernelDesc.pKernelName = "touchPages";
+  ZE_CHECK(zeKernelCreate(module, &kernelDesc, &touchKernel));
+
+  {
+    FirstAccess harness(context, device, touchKernel,
+                        *std::max_element(sizes.begin(), sizes.end()));
+    const UsmType types[] = {UsmType::Host, UsmType::Shared, UsmType::Device};
+    const Origin origins[] = {Origin::Kernel, Origin::Copy, Origin::Host};
+    const Hint hints[] = {Hint::None, Hint::Resident, Hint::Prefetch,
+                          Hint::Advise};
+
+    std::cout << "type,bytes,origin,hint,alloc_us,hint_us,first_us,steady_us,"
+                 "penalty_us\n";
+    for (UsmType type : types)
+      for (size_t bytes : sizes)
+        for (Origin origin : origins)
+          for (Hint hint : hints)
+            if (FirstAccess::supported(type, origin, hint))
+              harness.run(type, bytes, origin, hint, steadyRuns);
+  }
+
+  ZE_CHECK(zeKernelDestroy(touchKernel));
+  ZE_CHECK(zeModuleDestroy(module));
+  ZE_CHECK(zeContextDestroy(context));
+  return 0;
+}
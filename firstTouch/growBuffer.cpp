@@ -0,0 +1,160 @@
+// Incremental ingest into a device buffer that keeps growing.
+//
+// `totalMB` of host data arrives in `stepMB` appends. The realloc variant is
+// what the drivers do today when a buffer outgrows its fixed allocSize:
+// allocate the new size, copy the old contents over and free the old buffer.
+// The growable variant appends into a GrowableBuffer, which maps more
+// physical pages behind the same pointer. Both results are read back and
+// compared with the host data.
+//
+// Usage: ./growBuffer [totalMB=1024] [stepMB=16]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "GrowableBuffer.hpp"
+#include "ze_api.h"
+
+int main(int argc, char **argv) {
+  long totalMB = argc > 1 ? std::atol(argv[1]) : 1024;
+  long stepMB = argc > 2 ? std::atol(argv[2]) : 16;
+  if (totalMB < 1 || stepMB < 1) {
+    std::cout << "Usage: " << argv[0] << " [totalMB=1024] [stepMB=16]\n";
+    return 1;
+  }
+  size_t total = size_t(totalMB) << 20;
+  size_t step = size_t(stepMB) << 20;
+  size_t numSteps = (total + step - 1) / step;
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+
+  uint32_t ordinal = 0;
+  findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                   ordinal);
+  ze_command_list_handle_t cmdList =
+      createImmediateList(context, device, ordinal);
+  ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                        nullptr,
+                                        ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+  ze_event_pool_handle_t eventPool;
+  ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+  ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                               ZE_EVENT_SCOPE_FLAG_HOST,
+                               ZE_EVENT_SCOPE_FLAG_HOST};
+  ze_event_handle_t done;
+  ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &done));
+
+  auto copy = [&](void *dst, const void *src, size_t bytes) {
+    ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, dst, src, bytes, done, 0,
+                                           nullptr));
+    ZE_CHECK(zeEventHostSynchronize(done, std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(done));
+  };
+
+  // Pinned source so the copies measure the device side, not bounce buffers
+  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+  ze_device_mem_alloc_desc_t deviceDesc = {
+      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+  void *input = nullptr;
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, total, 4096, &input));
+  for (size_t i = 0; i < total / sizeof(int); i++)
+    static_cast<int *>(input)[i] = static_cast<int>(i);
+  std::unique_ptr<char[]> readBack(new char[total]);
+
+  auto appendSize = [&](size_t s) { return std::min(step, total - s * step); };
+
+  std::cout << "\n"
+            << std::left << std::setw(10) << "variant" << std::right
+            << std::setw(12) << "total [ms]" << std::setw(16)
+            << "max append [ms]" << std::setw(12) << "allocs/maps"
+            << std::setw(10) << "moved" << std::setw(8) << "valid"
+            << std::endl;
+  auto report = [&](const char *name, double totalMs, double maxMs,
+                    size_t mappings, bool moved, const void *result) {
+    copy(readBack.get(), result, total);
+    bool valid = memcmp(readBack.get(), input, total) == 0;
+    std::cout << std::left << std::setw(10) << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(12)
+              << totalMs << std::setw(16) << maxMs << std::setw(12)
+              << mappings << std::setw(10) << (moved ? "yes" : "no")
+              << std::setw(8) << (valid ? "PASS" : "FAIL") << std::endl;
+    return valid;
+  };
+
+  // Allocate new, copy old, free old on every append
+  void *buffer = nullptr;
+  void *firstPtr = nullptr;
+  size_t size = 0;
+  double totalMs = 0, maxMs = 0;
+  for (size_t s = 0; s < numSteps; s++) {
+    auto begin = std::chrono::steady_clock::now();
+    size_t bytes = appendSize(s);
+    void *grown = nullptr;
+    ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, size + bytes, 4096, device,
+                              &grown));
+    if (buffer) {
+      copy(grown, buffer, size);
+      ZE_CHECK(zeMemFree(context, buffer));
+    }
+    buffer = grown;
+    if (!firstPtr)
+      firstPtr = buffer;
+    copy(static_cast<char *>(buffer) + size,
+         static_cast<char *>(input) + size, bytes);
+    size += bytes;
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+  }
+  bool valid = report("realloc", totalMs, maxMs, numSteps, buffer != firstPtr,
+                      buffer);
+  ZE_CHECK(zeMemFree(context, buffer));
+
+  // Grow in place behind a fixed virtual address range
+  {
+    GrowableBuffer growable(context, device, total);
+    firstPtr = growable.data();
+    size = 0;
+    totalMs = maxMs = 0;
+    for (size_t s = 0; s < numSteps; s++) {
+      auto begin = std::chrono::steady_clock::now();
+      size_t bytes = appendSize(s);
+      if (!growable.ensureCapacity(size + bytes)) {
+        std::cout << "GrowableBuffer cannot grow to " << size + bytes
+                  << " bytes\n";
+        std::abort();
+      }
+      copy(static_cast<char *>(growable.data()) + size,
+           static_cast<char *>(input) + size, bytes);
+      size += bytes;
+      double ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - begin)
+                      .count();
+      totalMs += ms;
+      maxMs = std::max(maxMs, ms);
+    }
+    valid &= report("growable", totalMs, maxMs, growable.numMappings(),
+                    growable.data() != firstPtr, growable.data());
+    growable.release();
+  }
+
+  ZE_CHECK(zeMemFree(context, input));
+  ZE_CHECK(zeEventDestroy(done));
+  ZE_CHECK(zeEventPoolDestroy(eventPool));
+  ZE_CHECK(zeCommandListDestroy(cmdList));
+  ZE_CHECK(zeContextDestroy(context));
+  return valid ? 0 : 1;
+}
@@ -3,21 +3,56 @@
 //      https://github.com/intel/compute-runtime/blob/master/level_zero/core/test/black_box_tests/zello_world_gpu.cpp
 
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "common.hpp"
+#include "ResidencyManager.hpp"
+#include "StagingAllocator.hpp"
+#include "SmallCopy.hpp"
+#include "UsmPool.hpp"
 #include "ze_api.h"
 
 struct Data {
   int *A_d;
 } typedef Data;
 
+// By default this is the plain reproducer: a zeMemAllocDevice buffer whose
+// first touch is the copy below, with pageable host memory on the other side.
+// --managed allocates through UsmPool, pre-faults with ResidencyManager and
+// copies through StagingAllocator's pinned buffers instead; all three change
+// how the memory is first touched and so hide what is reproduced here.
+//
+// The result is read back with a copy and a barrier, as in the original;
+// --small-copy reads it through SmallCopy instead.
+//
+// Usage: ./driver [--managed] [--budget=MB] [--small-copy]
 int main(int argc, char **argv) {
+  bool managed = false;
+  bool smallCopyPath = false;
+  size_t residencyBudget = size_t(256) << 20;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--managed") {
+      managed = true;
+    } else if (arg == "--small-copy") {
+      smallCopyPath = true;
+    } else if (arg.compare(0, 9, "--budget=") == 0 &&
+               std::atol(arg.c_str() + 9) > 0) {
+      residencyBudget = size_t(std::atol(arg.c_str() + 9)) << 20;
+    } else {
+      std::cout << "Usage: " << argv[0]
+                << " [--managed] [--budget=MB] [--small-copy]\n";
+      return 1;
+    }
+  }
+
   std::cout << "Using immediate command list\n";
   // Initialization
   ZE_CHECK(zeInit(ZE_INIT_FLAG_GPU_ONLY));
@@ -90,17 +125,35 @@ int main(int argc, char **argv) {
   // Create two buffers
   constexpr size_t allocSize =  1 * sizeof(Data);
 
-  ze_device_mem_alloc_desc_t memAllocDesc = {
-      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
-  memAllocDesc.ordinal = 0;
-
+  UsmPool pool(context, device);
   void *sharedA = nullptr;
-  ZE_CHECK(zeMemAllocDevice(context, &memAllocDesc, allocSize, 1,
-                                device, &sharedA));
+  if (managed) {
+    sharedA = pool.alloc(UsmType::Device, allocSize);
+  } else {
+    ze_device_mem_alloc_desc_t memAllocDesc = {
+        ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+    memAllocDesc.ordinal = 0;
+    ZE_CHECK(zeMemAllocDevice(context, &memAllocDesc, allocSize, 1,
+                                  device, &sharedA));
+  }
+
+  // With --managed, pre-fault the buffer before the kernel launch instead of
+  // during it. --budget is the device-memory budget in MB.
+  ResidencyManager residency(context, device, residencyBudget);
+  if (managed) {
+    residency.track(sharedA, allocSize);
+    residency.prepare(sharedA);
+  }
+
+  // With --managed, pinned copy sources/destinations, so no copy goes through
+  // a bounce buffer
+  StagingAllocator staging(context);
 
 //   Uncomment to PASS
-  int firstTouch = 0;
-  ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, sharedA, &firstTouch,
+  int pageableFirstTouch = 0;
+  int *firstTouch = managed ? staging.alloc<int>() : &pageableFirstTouch;
+  *firstTouch = 0;
+  ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, sharedA, firstTouch,
                                              sizeof(int), nullptr, 0, nullptr)); 
   ZE_CHECK(zeCommandListAppendBarrier(cmdList, nullptr, 0, nullptr));
 
@@ -165,17 +218,64 @@ int main(int argc, char **argv) {
   dispatch.groupCountY = 1;
   dispatch.groupCountZ = 1;
 
+  // With --small-copy, read back through the small-transfer path once setOne
+  // has signaled
+  ze_module_handle_t smallCopyModule = nullptr;
+  std::unique_ptr<SmallCopy> smallCopy;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t kernelDone = nullptr;
+  if (smallCopyPath) {
+    smallCopyModule = loadModule(context, device, "SmallCopy.spv");
+    smallCopy.reset(new SmallCopy(context, device, smallCopyModule));
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+    ZE_CHECK(
+        zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                 ZE_EVENT_SCOPE_FLAG_HOST,
+                                 ZE_EVENT_SCOPE_FLAG_HOST};
+    ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &kernelDone));
+  }
+
   // Launch kernel on the GPU
   ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, kernel, &dispatch,
-                                               nullptr, 0, nullptr));
+                                               kernelDone, 0, nullptr));
 
-  int hostA[1] = {0};
-  ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, hostA, sharedA,
-                                                 sizeof(int), nullptr, 0, nullptr));
-  ZE_CHECK(zeCommandListAppendBarrier(cmdList, nullptr, 0, nullptr));
+  int pageableHostA[1] = {0};
+  int *hostA = managed ? staging.alloc<int>() : pageableHostA;
+  hostA[0] = 0;
+  if (smallCopy) {
+    smallCopy->read(hostA, sharedA, sizeof(int), kernelDone);
+  } else {
+    ZE_CHECK(zeCommandListAppendMemoryCopy(cmdList, hostA, sharedA,
+                                                   sizeof(int), nullptr, 0, nullptr));
+    ZE_CHECK(zeCommandListAppendBarrier(cmdList, nullptr, 0, nullptr));
+  }
   std::cout << "HOST: sharedA[0] = " << static_cast<int>(hostA[0]) << std::endl;
   // Cleanup
-  ZE_CHECK(zeMemFree(context, sharedA));
+  if (smallCopy) {
+    smallCopy->release();
+    ZE_CHECK(zeModuleDestroy(smallCopyModule));
+    ZE_CHECK(zeEventDestroy(kernelDone));
+    ZE_CHECK(zeEventPoolDestroy(eventPool));
+  }
+  if (managed) {
+    residency.printStats();
+    residency.untrack(sharedA);
+  }
+  if (managed) {
+    staging.free(firstTouch);
+    staging.free(hostA);
+  }
+  staging.release();
+  if (managed) {
+    pool.free(sharedA);
+    pool.printStats();
+  } else {
+    ZE_CHECK(zeMemFree(context, sharedA));
+  }
+  pool.release();
   ZE_CHECK(zeCommandListDestroy(cmdList));
   ZE_CHECK(zeCommandQueueDestroy(cmdQueue));
   ZE_CHECK(zeContextDestroy(context));
@@ -0,0 +1,170 @@
+// Launch latency with and without explicit residency management.
+//
+// A working set of `buffers` device allocations from UsmPool is touched
+// round-robin by touchPages for `passes` passes. Without the manager any
+// page-fault and residency work lands inside the timed launch. With it,
+// ResidencyManager::prepare() runs before the launch under a device budget
+// of `budgetMB`, so those costs show up in the prepare column instead. A
+// budget smaller than the working set shows the eviction churn of an LRU
+// policy on a cyclic access pattern.
+//
+// Usage: ./residency [buffers=8] [bufferMB=64] [budgetMB=256] [passes=4]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "common.hpp"
+#include "ResidencyManager.hpp"
+#include "UsmPool.hpp"
+#include "ze_api.h"
+
+constexpr uint32_t kPageSize = 4096;
+
+struct Latency {
+  double median;
+  double max;
+};
+
+Latency summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return {samples[samples.size() / 2], samples.back()};
+}
+
+int main(int argc, char **argv) {
+  int numBuffers = argc > 1 ? std::atoi(argv[1]) : 8;
+  long bufferMB = argc > 2 ? std::atol(argv[2]) : 64;
+  long budgetMB = argc > 3 ? std::atol(argv[3]) : 256;
+  int passes = argc > 4 ? std::atoi(argv[4]) : 4;
+  // The latency tables need at least one launch per pass
+  if (numBuffers < 1 || bufferMB < 1 || budgetMB < 0 || passes < 1) {
+    std::cout << "Usage: " << argv[0]
+              << " [buffers=8] [bufferMB=64] [budgetMB=256] [passes=4]\n";
+    return 1;
+  }
+  size_t bufferBytes = size_t(bufferMB) << 20;
+  size_t budget = size_t(budgetMB) << 20;
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+  std::cout << numBuffers << " x " << (bufferBytes >> 20)
+            << " MB working set, budget " << (budget >> 20) << " MB, "
+            << passes << " passes\n";
+
+  uint32_t ordinal = 0;
+  findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                   ordinal);
+  ze_command_list_handle_t cmdList =
+      createImmediateList(context, device, ordinal);
+  ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                        nullptr,
+                                        ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+  ze_event_pool_handle_t eventPool;
+  ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+  ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                               ZE_EVENT_SCOPE_FLAG_HOST,
+                               ZE_EVENT_SCOPE_FLAG_HOST};
+  ze_event_handle_t done;
+  ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &done));
+
+  ze_module_handle_t module = loadModule(context, device, "TouchKernel.spv");
+  ze_kernel_handle_t kernel;
+  ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+  kernelDesc.pKernelName = "touchPages";
+  ZE_CHECK(zeKernelCreate(module, &kernelDesc, &kernel));
+
+  uint32_t intsPerPage = kPageSize / sizeof(int);
+  uint32_t numPages = uint32_t(bufferBytes / kPageSize);
+  uint32_t groupSizeX = 1u;
+  uint32_t groupSizeY = 1u;
+  uint32_t groupSizeZ = 1u;
+  ZE_CHECK(zeKernelSuggestGroupSize(kernel, numPages, 1U, 1U, &groupSizeX,
+                                    &groupSizeY, &groupSizeZ));
+  ZE_CHECK(zeKernelSetGroupSize(kernel, groupSizeX, 1, 1));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(uint32_t), &intsPerPage));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(uint32_t), &numPages));
+  ze_group_count_t dispatch = {(numPages + groupSizeX - 1) / groupSizeX, 1, 1};
+
+  auto launch = [&](void *buffer) {
+    auto begin = std::chrono::steady_clock::now();
+    ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(buffer), &buffer));
+    ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, kernel, &dispatch, done,
+                                             0, nullptr));
+    ZE_CHECK(zeEventHostSynchronize(done, std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(done));
+    return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - begin)
+        .count();
+  };
+
+  // Warm up JIT and kernel residency on a buffer outside the working set
+  UsmPool scratchPool(context, device);
+  void *scratch = scratchPool.alloc(UsmType::Device, bufferBytes);
+  launch(scratch);
+  scratchPool.free(scratch);
+  scratchPool.release();
+
+  std::cout << "\n"
+            << std::left << std::setw(10) << "residency" << std::right
+            << std::setw(16) << "first max [us]" << std::setw(16)
+            << "later p50 [us]" << std::setw(16) << "later max [us]"
+            << std::setw(18) << "prepare p50 [us]" << std::endl;
+  for (bool managed : {false, true}) {
+    // A pool per mode, released at its end: a shared pool would hand the
+    // second mode the slots the first one (or the warm-up) already touched
+    UsmPool pool(context, device);
+    std::vector<void *> buffers;
+    for (int i = 0; i < numBuffers; i++)
+      buffers.push_back(pool.alloc(UsmType::Device, bufferBytes));
+    ResidencyManager residency(context, device, budget);
+    for (void *buffer : buffers)
+      residency.track(buffer, bufferBytes);
+
+    std::vector<double> first, later, prepare;
+    for (int pass = 0; pass < passes; pass++) {
+      for (void *buffer : buffers) {
+        if (managed) {
+          auto begin = std::chrono::steady_clock::now();
+          residency.prepare(buffer);
+          prepare.push_back(std::chrono::duration<double, std::micro>(
+                                std::chrono::steady_clock::now() - begin)
+                                .count());
+        }
+        (pass == 0 ? first : later).push_back(launch(buffer));
+      }
+    }
+
+    Latency firstPass = summarize(first);
+    Latency laterPasses = later.empty() ? firstPass : summarize(later);
+    std::cout << std::left << std::setw(10) << (managed ? "managed" : "off")
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(16) << firstPass.max << std::setw(16)
+              << laterPasses.median << std::setw(16) << laterPasses.max
+              << std::setw(18) << (managed ? summarize(prepare).median : 0.0)
+              << std::endl;
+    if (managed)
+      residency.printStats();
+
+    for (void *buffer : buffers) {
+      residency.untrack(buffer);
+      pool.free(buffer);
+    }
+    pool.release();
+  }
+
+  ZE_CHECK(zeKernelDestroy(kernel));
+  ZE_CHECK(zeModuleDestroy(module));
+  ZE_CHECK(zeEventDestroy(done));
+  ZE_CHECK(zeEventPoolDestroy(eventPool));
+  ZE_CHECK(zeCommandListDestroy(cmdList));
+  ZE_CHECK(zeContextDestroy(context));
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Latency of small read-backs per SmallCopy path, and the resulting
+// threshold between the copyBytes kernel and the copy engine.
+//
+// Device source: copy engine vs copyBytes kernel into pinned memory.
+// Shared source: copy engine vs direct host read.
+// The suggested threshold is the largest size up to which the kernel path
+// is faster at every size; export it as SMALL_COPY_THRESHOLD so SmallCopy
+// picks it up as its default, or pass it to the constructor.
+//
+// Usage: ./smallCopy [maxBytes=65536] [repetitions=1000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "common.hpp"
+#include "StagingAllocator.hpp"
+#include "SmallCopy.hpp"
+#include "ze_api.h"
+
+int main(int argc, char **argv) {
+  size_t maxBytes = argc > 1 ? std::atol(argv[1]) : 65536;
+  int repetitions = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+
+  ze_module_handle_t module = loadModule(context, device, "SmallCopy.spv");
+  // Threshold = maxBytes so the kernel path can be forced at every size
+  SmallCopy smallCopy(context, device, module, maxBytes);
+
+  ze_device_mem_alloc_desc_t deviceDesc = {
+      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+  void *deviceSrc = nullptr;
+  void *sharedSrc = nullptr;
+  void *dst = nullptr;
+  ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, maxBytes, 64, device,
+                            &deviceSrc));
+  ZE_CHECK(zeMemAllocShared(context, &deviceDesc, &hostDesc, maxBytes, 64,
+                            device, &sharedSrc));
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, maxBytes, 64, &dst));
+  memset(sharedSrc, 1, maxBytes);
+
+  auto medianUs = [&](SmallCopy::Path path, const void *src, size_t bytes) {
+    std::vector<double> samples;
+    for (int i = 0; i <= repetitions; i++) {
+      auto begin = std::chrono::steady_clock::now();
+      smallCopy.read(path, dst, src, bytes);
+      auto end = std::chrono::steady_clock::now();
+      if (i > 0) // the first read pays for residency and JIT
+        samples.push_back(
+            std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                     samples.end());
+    return samples[samples.size() / 2];
+  };
+
+  std::cout << "\nmedian latency [us]\n"
+            << std::setw(10) << "bytes" << std::setw(16) << "device copy"
+            << std::setw(16) << "device kernel" << std::setw(16)
+            << "shared copy" << std::setw(16) << "shared direct" << std::endl;
+  size_t threshold = 0;
+  bool kernelWins = true;
+  for (size_t bytes = 4; bytes <= maxBytes; bytes *= 2) {
+    double deviceCopy =
+        medianUs(SmallCopy::Path::CopyEngine, deviceSrc, bytes);
+    double deviceKernel = medianUs(SmallCopy::Path::Kernel, deviceSrc, bytes);
+    double sharedCopy =
+        medianUs(SmallCopy::Path::CopyEngine, sharedSrc, bytes);
+    double sharedDirect = medianUs(SmallCopy::Path::Direct, sharedSrc, bytes);
+    std::cout << std::setw(10) << bytes << std::fixed << std::setprecision(2)
+              << std::setw(16) << deviceCopy << std::setw(16) << deviceKernel
+              << std::setw(16) << sharedCopy << std::setw(16) << sharedDirect
+              << std::endl;
+    kernelWins = kernelWins && deviceKernel < deviceCopy;
+    if (kernelWins)
+      threshold = bytes;
+  }
+  std::cout << "\nSuggested SmallCopy threshold: " << threshold << " bytes\n"
+            << "  export SMALL_COPY_THRESHOLD=" << threshold << "\n";
+
+  ZE_CHECK(zeMemFree(context, dst));
+  ZE_CHECK(zeMemFree(context, sharedSrc));
+  ZE_CHECK(zeMemFree(context, deviceSrc));
+  smallCopy.release();
+  ZE_CHECK(zeModuleDestroy(module));
+  ZE_CHECK(zeContextDestroy(context));
+  return 0;
+}
@@ -0,0 +1,272 @@
+// Bandwidth of the pipelined chunked transfer engine (ChunkedCopy.hpp)
+// against a plain single zeCommandListAppendMemoryCopy.
+//
+// The peak reference is one copy from pinned (zeMemAllocHost) memory; the
+// pageable single copy is what firstTouch and ImmCmdListEventQuery do today.
+//
+// The upload is also timed with a per-chunk compute stage, sumChunk from
+// TouchKernel.cl adding up each chunk: serially after the whole upload, and
+// overlapped, where ChunkedCopy runs it on chunk i while chunk i+1 uploads.
+// Both runs check the sums against the host's.
+//
+// Usage: ./streamCopy [sizeMB=256]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "ChunkedCopy.hpp"
+#include "ze_api.h"
+
+constexpr int kRepetitions = 3;
+constexpr uint32_t kWordsPerItem = 1024; // as in sumChunk
+
+// Best-of-N wall time of `body` in seconds
+template <typename F> double bestOf(F body) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < kRepetitions; i++) {
+    auto begin = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - begin).count());
+  }
+  return best;
+}
+
+void printRow(const std::string &name, size_t bytes, double seconds,
+              double peakGBs) {
+  double gbs = bytes / seconds / 1e9;
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << gbs << std::setw(10)
+            << (peakGBs > 0 ? gbs / peakGBs * 100 : 100.0) << "%"
+            << std::endl;
+}
+
+int main(int argc, char **argv) {
+  size_t bytes = (argc > 1 ? std::atol(argv[1]) : 256) << 20;
+
+  ze_driver_handle_t driverHandle;
+  ze_device_handle_t device;
+  ze_context_handle_t context;
+  initLevelZero(driverHandle, device, context);
+
+  uint32_t copyOrdinal = 0;
+  bool copyEngine = findQueueOrdinal(
+      device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY,
+      ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, copyOrdinal);
+  if (!copyEngine)
+    findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                     copyOrdinal);
+  std::cout << "Copy engine: " << (copyEngine ? "dedicated" : "compute")
+            << ", transfer size: " << (bytes >> 20) << " MB\n";
+  ze_command_list_handle_t copyList =
+      createImmediateList(context, device, copyOrdinal);
+
+  ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                        nullptr,
+                                        ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+  ze_event_pool_handle_t eventPool;
+  ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+  ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                               ZE_EVENT_SCOPE_FLAG_HOST,
+                               ZE_EVENT_SCOPE_FLAG_HOST};
+  ze_event_handle_t copyDone;
+  ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &copyDone));
+
+  ze_device_mem_alloc_desc_t deviceDesc = {
+      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+  void *deviceBuf = nullptr;
+  void *pinned = nullptr;
+  ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, bytes, 4096, device,
+                            &deviceBuf));
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, bytes, 4096, &pinned));
+
+  // Touch every page so the pageable buffers are backed before timing
+  std::unique_ptr<char[]> pageable(new char[bytes]);
+  std::unique_ptr<char[]> readBack(new char[bytes]);
+  for (size_t i = 0; i < bytes; i++)
+    pageable[i] = static_cast<char>(i * 7);
+  memset(readBack.get(), 0, bytes);
+  memset(pinned, 0, bytes);
+
+  auto singleCopy = [&](void *dst, const void *src) {
+    ZE_CHECK(zeCommandListAppendMemoryCopy(copyList, dst, src, bytes,
+                                           copyDone, 0, nullptr));
+    ZE_CHECK(zeEventHostSynchronize(copyDone,
+                                    std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(copyDone));
+  };
+
+  std::cout << "\n"
+            << std::left << std::setw(40) << "host -> device" << std::right
+            << std::setw(10) << "GB/s" << std::setw(11) << "of peak"
+            << std::endl;
+  double peakUp = bytes / bestOf([&] { singleCopy(deviceBuf, pinned); }) / 1e9;
+  printRow("single copy, pinned source (peak)", bytes, bytes / peakUp / 1e9,
+           peakUp);
+  printRow("single copy, pageable source", bytes,
+           bestOf([&] { singleCopy(deviceBuf, pageable.get()); }), peakUp);
+
+  const size_t chunkSizes[] = {1 << 20, 4 << 20, 16 << 20};
+  for (uint32_t numBuffers : {2u, 3u}) {
+    for (size_t chunk : chunkSizes) {
+      ChunkedCopy engine(context, device, chunk, numBuffers);
+      std::string name = "chunked x" + std::to_string(numBuffers) + ", " +
+                         std::to_string(chunk >> 20) + " MB chunks";
+      printRow(name, bytes,
+               bestOf([&] { engine.upload(deviceBuf, pageable.get(), bytes); }),
+               peakUp);
+    }
+  }
+
+  // Per-chunk compute stage
+  ze_module_handle_t module = loadModule(context, device, "TouchKernel.spv");
+  ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+  kernelDesc.pKernelName = "sumChunk";
+  ze_kernel_handle_t sumKernel;
+  ZE_CHECK(zeKernelCreate(module, &kernelDesc, &sumKernel));
+  uint32_t computeOrdinal = 0;
+  findQueueOrdinal(device, ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE, 0,
+                   computeOrdinal);
+  ze_command_list_handle_t computeList =
+      createImmediateList(context, device, computeOrdinal);
+  size_t maxChunks = (bytes + chunkSizes[0] - 1) / chunkSizes[0];
+  void *sumsBuf = nullptr;
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, maxChunks * sizeof(uint32_t), 64,
+                          &sumsBuf));
+  uint32_t *sums = static_cast<uint32_t *>(sumsBuf);
+
+  auto sumStage = [&](size_t chunk) -> ChunkedCopy::ChunkStage {
+    return [&, chunk](ze_command_list_handle_t list, void *deviceChunk,
+                      size_t offset, size_t len, ze_event_handle_t ready,
+                      ze_event_handle_t done) {
+      uint32_t words = uint32_t(len / sizeof(uint32_t));
+      uint32_t slot = uint32_t(offset / chunk);
+      uint32_t items = (words + kWordsPerItem - 1) / kWordsPerItem;
+      uint32_t groupSizeX = 1u;
+      uint32_t groupSizeY = 1u;
+      uint32_t groupSizeZ = 1u;
+      ZE_CHECK(zeKernelSuggestGroupSize(sumKernel, items, 1U, 1U, &groupSizeX,
+                                        &groupSizeY, &groupSizeZ));
+      ZE_CHECK(zeKernelSetGroupSize(sumKernel, groupSizeX, 1, 1));
+      ZE_CHECK(zeKernelSetArgumentValue(sumKernel, 0, sizeof(deviceChunk),
+                                        &deviceChunk));
+      ZE_CHECK(zeKernelSetArgumentValue(sumKernel, 1, sizeof(words), &words));
+      ZE_CHECK(zeKernelSetArgumentValue(sumKernel, 2, sizeof(sums), &sums));
+      ZE_CHECK(zeKernelSetArgumentValue(sumKernel, 3, sizeof(slot), &slot));
+      ze_group_count_t dispatch = {(items + groupSizeX - 1) / groupSizeX, 1,
+                                   1};
+      ZE_CHECK(zeCommandListAppendLaunchKernel(list, sumKernel, &dispatch, done,
+                                               ready ? 1 : 0,
+                                               ready ? &ready : nullptr));
+    };
+  };
+  // The stage over every chunk of deviceBuf, after the upload has finished
+  auto serialStage = [&](const ChunkedCopy::ChunkStage &stage, size_t chunk) {
+    for (size_t offset = 0; offset < bytes; offset += chunk)
+      stage(computeList, static_cast<char *>(deviceBuf) + offset, offset,
+            std::min(chunk, bytes - offset), nullptr, nullptr);
+    ZE_CHECK(zeCommandListAppendBarrier(computeList, copyDone, 0, nullptr));
+    ZE_CHECK(zeEventHostSynchronize(copyDone,
+                                    std::numeric_limits<uint64_t>::max()));
+    ZE_CHECK(zeEventHostReset(copyDone));
+  };
+  auto sumsMatch = [&](size_t chunk) {
+    for (size_t offset = 0; offset < bytes; offset += chunk) {
+      uint32_t expected = 0;
+      for (size_t i = offset; i < std::min(offset + chunk, bytes);
+           i += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, pageable.get() + i, sizeof(word));
+        expected += word;
+      }
+      if (sums[offset / chunk] != expected)
+        return false;
+    }
+    return true;
+  };
+
+  bool valid = true;
+  std::cout << "\n"
+            << std::left << std::setw(40) << "upload + per-chunk sum"
+            << std::right << std::setw(14) << "serial [ms]" << std::setw(16)
+            << "overlapped [ms]" << std::setw(10) << "saved" << std::endl;
+  for (uint32_t numBuffers : {2u, 3u}) {
+    for (size_t chunk : chunkSizes) {
+      ChunkedCopy engine(context, device, chunk, numBuffers);
+      ChunkedCopy::ChunkStage stage = sumStage(chunk);
+      double serial = bestOf([&] {
+        memset(sums, 0, maxChunks * sizeof(uint32_t));
+        engine.upload(deviceBuf, pageable.get(), bytes);
+        serialStage(stage, chunk);
+      });
+      bool sumsValid = sumsMatch(chunk);
+      double overlapped = bestOf([&] {
+        memset(sums, 0, maxChunks * sizeof(uint32_t));
+        engine.upload(deviceBuf, pageable.get(), bytes, stage);
+      });
+      sumsValid = sumsValid && sumsMatch(chunk);
+      valid = valid && sumsValid;
+
+      std::string name = "chunked x" + std::to_string(numBuffers) + ", " +
+                         std::to_string(chunk >> 20) + " MB chunks";
+      std::cout << std::left << std::setw(40) << name << std::right
+                << std::fixed << std::setprecision(2) << std::setw(14)
+                << serial * 1e3 << std::setw(16) << overlapped * 1e3
+                << std::setw(9) << (1 - overlapped / serial) * 100 << "%"
+                << (sumsValid ? "" : "  sums FAILED") << std::endl;
+    }
+  }
+
+  std::cout << "\n"
+            << std::left << std::setw(40) << "device -> host" << std::right
+            << std::setw(10) << "GB/s" << std::setw(11) << "of peak"
+            << std::endl;
+  double peakDown =
+      bytes / bestOf([&] { singleCopy(pinned, deviceBuf); }) / 1e9;
+  printRow("single copy, pinned destination (peak)", bytes,
+           bytes / peakDown / 1e9, peakDown);
+  printRow("single copy, pageable destination", bytes,
+           bestOf([&] { singleCopy(readBack.get(), deviceBuf); }), peakDown);
+  for (uint32_t numBuffers : {2u, 3u}) {
+    for (size_t chunk : chunkSizes) {
+      ChunkedCopy engine(context, device, chunk, numBuffers);
+      std::string name = "chunked x" + std::to_string(numBuffers) + ", " +
+                         std::to_string(chunk >> 20) + " MB chunks";
+      printRow(name, bytes,
+               bestOf([&] {
+                 engine.download(readBack.get(), deviceBuf, bytes);
+               }),
+               peakDown);
+
+      // readBack already holds the data from the copies above; overwrite it
+      // so only this engine's download can pass the check
+      memset(readBack.get(), 0xa5, bytes);
+      engine.download(readBack.get(), deviceBuf, bytes);
+      valid = valid && memcmp(pageable.get(), readBack.get(), bytes) == 0;
+    }
+  }
+
+  std::cout << "\nRound trip validation " << (valid ? "PASSED" : "FAILED")
+            << "\n";
+
+  ZE_CHECK(zeMemFree(context, sumsBuf));
+  ZE_CHECK(zeCommandListDestroy(computeList));
+  ZE_CHECK(zeKernelDestroy(sumKernel));
+  ZE_CHECK(zeModuleDestroy(module));
+  ZE_CHECK(zeMemFree(context, pinned));
+  ZE_CHECK(zeMemFree(context, deviceBuf));
+  ZE_CHECK(zeEventDestroy(copyDone));
+  ZE_CHECK(zeEventPoolDestroy(eventPool));
+  ZE_CHECK(zeCommandListDestroy(copyList));
+  ZE_CHECK(zeContextDestroy(context));
+  return valid ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Host versions of the reproducers' device kernels.
+//
+// zeKernelCreate looks kernel names up in hostKernels(); a kernel that is not
+// listed fails with ZE_RESULT_ERROR_INVALID_KERNEL_NAME. Each entry runs one
+// work-item and mirrors its .cl source line for line, so results match what
+// the GPU computes. To support a new kernel, add its function and a line to
+// the table.
+//
+// Needs <cstring> and <vector> included first.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+
+// Argument values as set by zeKernelSetArgumentValue, indexed like the
+// kernel's parameter list
+struct KernelArgs {
+  std::vector<std::vector<char>> values;
+
+  template <typename T> T get(uint32_t index) const {
+    T value{};
+    if (index < values.size())
+      memcpy(&value, values[index].data(),
+             std::min(sizeof(T), values[index].size()));
+    return value;
+  }
+};
+
+// Global id of the work-item being run
+struct WorkItem {
+  uint32_t x, y, z;
+};
+
+using HostKernel = void (*)(const KernelArgs &args, const WorkItem &id);
+
+// KernelGPU.cl (template/, callbacks/)
+void mxm(const KernelArgs &args, const WorkItem &id) {
+  int *a = args.get<int *>(0);
+  int *b = args.get<int *>(1);
+  int *c = args.get<int *>(2);
+  int n = args.get<int>(3);
+  int sum = 0;
+  for (int k = 0; k < n; k++)
+    sum += a[size_t(id.x) * n + k] * b[size_t(k) * n + id.y];
+  c[size_t(id.x) * n + id.y] = sum;
+}
+
+void mxmTile(const KernelArgs &args, const WorkItem &id) {
+  int *c = args.get<int *>(0);
+  const int *a = args.get<const int *>(1);
+  const int *b = args.get<const int *>(2);
+  int tile = args.get<int>(3);
+  int accumulate = args.get<int>(4);
+  int sum = accumulate ? c[size_t(id.x) * tile + id.y] : 0;
+  for (int k = 0; k < tile; k++)
+    sum += a[size_t(id.x) * tile + k] * b[size_t(k) * tile + id.y];
+  c[size_t(id.x) * tile + id.y] = sum;
+}
+
+uint32_t hashIndex(uint32_t i, uint32_t seed) {
+  uint32_t x = i * 0x9E3779B9u ^ seed;
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+void fillPattern(const KernelArgs &args, const WorkItem &id) {
+  int *a = args.get<int *>(0);
+  if (id.x < args.get<uint32_t>(3))
+    a[id.x] = args.get<int>(1) + int(id.x) * args.get<int>(2);
+}
+
+void fillRandom(const KernelArgs &args, const WorkItem &id) {
+  int *a = args.get<int *>(0);
+  if (id.x < args.get<uint32_t>(3))
+    a[id.x] =
+        int(hashIndex(id.x, args.get<uint32_t>(1)) % args.get<uint32_t>(2));
+}
+
+// SlowKernel.cl: the result is discarded, so only its cost is modeled (see
+// ZE_CPU_KERNEL_US in LatencyModel.hpp)
+void myKernel(const KernelArgs &, const WorkItem &) {}
+
+// SlowKernel.cl (templateNoArgs/), timed for real so spin.hpp can calibrate
+void spinKernel(const KernelArgs &args, const WorkItem &id) {
+  uint64_t loops = args.get<uint64_t>(0);
+  volatile float val = 0.0f;
+  for (uint64_t i = 0; i < loops; i++)
+    val = std::sqrt(val + float(i));
+  if (id.x == 0)
+    args.get<float *>(1)[0] = val;
+}
+
+// EmptyKernel.cl
+void emptyKernel(const KernelArgs &, const WorkItem &) {}
+
+// firstTouch: setOne(Data) with Data = {int *A_d} passed by value
+void setOne(const KernelArgs &args, const WorkItem &) {
+  args.get<int *>(0)[0] = 1;
+}
+
+// TouchKernel.cl
+void touchPages(const KernelArgs &args, const WorkItem &id) {
+  int *a = args.get<int *>(0);
+  uint32_t intsPerPage = args.get<uint32_t>(1);
+  uint32_t numPages = args.get<uint32_t>(2);
+  if (id.x < numPages)
+    a[size_t(id.x) * intsPerPage] = 1;
+}
+
+void sumChunk(const KernelArgs &args, const WorkItem &id) {
+  const uint32_t *src = args.get<const uint32_t *>(0);
+  uint32_t words = args.get<uint32_t>(1);
+  uint32_t *sums = args.get<uint32_t *>(2);
+  uint32_t slot = args.get<uint32_t>(3);
+  size_t first = size_t(id.x) * 1024;
+  size_t last = std::min(first + 1024, size_t(words));
+  uint32_t sum = 0;
+  for (size_t i = first; i < last; i++)
+    sum += src[i];
+  // Work-items run on several threads, like atomic_add on the device
+  __atomic_fetch_add(&sums[slot], sum, __ATOMIC_RELAXED);
+}
+
+// SmallCopy.cl
+void copyBytes(const KernelArgs &args, const WorkItem &) {
+  const unsigned char *src = args.get<const unsigned char *>(0);
+  unsigned char *dst = args.get<unsigned char *>(1);
+  uint32_t bytes = args.get<uint32_t>(2);
+  for (uint32_t i = 0; i < bytes; i++)
+    dst[i] = src[i];
+}
+
+const std::map<std::string, HostKernel> &hostKernels() {
+  static const std::map<std::string, HostKernel> kernels = {
+      {"mxm", mxm},
+      {"mxmTile", mxmTile},
+      {"fillPattern", fillPattern},
+      {"fillRandom", fillRandom},
+      {"myKernel", myKernel},
+      {"spinKernel", spinKernel},
+      {"emptyKernel", emptyKernel},
+      {"setOne", setOne},
+      {"touchPages", touchPages},
+      {"sumChunk", sumChunk},
+      {"copyBytes", copyBytes},
+  };
+  return kernels;
+}
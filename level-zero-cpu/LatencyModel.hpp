@@ -0,0 +1,112 @@
+// Latency model of the CPU stand-in driver.
+//
+// Every knob is read once from the environment, in microseconds unless the
+// name says otherwise:
+//
+//   ZE_CPU_SUBMIT_US   host cost of every append on an immediate list and of
+//                      every zeCommandQueueExecuteCommandLists call  [2]
+//   ZE_CPU_LAUNCH_US   device-side delay before a kernel starts      [10]
+//   ZE_CPU_COPY_US     fixed cost of a copy or fill                  [5]
+//   ZE_CPU_COPY_GBPS   modeled copy bandwidth                        [12]
+//   ZE_CPU_SYNC_US     wake-up cost of a host synchronize that had
+//                      to wait                                       [3]
+//   ZE_CPU_KERNEL_US   minimum duration per kernel, as
+//                      "name=us,name=us"                  [myKernel=1000000]
+//   ZE_CPU_THREADS     host threads a kernel's work-items are spread over
+//                      [hardware concurrency]
+//
+// Device work never finishes earlier than the model says; if the host takes
+// longer (a large mxm, a slow memcpy) the real time wins. Short waits spin
+// so microsecond costs stay accurate.
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+class LatencyModel {
+public:
+  static const LatencyModel &get() {
+    static LatencyModel model;
+    return model;
+  }
+
+  double submitUs = 2.0;
+  double launchUs = 10.0;
+  double copyUs = 5.0;
+  double copyGBps = 12.0;
+  double syncUs = 3.0;
+  unsigned threads = 1;
+
+  // Modeled duration of a copy or fill of `bytes`
+  double copyCostUs(size_t bytes) const {
+    return copyUs + bytes / (copyGBps * 1e3);
+  }
+
+  // Minimum duration of a kernel, 0 when none is configured
+  double kernelCostUs(const std::string &name) const {
+    auto it = kernelUs.find(name);
+    return it == kernelUs.end() ? 0.0 : it->second;
+  }
+
+  // Spin (or sleep, for long waits) until `deadline`
+  static void waitUntil(Clock::time_point deadline) {
+    auto remaining = deadline - Clock::now();
+    if (remaining > std::chrono::milliseconds(2))
+      std::this_thread::sleep_for(remaining - std::chrono::milliseconds(1));
+    while (Clock::now() < deadline)
+      ;
+  }
+
+  static void delayUs(double us) {
+    if (us > 0)
+      waitUntil(Clock::now() + toDuration(us));
+  }
+
+  static Clock::duration toDuration(double us) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::micro>(us));
+  }
+
+private:
+  LatencyModel() {
+    readEnv("ZE_CPU_SUBMIT_US", submitUs);
+    readEnv("ZE_CPU_LAUNCH_US", launchUs);
+    readEnv("ZE_CPU_COPY_US", copyUs);
+    readEnv("ZE_CPU_COPY_GBPS", copyGBps);
+    readEnv("ZE_CPU_SYNC_US", syncUs);
+    if (copyGBps <= 0)
+      copyGBps = 12.0;
+
+    threads = std::thread::hardware_concurrency();
+    double configuredThreads = 0;
+    readEnv("ZE_CPU_THREADS", configuredThreads);
+    if (configuredThreads >= 1)
+      threads = unsigned(configuredThreads);
+    if (threads == 0)
+      threads = 1;
+
+    // myKernel runs 10^10 dependent sqrt per work-item on the GPU, which the
+    // host cannot replay; it only costs time
+    kernelUs["myKernel"] = 1e6;
+    const char *spec = std::getenv("ZE_CPU_KERNEL_US");
+    std::stringstream entries(spec ? spec : "");
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+      size_t eq = entry.find('=');
+      if (eq != std::string::npos)
+        kernelUs[entry.substr(0, eq)] = std::atof(entry.c_str() + eq + 1);
+    }
+  }
+
+  static void readEnv(const char *name, double &value) {
+    if (const char *text = std::getenv(name))
+      value = std::atof(text);
+  }
+
+  std::map<std::string, double> kernelUs;
+};
@@ -0,0 +1,1084 @@
+// CPU stand-in for the Level Zero driver, built as libze_loader.so so the
+// reproducers run unchanged on machines without an Intel GPU:
+//
+//   make -C level-zero-cpu
+//   LD_LIBRARY_PATH=$PWD/level-zero-cpu ./main
+//
+// It implements the part of the API the reproducers use: one driver with one
+// device, contexts, command queues, immediate and regular command lists,
+// event pools with kernel timestamps, USM host/device/shared allocations,
+// virtual memory, and modules whose kernels are the host functions in
+// HostKernels.hpp (the SPIR-V itself is ignored, so any .spv file will do).
+//
+// Every command queue and immediate list is an in-order engine with its own
+// worker thread. Submission, launch, copy and synchronization costs follow
+// LatencyModel.hpp, so host-side scheduling can be measured without a GPU.
+// Timestamps are nanoseconds (timerResolution 1) with 56 valid bits.
+//
+// The device is reported as ZE_DEVICE_TYPE_CPU with one compute+copy queue
+// group (ordinal 0) and one copy-only group (ordinal 1).
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ze_api.h"
+#include "LatencyModel.hpp"
+#include "HostKernels.hpp"
+
+namespace {
+
+constexpr uint32_t kTimestampBits = 56;
+constexpr size_t kVirtualPageSize = 64 * 1024;
+
+// Device time in ns since the driver was loaded
+uint64_t deviceNow() {
+  static const Clock::time_point origin = Clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              origin)
+      .count();
+}
+
+uint64_t hostMemoryBytes() {
+  return uint64_t(sysconf(_SC_PHYS_PAGES)) * uint64_t(sysconf(_SC_PAGE_SIZE));
+}
+
+// Wait on `cv` until `ready`, for at most `timeoutNs` (UINT64_MAX: forever)
+template <typename Ready>
+bool waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cv,
+             uint64_t timeoutNs, Ready ready) {
+  if (timeoutNs == UINT64_MAX) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::nanoseconds(timeoutNs), ready);
+}
+
+} // namespace
+
+struct _ze_driver_handle_t {};
+struct _ze_device_handle_t {};
+struct _ze_context_handle_t {};
+struct _ze_module_handle_t {};
+
+struct _ze_module_build_log_handle_t {
+  std::string text;
+};
+
+struct _ze_event_handle_t {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool signaled = false;
+  uint64_t start = 0;
+  uint64_t end = 0;
+
+  void signal(uint64_t begin, uint64_t finish) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      start = begin;
+      end = finish;
+      signaled = true;
+    }
+    cv.notify_all();
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    signaled = false;
+  }
+
+  // False on timeout. Pays the modeled wake-up cost if it had to block.
+  bool wait(uint64_t timeoutNs, bool modelWakeUp) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (signaled)
+      return true;
+    if (!waitFor(lock, cv, timeoutNs, [this] { return signaled; }))
+      return false;
+    lock.unlock();
+    if (modelWakeUp)
+      LatencyModel::delayUs(LatencyModel::get().syncUs);
+    return true;
+  }
+};
+
+struct _ze_event_pool_handle_t {
+  std::unique_ptr<_ze_event_handle_t[]> events;
+  uint32_t count = 0;
+};
+
+// One unit of device work: wait, (delay), run, signal
+struct Command {
+  std::vector<ze_event_handle_t> waits;
+  ze_event_handle_t signal = nullptr;
+  std::function<void()> body;
+  double startDelayUs = 0;
+  double durationUs = 0;
+};
+
+// In-order execution of commands on a worker thread
+class Engine {
+public:
+  Engine() : worker([this] { run(); }) {}
+
+  ~Engine() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    workCv.notify_all();
+    worker.join();
+  }
+
+  void submit(std::vector<Command> commands) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending += commands.size();
+      for (auto &command : commands)
+        queue.push_back(std::move(command));
+    }
+    workCv.notify_all();
+  }
+
+  // False on timeout
+  bool waitIdle(uint64_t timeoutNs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending == 0)
+      return true;
+    if (!waitFor(lock, idleCv, timeoutNs, [this] { return pending == 0; }))
+      return false;
+    lock.unlock();
+    LatencyModel::delayUs(LatencyModel::get().syncUs);
+    return true;
+  }
+
+private:
+  void run() {
+    for (;;) {
+      Command command;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        workCv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return;
+        command = std::move(queue.front());
+        queue.pop_front();
+      }
+      execute(command);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending--;
+      }
+      idleCv.notify_all();
+    }
+  }
+
+  static void execute(Command &command) {
+    for (auto event : command.waits)
+      event->wait(UINT64_MAX, false);
+    LatencyModel::delayUs(command.startDelayUs);
+    auto begin = Clock::now();
+    uint64_t start = deviceNow();
+    if (command.body)
+      command.body();
+    LatencyModel::waitUntil(begin +
+                            LatencyModel::toDuration(command.durationUs));
+    if (command.signal)
+      command.signal->signal(start, deviceNow());
+  }
+
+  std::mutex mutex;
+  std::condition_variable workCv;
+  std::condition_variable idleCv;
+  std::deque<Command> queue;
+  size_t pending = 0;
+  bool stopping = false;
+  std::thread worker; // last, so it starts after the members above
+};
+
+struct _ze_command_queue_handle_t {
+  Engine engine;
+  bool synchronous = false;
+  bool copyOnly = false;
+};
+
+struct _ze_command_list_handle_t {
+  std::unique_ptr<Engine> engine; // immediate lists only
+  std::vector<Command> commands;  // regular lists only
+  bool synchronous = false;
+  bool copyOnly = false;
+  bool closed = false;
+};
+
+struct _ze_kernel_handle_t {
+  std::string name;
+  HostKernel function = nullptr;
+  KernelArgs args;
+  uint32_t groupSize[3] = {1, 1, 1};
+};
+
+struct _ze_physical_mem_handle_t {
+  int fd = -1;
+  size_t size = 0;
+};
+
+namespace {
+
+_ze_driver_handle_t theDriver;
+_ze_device_handle_t theDevice;
+
+struct Allocation {
+  size_t size;
+  ze_memory_type_t type;
+  uint64_t id;
+};
+
+std::mutex allocationMutex;
+std::map<uintptr_t, Allocation> allocations;
+uint64_t nextAllocationId = 1;
+
+ze_result_t allocate(size_t size, size_t alignment, ze_memory_type_t type,
+                     void **pptr) {
+  if (!pptr)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (alignment == 0)
+    alignment = 64;
+  if (alignment & (alignment - 1))
+    return ZE_RESULT_ERROR_UNSUPPORTED_ALIGNMENT;
+  if (size == 0 || size > hostMemoryBytes() / 2)
+    return ZE_RESULT_ERROR_UNSUPPORTED_SIZE;
+  alignment = std::max<size_t>(alignment, sizeof(void *));
+  void *ptr = std::aligned_alloc(alignment,
+                                 (size + alignment - 1) / alignment * alignment);
+  if (!ptr)
+    return type == ZE_MEMORY_TYPE_HOST ? ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY
+                                       : ZE_RESULT_ERROR_OUT_OF_DEVICE_MEMORY;
+  std::lock_guard<std::mutex> lock(allocationMutex);
+  allocations[uintptr_t(ptr)] = {size, type, nextAllocationId++};
+  *pptr = ptr;
+  return ZE_RESULT_SUCCESS;
+}
+
+// The allocation containing ptr, or nullptr
+const Allocation *findAllocation(const void *ptr) {
+  auto it = allocations.upper_bound(uintptr_t(ptr));
+  if (it == allocations.begin())
+    return nullptr;
+  --it;
+  if (uintptr_t(ptr) >= it->first + it->second.size)
+    return nullptr;
+  return &it->second;
+}
+
+std::vector<ze_event_handle_t> waitList(uint32_t numWaitEvents,
+                                        ze_event_handle_t *phWaitEvents) {
+  if (!phWaitEvents)
+    return {};
+  return std::vector<ze_event_handle_t>(phWaitEvents,
+                                        phWaitEvents + numWaitEvents);
+}
+
+// Run a command on an immediate list or record it on a regular one
+ze_result_t append(ze_command_list_handle_t list, Command command) {
+  if (!list)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!list->engine) {
+    if (list->closed)
+      return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+    list->commands.push_back(std::move(command));
+    return ZE_RESULT_SUCCESS;
+  }
+  LatencyModel::delayUs(LatencyModel::get().submitUs);
+  std::vector<Command> commands;
+  commands.push_back(std::move(command));
+  list->engine->submit(std::move(commands));
+  if (list->synchronous)
+    list->engine->waitIdle(UINT64_MAX);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t appendCopy(ze_command_list_handle_t list, size_t bytes,
+                       std::function<void()> body,
+                       ze_event_handle_t hSignalEvent, uint32_t numWaitEvents,
+                       ze_event_handle_t *phWaitEvents) {
+  Command command;
+  command.waits = waitList(numWaitEvents, phWaitEvents);
+  command.signal = hSignalEvent;
+  command.body = std::move(body);
+  command.durationUs = LatencyModel::get().copyCostUs(bytes);
+  return append(list, std::move(command));
+}
+
+// Run every work-item of a launch, spread over the model's host threads
+void runKernel(HostKernel function, const KernelArgs &args,
+               const uint32_t global[3]) {
+  uint64_t items = uint64_t(global[0]) * global[1] * global[2];
+  auto range = [&](uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i < last; i++) {
+      WorkItem id = {uint32_t(i % global[0]),
+                     uint32_t(i / global[0] % global[1]),
+                     uint32_t(i / (uint64_t(global[0]) * global[1]))};
+      function(args, id);
+    }
+  };
+  // Small launches are not worth the thread start-up
+  uint64_t threads =
+      std::min<uint64_t>(LatencyModel::get().threads, items / 4096 + 1);
+  if (threads <= 1) {
+    range(0, items);
+    return;
+  }
+  std::vector<std::thread> workers;
+  uint64_t chunk = (items + threads - 1) / threads;
+  for (uint64_t first = 0; first < items; first += chunk)
+    workers.emplace_back(range, first, std::min(items, first + chunk));
+  for (auto &worker : workers)
+    worker.join();
+}
+
+uint32_t largestDivisor(uint32_t size, uint32_t limit) {
+  for (uint32_t d = std::min(size, limit); d > 1; d--)
+    if (size % d == 0)
+      return d;
+  return 1;
+}
+
+} // namespace
+
+// zeCommandListHostSynchronize is newer than the in-tree v1.4 header but
+// level-zero-callbacks uses it
+extern "C" ZE_APIEXPORT ze_result_t ZE_APICALL
+zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                             uint64_t timeout);
+
+// Driver and device
+
+ze_result_t zeInit(ze_init_flags_t) {
+  deviceNow();
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeDriverGet(uint32_t *pCount, ze_driver_handle_t *phDrivers) {
+  if (!pCount)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (phDrivers && *pCount > 0)
+    phDrivers[0] = &theDriver;
+  *pCount = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeDeviceGet(ze_driver_handle_t, uint32_t *pCount,
+                        ze_device_handle_t *phDevices) {
+  if (!pCount)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (phDevices && *pCount > 0)
+    phDevices[0] = &theDevice;
+  *pCount = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeDeviceGetProperties(ze_device_handle_t,
+                                  ze_device_properties_t *pDeviceProperties) {
+  if (!pDeviceProperties)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  auto &props = *pDeviceProperties;
+  props.type = ZE_DEVICE_TYPE_CPU;
+  props.vendorId = 0;
+  props.deviceId = 0;
+  props.flags = ZE_DEVICE_PROPERTY_FLAG_INTEGRATED;
+  props.subdeviceId = 0;
+  props.coreClockRate = 1000;
+  props.maxMemAllocSize = hostMemoryBytes() / 2;
+  props.maxHardwareContexts = 64;
+  props.maxCommandQueuePriority = 0;
+  props.numThreadsPerEU = 1;
+  props.physicalEUSimdWidth = 1;
+  props.numEUsPerSubslice = 1;
+  props.numSubslicesPerSlice = LatencyModel::get().threads;
+  props.numSlices = 1;
+  props.timerResolution = 1;
+  props.timestampValidBits = kTimestampBits;
+  props.kernelTimestampValidBits = kTimestampBits;
+  memset(&props.uuid, 0, sizeof(props.uuid));
+  snprintf(props.name, sizeof(props.name), "Level Zero CPU stand-in");
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeDeviceGetCommandQueueGroupProperties(
+    ze_device_handle_t, uint32_t *pCount,
+    ze_command_queue_group_properties_t *pCommandQueueGroupProperties) {
+  if (!pCount)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  const ze_command_queue_group_property_flags_t flags[2] = {
+      ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE |
+          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY,
+      ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY};
+  if (pCommandQueueGroupProperties) {
+    for (uint32_t i = 0; i < std::min<uint32_t>(*pCount, 2); i++) {
+      pCommandQueueGroupProperties[i].flags = flags[i];
+      pCommandQueueGroupProperties[i].maxMemoryFillPatternSize = 128;
+      pCommandQueueGroupProperties[i].numQueues = 4;
+    }
+  }
+  *pCount = pCommandQueueGroupProperties ? std::min<uint32_t>(*pCount, 2) : 2;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t
+zeDeviceGetMemoryProperties(ze_device_handle_t, uint32_t *pCount,
+                            ze_device_memory_properties_t *pMemProperties) {
+  if (!pCount)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (pMemProperties && *pCount > 0) {
+    pMemProperties[0].flags = 0;
+    pMemProperties[0].maxClockRate = 0;
+    pMemProperties[0].maxBusWidth = 64;
+    pMemProperties[0].totalSize = hostMemoryBytes();
+    snprintf(pMemProperties[0].name, sizeof(pMemProperties[0].name),
+             "Host DRAM");
+  }
+  *pCount = 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeDeviceGetGlobalTimestamps(ze_device_handle_t,
+                                        uint64_t *hostTimestamp,
+                                        uint64_t *deviceTimestamp) {
+  if (!hostTimestamp || !deviceTimestamp)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  *deviceTimestamp = deviceNow();
+  *hostTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       Clock::now().time_since_epoch())
+                       .count();
+  return ZE_RESULT_SUCCESS;
+}
+
+// Contexts
+
+ze_result_t zeContextCreate(ze_driver_handle_t, const ze_context_desc_t *,
+                            ze_context_handle_t *phContext) {
+  if (!phContext)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  *phContext = new _ze_context_handle_t;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeContextDestroy(ze_context_handle_t hContext) {
+  delete hContext;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeContextMakeMemoryResident(ze_context_handle_t,
+                                        ze_device_handle_t, void *, size_t) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeContextEvictMemory(ze_context_handle_t, ze_device_handle_t,
+                                 void *, size_t) {
+  return ZE_RESULT_SUCCESS;
+}
+
+// Command queues and lists
+
+ze_result_t zeCommandQueueCreate(ze_context_handle_t, ze_device_handle_t,
+                                 const ze_command_queue_desc_t *desc,
+                                 ze_command_queue_handle_t *phCommandQueue) {
+  if (!desc || !phCommandQueue)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (desc->ordinal > 1)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  auto queue = new _ze_command_queue_handle_t;
+  queue->synchronous = desc->mode == ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
+  queue->copyOnly = desc->ordinal == 1;
+  *phCommandQueue = queue;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandQueueDestroy(ze_command_queue_handle_t hCommandQueue) {
+  delete hCommandQueue;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t
+zeCommandQueueExecuteCommandLists(ze_command_queue_handle_t hCommandQueue,
+                                  uint32_t numCommandLists,
+                                  ze_command_list_handle_t *phCommandLists,
+                                  ze_fence_handle_t) {
+  if (!hCommandQueue)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!phCommandLists)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  std::vector<Command> commands;
+  for (uint32_t i = 0; i < numCommandLists; i++) {
+    auto list = phCommandLists[i];
+    if (list->engine || !list->closed)
+      return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+    if (list->copyOnly != hCommandQueue->copyOnly)
+      return ZE_RESULT_ERROR_INVALID_COMMAND_LIST_TYPE;
+    commands.insert(commands.end(), list->commands.begin(),
+                    list->commands.end());
+  }
+  LatencyModel::delayUs(LatencyModel::get().submitUs);
+  hCommandQueue->engine.submit(std::move(commands));
+  if (hCommandQueue->synchronous)
+    hCommandQueue->engine.waitIdle(UINT64_MAX);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandQueueSynchronize(ze_command_queue_handle_t hCommandQueue,
+                                      uint64_t timeout) {
+  if (!hCommandQueue)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  return hCommandQueue->engine.waitIdle(timeout) ? ZE_RESULT_SUCCESS
+                                                 : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t zeCommandListCreate(ze_context_handle_t, ze_device_handle_t,
+                                const ze_command_list_desc_t *desc,
+                                ze_command_list_handle_t *phCommandList) {
+  if (!desc || !phCommandList)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (desc->commandQueueGroupOrdinal > 1)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  auto list = new _ze_command_list_handle_t;
+  list->copyOnly = desc->commandQueueGroupOrdinal == 1;
+  *phCommandList = list;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t
+zeCommandListCreateImmediate(ze_context_handle_t, ze_device_handle_t,
+                             const ze_command_queue_desc_t *altdesc,
+                             ze_command_list_handle_t *phCommandList) {
+  if (!altdesc || !phCommandList)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (altdesc->ordinal > 1)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  auto list = new _ze_command_list_handle_t;
+  list->engine.reset(new Engine);
+  list->synchronous = altdesc->mode == ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
+  list->copyOnly = altdesc->ordinal == 1;
+  *phCommandList = list;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListDestroy(ze_command_list_handle_t hCommandList) {
+  delete hCommandList;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListClose(ze_command_list_handle_t hCommandList) {
+  if (!hCommandList)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  hCommandList->closed = true;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListReset(ze_command_list_handle_t hCommandList) {
+  if (!hCommandList)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (hCommandList->engine)
+    hCommandList->engine->waitIdle(UINT64_MAX);
+  hCommandList->commands.clear();
+  hCommandList->closed = false;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                                         uint64_t timeout) {
+  if (!hCommandList)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!hCommandList->engine)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  return hCommandList->engine->waitIdle(timeout) ? ZE_RESULT_SUCCESS
+                                                 : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t zeCommandListAppendBarrier(ze_command_list_handle_t hCommandList,
+                                       ze_event_handle_t hSignalEvent,
+                                       uint32_t numWaitEvents,
+                                       ze_event_handle_t *phWaitEvents) {
+  // Engines are in order, so a barrier only waits and signals
+  Command command;
+  command.waits = waitList(numWaitEvents, phWaitEvents);
+  command.signal = hSignalEvent;
+  return append(hCommandList, std::move(command));
+}
+
+ze_result_t
+zeCommandListAppendWaitOnEvents(ze_command_list_handle_t hCommandList,
+                                uint32_t numEvents,
+                                ze_event_handle_t *phEvents) {
+  Command command;
+  command.waits = waitList(numEvents, phEvents);
+  return append(hCommandList, std::move(command));
+}
+
+ze_result_t zeCommandListAppendSignalEvent(ze_command_list_handle_t hCommandList,
+                                           ze_event_handle_t hEvent) {
+  Command command;
+  command.signal = hEvent;
+  return append(hCommandList, std::move(command));
+}
+
+ze_result_t zeCommandListAppendWriteGlobalTimestamp(
+    ze_command_list_handle_t hCommandList, uint64_t *dstptr,
+    ze_event_handle_t hSignalEvent, uint32_t numWaitEvents,
+    ze_event_handle_t *phWaitEvents) {
+  if (!dstptr)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  Command command;
+  command.waits = waitList(numWaitEvents, phWaitEvents);
+  command.signal = hSignalEvent;
+  command.body = [dstptr] { *dstptr = deviceNow(); };
+  return append(hCommandList, std::move(command));
+}
+
+ze_result_t zeCommandListAppendMemoryCopy(ze_command_list_handle_t hCommandList,
+                                          void *dstptr, const void *srcptr,
+                                          size_t size,
+                                          ze_event_handle_t hSignalEvent,
+                                          uint32_t numWaitEvents,
+                                          ze_event_handle_t *phWaitEvents) {
+  if (!dstptr || !srcptr)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  return appendCopy(
+      hCommandList, size, [=] { memcpy(dstptr, srcptr, size); }, hSignalEvent,
+      numWaitEvents, phWaitEvents);
+}
+
+ze_result_t zeCommandListAppendMemoryCopyRegion(
+    ze_command_list_handle_t hCommandList, void *dstptr,
+    const ze_copy_region_t *dstRegion, uint32_t dstPitch,
+    uint32_t dstSlicePitch, const void *srcptr,
+    const ze_copy_region_t *srcRegion, uint32_t srcPitch,
+    uint32_t srcSlicePitch, ze_event_handle_t hSignalEvent,
+    uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents) {
+  if (!dstptr || !srcptr || !dstRegion || !srcRegion)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (dstRegion->width != srcRegion->width ||
+      dstRegion->height != srcRegion->height ||
+      dstRegion->depth != srcRegion->depth)
+    return ZE_RESULT_ERROR_OVERLAPPING_REGIONS;
+  ze_copy_region_t dst = *dstRegion;
+  ze_copy_region_t src = *srcRegion;
+  // 2D regions may leave depth at 0
+  uint32_t depth = std::max(dst.depth, 1u);
+  size_t bytes = size_t(dst.width) * dst.height * depth;
+  auto body = [=] {
+    for (uint32_t z = 0; z < depth; z++)
+      for (uint32_t y = 0; y < dst.height; y++) {
+        char *to = static_cast<char *>(dstptr) +
+                   size_t(dst.originZ + z) * dstSlicePitch +
+                   size_t(dst.originY + y) * dstPitch + dst.originX;
+        const char *from = static_cast<const char *>(srcptr) +
+                           size_t(src.originZ + z) * srcSlicePitch +
+                           size_t(src.originY + y) * srcPitch + src.originX;
+        memcpy(to, from, dst.width);
+      }
+  };
+  return appendCopy(hCommandList, bytes, body, hSignalEvent, numWaitEvents,
+                    phWaitEvents);
+}
+
+ze_result_t zeCommandListAppendMemoryFill(ze_command_list_handle_t hCommandList,
+                                          void *ptr, const void *pattern,
+                                          size_t pattern_size, size_t size,
+                                          ze_event_handle_t hSignalEvent,
+                                          uint32_t numWaitEvents,
+                                          ze_event_handle_t *phWaitEvents) {
+  if (!ptr || !pattern)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (pattern_size == 0 || size % pattern_size != 0)
+    return ZE_RESULT_ERROR_INVALID_SIZE;
+  std::vector<char> bytes(static_cast<const char *>(pattern),
+                          static_cast<const char *>(pattern) + pattern_size);
+  auto body = [ptr, bytes, size] {
+    char *dst = static_cast<char *>(ptr);
+    for (size_t offset = 0; offset < size; offset += bytes.size())
+      memcpy(dst + offset, bytes.data(), bytes.size());
+  };
+  return appendCopy(hCommandList, size, body, hSignalEvent, numWaitEvents,
+                    phWaitEvents);
+}
+
+ze_result_t zeCommandListAppendMemoryPrefetch(ze_command_list_handle_t,
+                                              const void *, size_t) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListAppendMemAdvise(ze_command_list_handle_t,
+                                         ze_device_handle_t, const void *,
+                                         size_t, ze_memory_advice_t) {
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeCommandListAppendLaunchKernel(
+    ze_command_list_handle_t hCommandList, ze_kernel_handle_t hKernel,
+    const ze_group_count_t *pLaunchFuncArgs, ze_event_handle_t hSignalEvent,
+    uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents) {
+  if (!hCommandList || !hKernel)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!pLaunchFuncArgs)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (hCommandList->copyOnly)
+    return ZE_RESULT_ERROR_INVALID_COMMAND_LIST_TYPE;
+  const auto &model = LatencyModel::get();
+  Command command;
+  command.waits = waitList(numWaitEvents, phWaitEvents);
+  command.signal = hSignalEvent;
+  command.startDelayUs = model.launchUs;
+  command.durationUs = model.kernelCostUs(hKernel->name);
+  // Arguments are captured at append time, as on the device
+  HostKernel function = hKernel->function;
+  KernelArgs args = hKernel->args;
+  std::array<uint32_t, 3> global = {
+      pLaunchFuncArgs->groupCountX * hKernel->groupSize[0],
+      pLaunchFuncArgs->groupCountY * hKernel->groupSize[1],
+      pLaunchFuncArgs->groupCountZ * hKernel->groupSize[2]};
+  command.body = [function, args, global] {
+    runKernel(function, args, global.data());
+  };
+  return append(hCommandList, std::move(command));
+}
+
+// Events
+
+ze_result_t zeEventPoolCreate(ze_context_handle_t,
+                              const ze_event_pool_desc_t *desc, uint32_t,
+                              ze_device_handle_t *,
+                              ze_event_pool_handle_t *phEventPool) {
+  if (!desc || !phEventPool)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (desc->count == 0)
+    return ZE_RESULT_ERROR_INVALID_SIZE;
+  auto pool = new _ze_event_pool_handle_t;
+  pool->events.reset(new _ze_event_handle_t[desc->count]);
+  pool->count = desc->count;
+  *phEventPool = pool;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventPoolDestroy(ze_event_pool_handle_t hEventPool) {
+  delete hEventPool;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventCreate(ze_event_pool_handle_t hEventPool,
+                          const ze_event_desc_t *desc,
+                          ze_event_handle_t *phEvent) {
+  if (!hEventPool)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!desc || !phEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (desc->index >= hEventPool->count)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  auto event = &hEventPool->events[desc->index];
+  event->reset();
+  *phEvent = event;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventDestroy(ze_event_handle_t) {
+  // Storage belongs to the pool
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventHostSignal(ze_event_handle_t hEvent) {
+  if (!hEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  uint64_t now = deviceNow();
+  hEvent->signal(now, now);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventHostReset(ze_event_handle_t hEvent) {
+  if (!hEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  hEvent->reset();
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeEventHostSynchronize(ze_event_handle_t hEvent,
+                                   uint64_t timeout) {
+  if (!hEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  return hEvent->wait(timeout, true) ? ZE_RESULT_SUCCESS : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t zeEventQueryStatus(ze_event_handle_t hEvent) {
+  if (!hEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  std::lock_guard<std::mutex> lock(hEvent->mutex);
+  return hEvent->signaled ? ZE_RESULT_SUCCESS : ZE_RESULT_NOT_READY;
+}
+
+ze_result_t zeEventQueryKernelTimestamp(ze_event_handle_t hEvent,
+                                        ze_kernel_timestamp_result_t *dstptr) {
+  if (!hEvent)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!dstptr)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  std::lock_guard<std::mutex> lock(hEvent->mutex);
+  if (!hEvent->signaled)
+    return ZE_RESULT_NOT_READY;
+  dstptr->global = {hEvent->start, hEvent->end};
+  dstptr->context = {hEvent->start, hEvent->end};
+  return ZE_RESULT_SUCCESS;
+}
+
+// Memory
+
+ze_result_t zeMemAllocHost(ze_context_handle_t, const ze_host_mem_alloc_desc_t *,
+                           size_t size, size_t alignment, void **pptr) {
+  return allocate(size, alignment, ZE_MEMORY_TYPE_HOST, pptr);
+}
+
+ze_result_t zeMemAllocDevice(ze_context_handle_t,
+                             const ze_device_mem_alloc_desc_t *, size_t size,
+                             size_t alignment, ze_device_handle_t,
+                             void **pptr) {
+  return allocate(size, alignment, ZE_MEMORY_TYPE_DEVICE, pptr);
+}
+
+ze_result_t zeMemAllocShared(ze_context_handle_t,
+                             const ze_device_mem_alloc_desc_t *,
+                             const ze_host_mem_alloc_desc_t *, size_t size,
+                             size_t alignment, ze_device_handle_t,
+                             void **pptr) {
+  return allocate(size, alignment, ZE_MEMORY_TYPE_SHARED, pptr);
+}
+
+ze_result_t zeMemFree(ze_context_handle_t, void *ptr) {
+  std::lock_guard<std::mutex> lock(allocationMutex);
+  if (allocations.erase(uintptr_t(ptr)) == 0)
+    return ZE_RESULT_ERROR_INVALID_ARGUMENT;
+  std::free(ptr);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t
+zeMemGetAllocProperties(ze_context_handle_t, const void *ptr,
+                        ze_memory_allocation_properties_t *pMemAllocProperties,
+                        ze_device_handle_t *phDevice) {
+  if (!pMemAllocProperties)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  std::lock_guard<std::mutex> lock(allocationMutex);
+  const Allocation *allocation = findAllocation(ptr);
+  pMemAllocProperties->type =
+      allocation ? allocation->type : ZE_MEMORY_TYPE_UNKNOWN;
+  pMemAllocProperties->id = allocation ? allocation->id : 0;
+  pMemAllocProperties->pageSize = allocation ? sysconf(_SC_PAGE_SIZE) : 0;
+  if (phDevice)
+    *phDevice = allocation && allocation->type != ZE_MEMORY_TYPE_HOST
+                    ? &theDevice
+                    : nullptr;
+  return ZE_RESULT_SUCCESS;
+}
+
+// Virtual memory: reservations are PROT_NONE mappings, physical memory is a
+// memfd mapped over them
+
+ze_result_t zeVirtualMemQueryPageSize(ze_context_handle_t, ze_device_handle_t,
+                                      size_t, size_t *pagesize) {
+  if (!pagesize)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  *pagesize = kVirtualPageSize;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeVirtualMemReserve(ze_context_handle_t, const void *pStart,
+                                size_t size, void **pptr) {
+  if (!pptr)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  void *ptr = mmap(const_cast<void *>(pStart), size, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ptr == MAP_FAILED)
+    return ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY;
+  *pptr = ptr;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeVirtualMemFree(ze_context_handle_t, const void *ptr,
+                             size_t size) {
+  munmap(const_cast<void *>(ptr), size);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zePhysicalMemCreate(ze_context_handle_t, ze_device_handle_t,
+                                ze_physical_mem_desc_t *desc,
+                                ze_physical_mem_handle_t *phPhysicalMemory) {
+  if (!desc || !phPhysicalMemory)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (desc->size == 0 || desc->size % kVirtualPageSize != 0)
+    return ZE_RESULT_ERROR_UNSUPPORTED_SIZE;
+  int fd = memfd_create("ze-cpu-physical", 0);
+  if (fd < 0 || ftruncate(fd, desc->size) != 0) {
+    if (fd >= 0)
+      close(fd);
+    return ZE_RESULT_ERROR_OUT_OF_DEVICE_MEMORY;
+  }
+  auto physical = new _ze_physical_mem_handle_t;
+  physical->fd = fd;
+  physical->size = desc->size;
+  *phPhysicalMemory = physical;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zePhysicalMemDestroy(ze_context_handle_t,
+                                 ze_physical_mem_handle_t hPhysicalMemory) {
+  if (!hPhysicalMemory)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  close(hPhysicalMemory->fd);
+  delete hPhysicalMemory;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeVirtualMemMap(ze_context_handle_t, const void *ptr, size_t size,
+                            ze_physical_mem_handle_t hPhysicalMemory,
+                            size_t offset,
+                            ze_memory_access_attribute_t access) {
+  if (!hPhysicalMemory)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (offset + size > hPhysicalMemory->size)
+    return ZE_RESULT_ERROR_INVALID_SIZE;
+  int prot = access == ZE_MEMORY_ACCESS_ATTRIBUTE_READWRITE ? PROT_READ |
+                                                                  PROT_WRITE
+             : access == ZE_MEMORY_ACCESS_ATTRIBUTE_READONLY ? PROT_READ
+                                                             : PROT_NONE;
+  void *mapped = mmap(const_cast<void *>(ptr), size, prot,
+                      MAP_SHARED | MAP_FIXED, hPhysicalMemory->fd, offset);
+  return mapped == MAP_FAILED ? ZE_RESULT_ERROR_INVALID_ARGUMENT
+                              : ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeVirtualMemUnmap(ze_context_handle_t, const void *ptr,
+                              size_t size) {
+  // Back to an inaccessible reservation
+  void *mapped = mmap(const_cast<void *>(ptr), size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                      -1, 0);
+  return mapped == MAP_FAILED ? ZE_RESULT_ERROR_INVALID_ARGUMENT
+                              : ZE_RESULT_SUCCESS;
+}
+
+// Modules and kernels
+
+ze_result_t zeModuleCreate(ze_context_handle_t, ze_device_handle_t,
+                           const ze_module_desc_t *desc,
+                           ze_module_handle_t *phModule,
+                           ze_module_build_log_handle_t *phBuildLog) {
+  if (!desc || !phModule)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  *phModule = new _ze_module_handle_t;
+  if (phBuildLog)
+    *phBuildLog = new _ze_module_build_log_handle_t;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeModuleDestroy(ze_module_handle_t hModule) {
+  delete hModule;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeModuleBuildLogGetString(ze_module_build_log_handle_t hModuleBuildLog,
+                                      size_t *pSize, char *pBuildLog) {
+  if (!hModuleBuildLog)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!pSize)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  if (pBuildLog)
+    memcpy(pBuildLog, hModuleBuildLog->text.c_str(),
+           std::min(*pSize, hModuleBuildLog->text.size() + 1));
+  *pSize = hModuleBuildLog->text.size() + 1;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeModuleBuildLogDestroy(ze_module_build_log_handle_t hModuleBuildLog) {
+  delete hModuleBuildLog;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelCreate(ze_module_handle_t hModule,
+                           const ze_kernel_desc_t *desc,
+                           ze_kernel_handle_t *phKernel) {
+  if (!hModule)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!desc || !desc->pKernelName || !phKernel)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  auto it = hostKernels().find(desc->pKernelName);
+  if (it == hostKernels().end())
+    return ZE_RESULT_ERROR_INVALID_KERNEL_NAME;
+  auto kernel = new _ze_kernel_handle_t;
+  kernel->name = it->first;
+  kernel->function = it->second;
+  *phKernel = kernel;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelDestroy(ze_kernel_handle_t hKernel) {
+  delete hKernel;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelSetArgumentValue(ze_kernel_handle_t hKernel,
+                                     uint32_t argIndex, size_t argSize,
+                                     const void *pArgValue) {
+  if (!hKernel)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  auto &values = hKernel->args.values;
+  if (argIndex >= values.size())
+    values.resize(argIndex + 1);
+  // A null value is a local memory size; host kernels have none
+  values[argIndex].assign(argSize, 0);
+  if (pArgValue)
+    memcpy(values[argIndex].data(), pArgValue, argSize);
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelSetGroupSize(ze_kernel_handle_t hKernel,
+                                 uint32_t groupSizeX, uint32_t groupSizeY,
+                                 uint32_t groupSizeZ) {
+  if (!hKernel)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (groupSizeX == 0 || groupSizeY == 0 || groupSizeZ == 0)
+    return ZE_RESULT_ERROR_INVALID_GROUP_SIZE_DIMENSION;
+  hKernel->groupSize[0] = groupSizeX;
+  hKernel->groupSize[1] = groupSizeY;
+  hKernel->groupSize[2] = groupSizeZ;
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelSuggestGroupSize(ze_kernel_handle_t hKernel,
+                                     uint32_t globalSizeX, uint32_t globalSizeY,
+                                     uint32_t globalSizeZ, uint32_t *groupSizeX,
+                                     uint32_t *groupSizeY,
+                                     uint32_t *groupSizeZ) {
+  if (!hKernel)
+    return ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+  if (!groupSizeX || !groupSizeY || !groupSizeZ)
+    return ZE_RESULT_ERROR_INVALID_NULL_POINTER;
+  // At most 256 work-items per group, divisors of the global size
+  *groupSizeX = largestDivisor(globalSizeX, globalSizeY > 1 ? 16 : 256);
+  *groupSizeY = largestDivisor(globalSizeY, 256 / *groupSizeX);
+  *groupSizeZ = largestDivisor(globalSizeZ,
+                               256 / (*groupSizeX * *groupSizeY));
+  return ZE_RESULT_SUCCESS;
+}
+
+ze_result_t zeKernelSetIndirectAccess(ze_kernel_handle_t hKernel,
+                                      ze_kernel_indirect_access_flags_t) {
+  return hKernel ? ZE_RESULT_SUCCESS : ZE_RESULT_ERROR_INVALID_NULL_HANDLE;
+}
@@ -0,0 +1,156 @@
+// Fault and latency injection settings, read once from the environment.
+//
+//   ZE_FAULT_DELAY_US   fixed delay before every matching call, as
+//                       "target=us,target=us"
+//   ZE_FAULT_STALL      occasional long stall, as "target=probability:us"
+//   ZE_FAULT_NOT_READY  probability that a sync or query call returns
+//                       ZE_RESULT_NOT_READY, as "target=probability"
+//   ZE_FAULT_FAIL       probability that a call fails without reaching the
+//                       driver, as "target=probability"
+//   ZE_FAULT_ERROR      result of an injected failure: device_lost,
+//                       out_of_host_memory, out_of_device_memory, unknown
+//                       or a number                            [device_lost]
+//   ZE_FAULT_SKIP       calls of each function passed through untouched
+//                       before injection starts, to get past setup  [0]
+//   ZE_FAULT_SEED       random seed; thread n uses seed + n          [1]
+//   ZE_FAULT_REPORT     0 disables the summary written at exit       [1]
+//
+// A target is a function name or one of the groups sync, query, append,
+// submit, host and all. Entries apply left to right, so a later entry
+// overrides an earlier one: "all=50,zeEventQueryStatus=0".
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ze_api.h"
+
+enum class FaultGroup { Sync, Query, Append, Submit, Host };
+
+struct FaultRule {
+  double delayUs = 0.0;
+  double stallProbability = 0.0;
+  double stallUs = 0.0;
+  double notReadyProbability = 0.0;
+  double failProbability = 0.0;
+
+  bool active() const {
+    return delayUs > 0 || stallProbability > 0 || notReadyProbability > 0 ||
+           failProbability > 0;
+  }
+};
+
+class FaultConfig {
+public:
+  struct Function {
+    const char *name;
+    FaultGroup group;
+  };
+
+  FaultConfig(const Function *functions, size_t count)
+      : functions(functions, functions + count), rules(count) {
+    apply("ZE_FAULT_DELAY_US", [](FaultRule &rule, const std::string &value) {
+      rule.delayUs = std::stod(value);
+    });
+    apply("ZE_FAULT_STALL", [](FaultRule &rule, const std::string &value) {
+      size_t colon = value.find(':');
+      if (colon == std::string::npos)
+        throw std::invalid_argument("expected probability:us");
+      rule.stallProbability = std::stod(value.substr(0, colon));
+      rule.stallUs = std::stod(value.substr(colon + 1));
+    });
+    apply("ZE_FAULT_NOT_READY", [](FaultRule &rule, const std::string &value) {
+      rule.notReadyProbability = std::stod(value);
+    });
+    apply("ZE_FAULT_FAIL", [](FaultRule &rule, const std::string &value) {
+      rule.failProbability = std::stod(value);
+    });
+
+    // NOT_READY is only a valid answer from waits and queries
+    for (size_t f = 0; f < count; f++) {
+      FaultGroup group = functions[f].group;
+      if (group != FaultGroup::Sync && group != FaultGroup::Query)
+        rules[f].notReadyProbability = 0.0;
+    }
+
+    if (const char *text = std::getenv("ZE_FAULT_ERROR"))
+      error = parseError(text);
+    if (const char *text = std::getenv("ZE_FAULT_SKIP"))
+      skip = std::strtoull(text, nullptr, 10);
+    if (const char *text = std::getenv("ZE_FAULT_SEED"))
+      seed = std::strtoull(text, nullptr, 10);
+    if (const char *text = std::getenv("ZE_FAULT_REPORT"))
+      report = std::atoi(text) != 0;
+  }
+
+  const FaultRule &rule(size_t function) const { return rules[function]; }
+
+  ze_result_t error = ZE_RESULT_ERROR_DEVICE_LOST;
+  uint64_t skip = 0;
+  uint64_t seed = 1;
+  bool report = true;
+
+private:
+  template <typename Setter> void apply(const char *variable, Setter set) {
+    const char *text = std::getenv(variable);
+    if (!text)
+      return;
+    std::stringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+      if (entry.empty())
+        continue;
+      size_t equals = entry.find('=');
+      std::string target = entry.substr(0, equals);
+      bool matched = false;
+      for (size_t f = 0; f < functions.size(); f++) {
+        if (!matches(target, functions[f]))
+          continue;
+        matched = true;
+        try {
+          set(rules[f], equals == std::string::npos ? ""
+                                                    : entry.substr(equals + 1));
+        } catch (const std::exception &) {
+          fprintf(stderr, "ze_faults: bad %s entry '%s'\n", variable,
+                  entry.c_str());
+          std::exit(1);
+        }
+      }
+      if (!matched) {
+        fprintf(stderr, "ze_faults: unknown %s target '%s'\n", variable,
+                target.c_str());
+        std::exit(1);
+      }
+    }
+  }
+
+  static bool matches(const std::string &target, const Function &function) {
+    static const std::map<std::string, FaultGroup> groups = {
+        {"sync", FaultGroup::Sync},     {"query", FaultGroup::Query},
+        {"append", FaultGroup::Append}, {"submit", FaultGroup::Submit},
+        {"host", FaultGroup::Host}};
+    if (target == "all" || target == function.name)
+      return true;
+    auto it = groups.find(target);
+    return it != groups.end() && it->second == function.group;
+  }
+
+  static ze_result_t parseError(const std::string &text) {
+    static const std::map<std::string, ze_result_t> names = {
+        {"device_lost", ZE_RESULT_ERROR_DEVICE_LOST},
+        {"out_of_host_memory", ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY},
+        {"out_of_device_memory", ZE_RESULT_ERROR_OUT_OF_DEVICE_MEMORY},
+        {"unknown", ZE_RESULT_ERROR_UNKNOWN}};
+    auto it = names.find(text);
+    if (it != names.end())
+      return it->second;
+    return ze_result_t(std::strtoul(text.c_str(), nullptr, 0));
+  }
+
+  std::vector<Function> functions;
+  std::vector<FaultRule> rules;
+};
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Run a program under a sweep of injected driver faults and report how it
+degrades.
+
+Each scenario is a set of ZE_FAULT_* variables (see FaultConfig.hpp). The
+program runs --repeat times per scenario with libze_faults.so preloaded; a run
+that exceeds --timeout counts as a hang and is killed. The table shows the
+median and worst wall time, the slowdown of the median over the baseline, how
+the runs ended and what the shim injected.
+
+Usage: degrade.py [--repeat N] [--timeout S] [--scenario NAME:VAR=VALUE;...]
+                  [--only NAME,...] -- PROGRAM [ARGS...]
+
+--scenario adds a scenario (and may be repeated); --only restricts the sweep
+to the named scenarios plus the baseline, which always runs first since every
+slowdown is relative to it. Without --only the built-in sweep runs first.
+"""
+
+import argparse
+import os
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Name and variables; the baseline preloads the shim with nothing configured
+SCENARIOS = [
+    ("baseline", {}),
+    ("sync+100us", {"ZE_FAULT_DELAY_US": "sync=100"}),
+    ("sync+1ms", {"ZE_FAULT_DELAY_US": "sync=1000"}),
+    ("append+20us", {"ZE_FAULT_DELAY_US": "append=20"}),
+    ("submit+200us", {"ZE_FAULT_DELAY_US": "submit=200"}),
+    ("stall 1%x50ms", {"ZE_FAULT_STALL": "sync=0.01:50000,submit=0.01:50000"}),
+    ("query not-ready 50%", {"ZE_FAULT_NOT_READY": "query=0.5"}),
+    ("sync not-ready 1%", {"ZE_FAULT_NOT_READY": "sync=0.01"}),
+    ("sync fail 0.1%", {"ZE_FAULT_FAIL": "sync=0.001"}),
+    ("append fail 0.1%", {"ZE_FAULT_FAIL": "append=0.001"}),
+]
+
+REPORT = re.compile(
+    r"^ze_faults: (\w+) calls=(\d+) stalls=(\d+) not_ready=(\d+) "
+    r"failed=(\d+) injected_ms=([\d.]+)$", re.MULTILINE)
+
+
+def parse_scenario(text):
+    name, _, assignments = text.partition(":")
+    variables = {}
+    for assignment in filter(None, assignments.split(";")):
+        variable, _, value = assignment.partition("=")
+        variables[variable.strip()] = value.strip()
+    return name, variables
+
+
+def run_once(program, variables, timeout, library):
+    env = dict(os.environ)
+    env.update(variables)
+    preload = env.get("LD_PRELOAD")
+    env["LD_PRELOAD"] = library + (" " + preload if preload else "")
+    begin = time.monotonic()
+    try:
+        proc = subprocess.run(program, env=env, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.PIPE, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        return timeout, "hang", {}
+    seconds = time.monotonic() - begin
+    stderr = proc.stderr.decode(errors="replace")
+    injected = {"stalls": 0, "not_ready": 0, "failed": 0, "injected_ms": 0.0}
+    for match in REPORT.finditer(stderr):
+        injected["stalls"] += int(match.group(3))
+        injected["not_ready"] += int(match.group(4))
+        injected["failed"] += int(match.group(5))
+        injected["injected_ms"] += float(match.group(6))
+    if proc.returncode == 0:
+        outcome = "ok"
+    elif proc.returncode < 0:
+        outcome = "signal %d" % -proc.returncode
+    else:
+        outcome = "exit %d" % proc.returncode
+    return seconds, outcome, injected
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Fault injection degradation sweep")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=60.0)
+    parser.add_argument("--scenario", action="append", default=[],
+                        help="NAME:VAR=VALUE;VAR=VALUE")
+    parser.add_argument("--only", default="",
+                        help="comma separated scenario names to run")
+    parser.add_argument("--library",
+                        default=os.path.join(HERE, "libze_faults.so"))
+    parser.add_argument("program", nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+
+    program = args.program[1:] if args.program[:1] == ["--"] else args.program
+    if not program:
+        parser.error("no program given")
+    if not os.path.exists(args.library):
+        sys.exit("degrade: %s not found, run make first" % args.library)
+
+    scenarios = SCENARIOS + [parse_scenario(s) for s in args.scenario]
+    if args.only:
+        wanted = args.only.split(",")
+        scenarios = [s for s in scenarios
+                     if s[0] in wanted or s[0] == "baseline"]
+
+    print("%-22s %10s %10s %9s %-14s %7s %9s %7s %12s" %
+          ("scenario", "median [s]", "worst [s]", "slowdown", "outcome",
+           "stalls", "not-ready", "failed", "injected [ms]"))
+    baseline = None
+    for name, variables in scenarios:
+        runs = [run_once(program, variables, args.timeout, args.library)
+                for _ in range(args.repeat)]
+        times = [r[0] for r in runs]
+        median = statistics.median(times)
+        if name == "baseline":
+            baseline = median
+        outcomes = {}
+        for r in runs:
+            outcomes[r[1]] = outcomes.get(r[1], 0) + 1
+        outcome = ",".join("%s x%d" % item if item[1] > 1 else item[0]
+                           for item in sorted(outcomes.items()))
+        total = {key: sum(r[2].get(key, 0) for r in runs) / len(runs)
+                 for key in ("stalls", "not_ready", "failed", "injected_ms")}
+        print("%-22s %10.3f %10.3f %8.2fx %-14s %7.1f %9.1f %7.1f %12.1f" %
+              (name, median, max(times), median / baseline, outcome,
+               total["stalls"], total["not_ready"], total["failed"],
+               total["injected_ms"]))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,283 @@
+// LD_PRELOAD shim that injects delays, stalls, spurious NOT_READY results and
+// failures into Level Zero sync, query, append and submit calls.
+//
+//   make -C level-zero-faults
+//   export ZE_FAULT_DELAY_US=sync=200 ZE_FAULT_NOT_READY=query=0.5
+//   LD_PRELOAD=$PWD/level-zero-faults/libze_faults.so ./main
+//
+// Settings are described in FaultConfig.hpp. Every other entry point goes
+// straight to the driver. Per call, in this order: the fixed delay, a stall
+// with the configured probability, then either a failure, a NOT_READY or the
+// real call. An injected NOT_READY from a wait with a finite timeout first
+// sleeps out the timeout, as a real expiry would; with an infinite timeout it
+// returns at once, which no conforming driver does. Injected failures and
+// NOT_READYs never reach the driver, so an append that "failed" appended
+// nothing. At exit one "ze_faults:" line per touched function goes to stderr
+// for degrade.py to collect, and also on SIGABRT, since an injected failure
+// usually ends the program through ZE_CHECK and std::terminate.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <random>
+#include <thread>
+
+#include <dlfcn.h>
+
+#include "ze_api.h"
+#include "FaultConfig.hpp"
+
+#define ZE_FAULT_INFINITE UINT64_MAX
+
+// Newer than the in-tree v1.4 header, but callback_repro.cpp syncs with it
+extern "C" ZE_APIEXPORT ze_result_t ZE_APICALL
+zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                             uint64_t timeout);
+
+// X(name, group, (parameters), (arguments), timeout)
+#define ZE_FAULT_FUNCTIONS(X)                                                  \
+  X(zeEventHostSynchronize, Sync, (ze_event_handle_t hEvent, uint64_t timeout), \
+    (hEvent, timeout), timeout)                                                \
+  X(zeCommandQueueSynchronize, Sync,                                           \
+    (ze_command_queue_handle_t hCommandQueue, uint64_t timeout),               \
+    (hCommandQueue, timeout), timeout)                                         \
+  X(zeFenceHostSynchronize, Sync, (ze_fence_handle_t hFence, uint64_t timeout), \
+    (hFence, timeout), timeout)                                                \
+  X(zeCommandListHostSynchronize, Sync,                                        \
+    (ze_command_list_handle_t hCommandList, uint64_t timeout),                 \
+    (hCommandList, timeout), timeout)                                          \
+  X(zeEventQueryStatus, Query, (ze_event_handle_t hEvent), (hEvent),           \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeFenceQueryStatus, Query, (ze_fence_handle_t hFence), (hFence),           \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeEventQueryKernelTimestamp, Query,                                        \
+    (ze_event_handle_t hEvent, ze_kernel_timestamp_result_t * dstptr),         \
+    (hEvent, dstptr), ZE_FAULT_INFINITE)                                       \
+  X(zeCommandListAppendLaunchKernel, Append,                                   \
+    (ze_command_list_handle_t hCommandList, ze_kernel_handle_t hKernel,        \
+     const ze_group_count_t *pLaunchFuncArgs, ze_event_handle_t hSignalEvent,  \
+     uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents),                 \
+    (hCommandList, hKernel, pLaunchFuncArgs, hSignalEvent, numWaitEvents,      \
+     phWaitEvents),                                                            \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendMemoryCopy, Append,                                     \
+    (ze_command_list_handle_t hCommandList, void *dstptr, const void *srcptr,  \
+     size_t size, ze_event_handle_t hSignalEvent, uint32_t numWaitEvents,      \
+     ze_event_handle_t *phWaitEvents),                                         \
+    (hCommandList, dstptr, srcptr, size, hSignalEvent, numWaitEvents,          \
+     phWaitEvents),                                                            \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendMemoryCopyRegion, Append,                               \
+    (ze_command_list_handle_t hCommandList, void *dstptr,                      \
+     const ze_copy_region_t *dstRegion, uint32_t dstPitch,                     \
+     uint32_t dstSlicePitch, const void *srcptr,                               \
+     const ze_copy_region_t *srcRegion, uint32_t srcPitch,                     \
+     uint32_t srcSlicePitch, ze_event_handle_t hSignalEvent,                   \
+     uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents),                 \
+    (hCommandList, dstptr, dstRegion, dstPitch, dstSlicePitch, srcptr,         \
+     srcRegion, srcPitch, srcSlicePitch, hSignalEvent, numWaitEvents,          \
+     phWaitEvents),                                                            \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendMemoryFill, Append,                                     \
+    (ze_command_list_handle_t hCommandList, void *ptr, const void *pattern,    \
+     size_t pattern_size, size_t size, ze_event_handle_t hSignalEvent,         \
+     uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents),                 \
+    (hCommandList, ptr, pattern, pattern_size, size, hSignalEvent,             \
+     numWaitEvents, phWaitEvents),                                             \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendBarrier, Append,                                        \
+    (ze_command_list_handle_t hCommandList, ze_event_handle_t hSignalEvent,    \
+     uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents),                 \
+    (hCommandList, hSignalEvent, numWaitEvents, phWaitEvents),                 \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendSignalEvent, Append,                                    \
+    (ze_command_list_handle_t hCommandList, ze_event_handle_t hEvent),         \
+    (hCommandList, hEvent), ZE_FAULT_INFINITE)                                 \
+  X(zeCommandListAppendWaitOnEvents, Append,                                   \
+    (ze_command_list_handle_t hCommandList, uint32_t numEvents,                \
+     ze_event_handle_t *phEvents),                                             \
+    (hCommandList, numEvents, phEvents), ZE_FAULT_INFINITE)                    \
+  X(zeCommandListAppendEventReset, Append,                                     \
+    (ze_command_list_handle_t hCommandList, ze_event_handle_t hEvent),         \
+    (hCommandList, hEvent), ZE_FAULT_INFINITE)                                 \
+  X(zeCommandListAppendWriteGlobalTimestamp, Append,                           \
+    (ze_command_list_handle_t hCommandList, uint64_t *dstptr,                  \
+     ze_event_handle_t hSignalEvent, uint32_t numWaitEvents,                   \
+     ze_event_handle_t *phWaitEvents),                                         \
+    (hCommandList, dstptr, hSignalEvent, numWaitEvents, phWaitEvents),         \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeCommandListAppendMemoryPrefetch, Append,                                 \
+    (ze_command_list_handle_t hCommandList, const void *ptr, size_t size),     \
+    (hCommandList, ptr, size), ZE_FAULT_INFINITE)                              \
+  X(zeCommandListAppendMemAdvise, Append,                                      \
+    (ze_command_list_handle_t hCommandList, ze_device_handle_t hDevice,        \
+     const void *ptr, size_t size, ze_memory_advice_t advice),                 \
+    (hCommandList, hDevice, ptr, size, advice), ZE_FAULT_INFINITE)             \
+  X(zeCommandQueueExecuteCommandLists, Submit,                                 \
+    (ze_command_queue_handle_t hCommandQueue, uint32_t numCommandLists,        \
+     ze_command_list_handle_t *phCommandLists, ze_fence_handle_t hFence),      \
+    (hCommandQueue, numCommandLists, phCommandLists, hFence),                  \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeEventHostSignal, Host, (ze_event_handle_t hEvent), (hEvent),             \
+    ZE_FAULT_INFINITE)                                                         \
+  X(zeEventHostReset, Host, (ze_event_handle_t hEvent), (hEvent),              \
+    ZE_FAULT_INFINITE)
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum FunctionIndex : size_t {
+#define ZE_FAULT_INDEX(name, group, params, args, timeout) name##Index,
+  ZE_FAULT_FUNCTIONS(ZE_FAULT_INDEX)
+#undef ZE_FAULT_INDEX
+      kNumFunctions
+};
+
+const FaultConfig::Function kFunctions[] = {
+#define ZE_FAULT_ENTRY(name, group, params, args, timeout)                     \
+  {#name, FaultGroup::group},
+    ZE_FAULT_FUNCTIONS(ZE_FAULT_ENTRY)
+#undef ZE_FAULT_ENTRY
+};
+
+struct FunctionStats {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> stalls{0};
+  std::atomic<uint64_t> notReady{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<uint64_t> injectedNs{0};
+};
+
+// Never destroyed: threads may still call into the API after exit handlers
+struct Injector {
+  FaultConfig config{kFunctions, kNumFunctions};
+  FunctionStats stats[kNumFunctions];
+  std::atomic<uint64_t> nextThread{0};
+};
+
+Injector &injector() {
+  static Injector *instance = new Injector;
+  return *instance;
+}
+
+void *realFunction(const char *name) {
+  void *function = dlsym(RTLD_NEXT, name);
+  if (!function)
+    fprintf(stderr, "ze_faults: %s not found in the next library\n", name);
+  return function;
+}
+
+std::mt19937_64 &randomEngine() {
+  thread_local std::mt19937_64 engine(injector().config.seed +
+                                      injector().nextThread.fetch_add(1));
+  return engine;
+}
+
+bool chance(double probability) {
+  if (probability <= 0.0)
+    return false;
+  return std::uniform_real_distribution<double>(0.0, 1.0)(randomEngine()) <
+         probability;
+}
+
+// Spin short delays so microsecond settings stay accurate
+void delayNs(uint64_t ns) {
+  auto deadline = Clock::now() + std::chrono::nanoseconds(ns);
+  if (ns > 2000000)
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns - 1000000));
+  while (Clock::now() < deadline)
+    ;
+}
+
+// Decides the fate of one call. Returns ZE_RESULT_SUCCESS when the real
+// function should run, otherwise the result to return instead.
+ze_result_t inject(size_t function, uint64_t timeout) {
+  Injector &in = injector();
+  FunctionStats &stats = in.stats[function];
+  uint64_t call = stats.calls.fetch_add(1, std::memory_order_relaxed);
+  const FaultRule &rule = in.config.rule(function);
+  if (!rule.active() || call < in.config.skip)
+    return ZE_RESULT_SUCCESS;
+
+  uint64_t ns = uint64_t(rule.delayUs * 1e3);
+  if (chance(rule.stallProbability)) {
+    ns += uint64_t(rule.stallUs * 1e3);
+    stats.stalls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  ze_result_t result = ZE_RESULT_SUCCESS;
+  if (chance(rule.failProbability)) {
+    result = in.config.error;
+    stats.failed.fetch_add(1, std::memory_order_relaxed);
+  } else if (chance(rule.notReadyProbability)) {
+    result = ZE_RESULT_NOT_READY;
+    if (timeout != ZE_FAULT_INFINITE)
+      ns += timeout;
+    stats.notReady.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (ns > 0) {
+    delayNs(ns);
+    stats.injectedNs.fetch_add(ns, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+std::atomic<bool> reported{false};
+
+// Once, from whichever of exit and abort comes first
+void writeReport() {
+  Injector &in = injector();
+  if (!in.config.report || reported.exchange(true))
+    return;
+  for (size_t f = 0; f < kNumFunctions; f++) {
+    const FunctionStats &s = in.stats[f];
+    if (!in.config.rule(f).active() || s.calls == 0)
+      continue;
+    fprintf(stderr,
+            "ze_faults: %s calls=%lu stalls=%lu not_ready=%lu failed=%lu "
+            "injected_ms=%.3f\n",
+            kFunctions[f].name, (unsigned long)s.calls.load(),
+            (unsigned long)s.stalls.load(), (unsigned long)s.notReady.load(),
+            (unsigned long)s.failed.load(), s.injectedNs.load() / 1e6);
+  }
+}
+
+// std::terminate aborts on the thread that failed, so stdio is usable here
+// in practice. The default action then runs as if we were never called.
+void onAbort(int signal) {
+  writeReport();
+  std::raise(signal);
+}
+
+__attribute__((constructor)) void install() {
+  injector();
+  std::atexit(writeReport);
+  // Leave a handler the program installed itself alone
+  struct sigaction previous {};
+  if (sigaction(SIGABRT, nullptr, &previous) == 0 &&
+      previous.sa_handler == SIG_DFL) {
+    struct sigaction action {};
+    action.sa_handler = onAbort;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGABRT, &action, nullptr);
+  }
+}
+
+} // namespace
+
+#define ZE_FAULT_WRAPPER(name, group, params, args, timeout)                   \
+  ze_result_t ZE_APICALL name params {                                         \
+    static auto real = reinterpret_cast<decltype(&name)>(realFunction(#name));  \
+    if (!real)                                                                 \
+      return ZE_RESULT_ERROR_UNINITIALIZED;                                    \
+    ze_result_t injected = inject(name##Index, timeout);                       \
+    if (injected != ZE_RESULT_SUCCESS)                                         \
+      return injected;                                                         \
+    return real args;                                                          \
+  }
+ZE_FAULT_FUNCTIONS(ZE_FAULT_WRAPPER)
+#undef ZE_FAULT_WRAPPER
@@ -0,0 +1,179 @@
+// Per-thread call counts and latency histograms for a fixed set of functions.
+//
+// record() is the hot path: the calling thread's slot is found through a
+// thread_local pointer and updated with relaxed atomics, so after a thread's
+// first call there is no locking and no sharing between threads. The only
+// cost of an idle function is its memory. Histograms use four buckets per
+// power of two of nanoseconds, up to about 18 minutes; percentiles are bucket
+// upper bounds, so at most 25% high.
+//
+// report() may run while other threads still record; it then sees a
+// slightly stale but consistent-enough snapshot.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class LatencyRecorder {
+public:
+  static constexpr int kSubBuckets = 4;
+  static constexpr int kMaxExponent = 40;
+  static constexpr int kBuckets = kSubBuckets * kMaxExponent;
+
+  LatencyRecorder(const char *const *names, size_t count)
+      : names(names), count(count) {}
+
+  void record(size_t function, uint64_t ns) {
+    FunctionStats &stats = threadStats().functions[function];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > stats.maxNs.load(std::memory_order_relaxed))
+      stats.maxNs.store(ns, std::memory_order_relaxed);
+    stats.buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Totals over all threads, then one block per thread. With histograms on,
+  // every called function's non-empty buckets follow its total.
+  void report(std::ostream &out, bool histograms) {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    std::vector<Summary> totals(count);
+    for (auto &thread : threads)
+      for (size_t f = 0; f < count; f++)
+        totals[f].add(thread->functions[f]);
+
+    out << "\nLevel Zero host API latency, " << threads.size()
+        << " thread(s)\n";
+    printTable(out, totals, histograms);
+    for (auto &thread : threads) {
+      std::vector<Summary> perThread(count);
+      for (size_t f = 0; f < count; f++)
+        perThread[f].add(thread->functions[f]);
+      out << "\nthread " << thread->index << " (tid " << thread->tid << ")\n";
+      printTable(out, perThread, false);
+    }
+  }
+
+private:
+  struct FunctionStats {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+  };
+
+  struct ThreadStats {
+    uint32_t index;
+    pid_t tid;
+    std::unique_ptr<FunctionStats[]> functions;
+  };
+
+  struct Summary {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t buckets[kBuckets] = {};
+
+    void add(const FunctionStats &stats) {
+      calls += stats.calls.load(std::memory_order_relaxed);
+      totalNs += stats.totalNs.load(std::memory_order_relaxed);
+      maxNs = std::max(maxNs, stats.maxNs.load(std::memory_order_relaxed));
+      for (int b = 0; b < kBuckets; b++)
+        buckets[b] += stats.buckets[b].load(std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the q-quantile
+    uint64_t percentileNs(double q) const {
+      uint64_t rank = uint64_t(q * (calls - 1)) + 1;
+      uint64_t seen = 0;
+      for (int b = 0; b < kBuckets; b++) {
+        seen += buckets[b];
+        if (seen >= rank)
+          return std::min(lowerBound(b + 1), maxNs);
+      }
+      return maxNs;
+    }
+  };
+
+  // Buckets 0-3 are exact; above, 4 linear steps per power of two
+  static int bucket(uint64_t ns) {
+    if (ns < kSubBuckets)
+      return int(ns);
+    int exponent = 63 - __builtin_clzll(ns);
+    if (exponent >= kMaxExponent)
+      return kBuckets - 1;
+    int sub = int(ns >> (exponent - 2)) & (kSubBuckets - 1);
+    return kSubBuckets * (exponent - 1) + sub;
+  }
+
+  static uint64_t lowerBound(int b) {
+    if (b < kSubBuckets)
+      return uint64_t(b);
+    int exponent = b / kSubBuckets + 1;
+    return uint64_t(kSubBuckets + b % kSubBuckets) << (exponent - 2);
+  }
+
+  ThreadStats &threadStats() {
+    thread_local ThreadStats *stats = nullptr;
+    if (!stats)
+      stats = addThread();
+    return *stats;
+  }
+
+  // Thread slots live until exit so threads that finished still report
+  ThreadStats *addThread() {
+    auto stats = new ThreadStats;
+    stats->tid = pid_t(syscall(SYS_gettid));
+    stats->functions.reset(new FunctionStats[count]);
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    stats->index = uint32_t(threads.size());
+    threads.emplace_back(stats);
+    return stats;
+  }
+
+  void printTable(std::ostream &out, const std::vector<Summary> &summaries,
+                  bool histograms) {
+    std::vector<size_t> order;
+    for (size_t f = 0; f < count; f++)
+      if (summaries[f].calls > 0)
+        order.push_back(f);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return summaries[a].totalNs > summaries[b].totalNs;
+    });
+
+    out << std::left << std::setw(44) << "function" << std::right
+        << std::setw(10) << "calls" << std::setw(12) << "total [ms]"
+        << std::setw(11) << "mean [us]" << std::setw(11) << "p50 [us]"
+        << std::setw(11) << "p99 [us]" << std::setw(11) << "max [us]"
+        << "\n";
+    out << std::fixed << std::setprecision(2);
+    for (size_t f : order) {
+      const Summary &s = summaries[f];
+      out << std::left << std::setw(44) << names[f] << std::right
+          << std::setw(10) << s.calls << std::setw(12) << s.totalNs / 1e6
+          << std::setw(11) << s.totalNs / 1e3 / s.calls << std::setw(11)
+          << s.percentileNs(0.50) / 1e3 << std::setw(11)
+          << s.percentileNs(0.99) / 1e3 << std::setw(11) << s.maxNs / 1e3
+          << "\n";
+      if (!histograms)
+        continue;
+      for (int b = 0; b < kBuckets; b++)
+        if (s.buckets[b] > 0)
+          out << "    < " << std::setw(12) << lowerBound(b + 1) / 1e3
+              << " us" << std::setw(12) << s.buckets[b] << "\n";
+    }
+    out << std::defaultfloat;
+  }
+
+  const char *const *names;
+  size_t count;
+  std::mutex threadsMutex;
+  std::vector<std::unique_ptr<ThreadStats>> threads;
+};
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+"""Emit the ZE_LATENCY_FUNCTIONS X-macro for every entry point in ze_api.h.
+
+Each entry is X(name, (parameter declarations), (argument names)), which
+ze_latency.cpp expands into a timed forwarding wrapper.
+
+Usage: gen_wrappers.py path/to/ze_api.h > zeFunctions.inc
+"""
+
+import re
+import sys
+
+PROTOTYPE = re.compile(
+    r"^ZE_APIEXPORT\s+ze_result_t\s+ZE_APICALL\s*\n(ze\w+)\((.*?)\);",
+    re.MULTILINE | re.DOTALL)
+
+
+def parameters(body):
+    body = re.sub(r"///.*", "", body)
+    declarations = [" ".join(p.split()) for p in body.split(",")]
+    declarations = [d for d in declarations if d and d != "void"]
+    names = [re.search(r"(\w+)$", d).group(1) for d in declarations]
+    return declarations, names
+
+
+def main():
+    with open(sys.argv[1]) as header:
+        text = header.read()
+    print("// Generated by gen_wrappers.py from " + sys.argv[1] +
+          ", do not edit")
+    print("#define ZE_LATENCY_FUNCTIONS(X) \\")
+    for name, body in PROTOTYPE.findall(text):
+        declarations, names = parameters(body)
+        print("  X(%s, (%s), (%s)) \\" %
+              (name, ", ".join(declarations), ", ".join(names)))
+    print()
+
+
+if __name__ == "__main__":
+    main()
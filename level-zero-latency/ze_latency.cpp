@@ -0,0 +1,103 @@
+// LD_PRELOAD shim that times every Level Zero entry point on the host.
+//
+//   make -C level-zero-latency
+//   LD_PRELOAD=$PWD/level-zero-latency/libze_latency.so ./main
+//
+// Each ze* function in ze_api.h (listed by gen_wrappers.py) is replaced by a
+// wrapper that forwards to the next definition (the loader, or the CPU
+// stand-in driver) and records the call's wall time per function and per
+// thread, see LatencyRecorder.hpp. The cost per call is two clock reads and
+// a few uncontended atomic adds. At exit a report sorted by total time goes
+// to stderr, or to the file named by ZE_LATENCY_OUTPUT; ZE_LATENCY_HISTOGRAM=1
+// adds the bucket counts of every function.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <dlfcn.h>
+
+#include "ze_api.h"
+#include "LatencyRecorder.hpp"
+#include "zeFunctions.inc"
+
+namespace {
+
+enum FunctionIndex : size_t {
+#define ZE_LATENCY_INDEX(name, params, args) name##Index,
+  ZE_LATENCY_FUNCTIONS(ZE_LATENCY_INDEX)
+#undef ZE_LATENCY_INDEX
+      kNumFunctions
+};
+
+const char *const kFunctionNames[] = {
+#define ZE_LATENCY_NAME(name, params, args) #name,
+    ZE_LATENCY_FUNCTIONS(ZE_LATENCY_NAME)
+#undef ZE_LATENCY_NAME
+};
+
+// Never destroyed: threads may still call into the API after exit handlers
+LatencyRecorder &recorder() {
+  static LatencyRecorder *instance =
+      new LatencyRecorder(kFunctionNames, kNumFunctions);
+  return *instance;
+}
+
+void *realFunction(const char *name) {
+  void *function = dlsym(RTLD_NEXT, name);
+  if (!function)
+    fprintf(stderr, "ze_latency: %s not found in the next library\n", name);
+  return function;
+}
+
+class ScopedTimer {
+public:
+  explicit ScopedTimer(size_t function)
+      : function(function), begin(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    auto end = std::chrono::steady_clock::now();
+    recorder().record(
+        function,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+            .count());
+  }
+
+private:
+  size_t function;
+  std::chrono::steady_clock::time_point begin;
+};
+
+void writeReport() {
+  const char *histogram = std::getenv("ZE_LATENCY_HISTOGRAM");
+  bool histograms = histogram && std::atoi(histogram) != 0;
+  const char *path = std::getenv("ZE_LATENCY_OUTPUT");
+  if (path) {
+    std::ofstream file(path);
+    if (file) {
+      recorder().report(file, histograms);
+      return;
+    }
+    fprintf(stderr, "ze_latency: cannot write %s\n", path);
+  }
+  recorder().report(std::cerr, histograms);
+}
+
+__attribute__((constructor)) void install() {
+  recorder();
+  std::atexit(writeReport);
+}
+
+} // namespace
+
+#define ZE_LATENCY_WRAPPER(name, params, args)                               \
+  ze_result_t ZE_APICALL name params {                                       \
+    static auto real = reinterpret_cast<decltype(&name)>(realFunction(#name)); \
+    if (!real)                                                               \
+      return ZE_RESULT_ERROR_UNINITIALIZED;                                  \
+    ScopedTimer timer(name##Index);                                          \
+    return real args;                                                        \
+  }
+ZE_LATENCY_FUNCTIONS(ZE_LATENCY_WRAPPER)
+#undef ZE_LATENCY_WRAPPER
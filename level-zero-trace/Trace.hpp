@@ -0,0 +1,173 @@
+// Binary trace format shared by the recorder (ze_trace.cpp) and the replayer
+// (zereplay.cpp).
+//
+// A trace is a 16-byte header ("ZETRACE\0", uint32_t version, uint32_t 0)
+// followed by one record per completed API call, in completion order:
+//
+//   varint function    index into ZE_TRACE_FUNCTIONS
+//   varint thread      recording thread, in order of first call
+//   varint time        ns from the start of the trace to the call's entry
+//   varint result      ze_result_t returned
+//   varint size        payload bytes, then the payload
+//
+// Payloads hold the call's inputs followed, for successful calls, by its
+// outputs. All integers are LEB128 varints. Handles are small ids given out
+// when the recorder first sees them returned; pointers are an allocation id
+// and an offset (id 0 is memory the driver did not allocate, with the raw
+// address and the bytes the call touches). Descriptors are stored field by
+// field without pNext chains. Memory contents are not recorded, only sizes;
+// module IL and kernel argument values are.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Recorded functions. Ids are positions in this list and are part of the
+// format: append new functions at the end and bump kTraceVersion otherwise.
+#define ZE_TRACE_FUNCTIONS(X)                                                  \
+  X(zeInit)                                                                    \
+  X(zeDriverGet)                                                               \
+  X(zeDeviceGet)                                                               \
+  X(zeDeviceGetProperties)                                                     \
+  X(zeDeviceGetCommandQueueGroupProperties)                                    \
+  X(zeDeviceGetMemoryProperties)                                               \
+  X(zeDeviceGetGlobalTimestamps)                                               \
+  X(zeContextCreate)                                                           \
+  X(zeContextDestroy)                                                          \
+  X(zeContextMakeMemoryResident)                                               \
+  X(zeContextEvictMemory)                                                      \
+  X(zeCommandQueueCreate)                                                      \
+  X(zeCommandQueueDestroy)                                                     \
+  X(zeCommandQueueExecuteCommandLists)                                         \
+  X(zeCommandQueueSynchronize)                                                 \
+  X(zeCommandListCreate)                                                       \
+  X(zeCommandListCreateImmediate)                                              \
+  X(zeCommandListDestroy)                                                      \
+  X(zeCommandListClose)                                                        \
+  X(zeCommandListReset)                                                        \
+  X(zeCommandListAppendBarrier)                                                \
+  X(zeCommandListAppendLaunchKernel)                                           \
+  X(zeCommandListAppendMemAdvise)                                              \
+  X(zeCommandListAppendMemoryCopy)                                             \
+  X(zeCommandListAppendMemoryCopyRegion)                                       \
+  X(zeCommandListAppendMemoryFill)                                             \
+  X(zeCommandListAppendMemoryPrefetch)                                         \
+  X(zeCommandListAppendSignalEvent)                                            \
+  X(zeCommandListAppendWaitOnEvents)                                           \
+  X(zeCommandListAppendWriteGlobalTimestamp)                                   \
+  X(zeEventPoolCreate)                                                         \
+  X(zeEventPoolDestroy)                                                        \
+  X(zeEventCreate)                                                             \
+  X(zeEventDestroy)                                                            \
+  X(zeEventHostReset)                                                          \
+  X(zeEventHostSignal)                                                         \
+  X(zeEventHostSynchronize)                                                    \
+  X(zeEventQueryStatus)                                                        \
+  X(zeEventQueryKernelTimestamp)                                               \
+  X(zeKernelCreate)                                                            \
+  X(zeKernelDestroy)                                                           \
+  X(zeKernelSetArgumentValue)                                                  \
+  X(zeKernelSetGroupSize)                                                      \
+  X(zeKernelSuggestGroupSize)                                                  \
+  X(zeKernelSetIndirectAccess)                                                 \
+  X(zeMemAllocDevice)                                                          \
+  X(zeMemAllocHost)                                                            \
+  X(zeMemAllocShared)                                                          \
+  X(zeMemFree)                                                                 \
+  X(zeMemGetAllocProperties)                                                   \
+  X(zeModuleCreate)                                                            \
+  X(zeModuleDestroy)                                                           \
+  X(zeModuleBuildLogGetString)                                                 \
+  X(zeModuleBuildLogDestroy)                                                   \
+  X(zeVirtualMemQueryPageSize)                                                 \
+  X(zeVirtualMemReserve)                                                       \
+  X(zeVirtualMemFree)                                                          \
+  X(zePhysicalMemCreate)                                                       \
+  X(zePhysicalMemDestroy)                                                      \
+  X(zeVirtualMemMap)                                                           \
+  X(zeVirtualMemUnmap)                                                         \
+  X(zeCommandListHostSynchronize)
+
+enum class TraceFunction : uint32_t {
+#define ZE_TRACE_ENUM(name) name,
+  ZE_TRACE_FUNCTIONS(ZE_TRACE_ENUM)
+#undef ZE_TRACE_ENUM
+      Count
+};
+
+const char *const kTraceFunctionNames[] = {
+#define ZE_TRACE_NAME(name) #name,
+    ZE_TRACE_FUNCTIONS(ZE_TRACE_NAME)
+#undef ZE_TRACE_NAME
+};
+
+constexpr char kTraceMagic[8] = {'Z', 'E', 'T', 'R', 'A', 'C', 'E', 0};
+constexpr uint32_t kTraceVersion = 1;
+
+// How a zeKernelSetArgumentValue value was stored
+enum class TraceArg : uint32_t { Bytes, Pointer, Local };
+
+class TraceWriter {
+public:
+  void u(uint64_t value) {
+    while (value >= 0x80) {
+      data.push_back(uint8_t(value) | 0x80);
+      value >>= 7;
+    }
+    data.push_back(uint8_t(value));
+  }
+
+  void bytes(const void *source, size_t size) {
+    u(size);
+    auto begin = static_cast<const uint8_t *>(source);
+    data.insert(data.end(), begin, begin + size);
+  }
+
+  void str(const char *text) { bytes(text ? text : "", text ? strlen(text) : 0); }
+
+  std::vector<uint8_t> data;
+};
+
+class TraceReader {
+public:
+  TraceReader(const uint8_t *begin, const uint8_t *end)
+      : position(begin), end(end) {}
+
+  uint64_t u() {
+    uint64_t value = 0;
+    for (int shift = 0; position < end && shift < 64; shift += 7) {
+      uint8_t byte = *position++;
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+    truncated = true;
+    return value;
+  }
+
+  std::vector<uint8_t> bytes() {
+    size_t size = u();
+    if (size > size_t(end - position)) {
+      truncated = true;
+      size = end - position;
+    }
+    std::vector<uint8_t> value(position, position + size);
+    position += size;
+    return value;
+  }
+
+  std::string str() {
+    auto value = bytes();
+    return std::string(value.begin(), value.end());
+  }
+
+  bool done() const { return position >= end; }
+  bool ok() const { return !truncated; }
+  const uint8_t *current() const { return position; }
+
+private:
+  const uint8_t *position;
+  const uint8_t *end;
+  bool truncated = false;
+};
@@ -0,0 +1,953 @@
+// LD_PRELOAD recorder for the Level Zero calls listed in Trace.hpp.
+//
+//   make -C level-zero-trace
+//   LD_PRELOAD=$PWD/level-zero-trace/libze_trace.so ./main
+//   level-zero-trace/zereplay ze.trace
+//
+// Every recorded function forwards to the next definition (the loader or the
+// CPU stand-in driver) and appends a record once the call returns, so the
+// stream is in completion order across threads. The trace goes to the file
+// named by ZE_TRACE_OUTPUT (default ze.trace); it is flushed when a context
+// is destroyed and at exit, so a run that terminates early keeps everything
+// up to its last zeContextDestroy. Functions outside the list pass through
+// untraced.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include <dlfcn.h>
+
+#include "ze_api.h"
+#include "Trace.hpp"
+
+// zeCommandListHostSynchronize is newer than the in-tree v1.4 header but
+// level-zero-callbacks uses it
+extern "C" ZE_APIEXPORT ze_result_t ZE_APICALL
+zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                             uint64_t timeout);
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Handle ids, USM allocation ids and the output file
+struct TraceState {
+  std::mutex mutex;
+  std::unordered_map<const void *, uint64_t> handles;
+  uint64_t nextHandle = 1;
+  struct Region {
+    uint64_t id;
+    size_t size;
+  };
+  std::map<uintptr_t, Region> regions;
+  uint64_t nextRegion = 1;
+
+  std::mutex outputMutex;
+  FILE *output = nullptr;
+  Clock::time_point start = Clock::now();
+  uint32_t nextThread = 0;
+};
+
+// Never destroyed: other threads may still be tracing during exit
+TraceState &state() {
+  static TraceState *instance = new TraceState;
+  return *instance;
+}
+
+void *realFunction(const char *name) {
+  void *function = dlsym(RTLD_NEXT, name);
+  if (!function)
+    fprintf(stderr, "ze_trace: %s not found in the next library\n", name);
+  return function;
+}
+
+void flushTrace() {
+  std::lock_guard<std::mutex> lock(state().outputMutex);
+  if (state().output)
+    fflush(state().output);
+}
+
+__attribute__((constructor)) void openTrace() {
+  const char *path = std::getenv("ZE_TRACE_OUTPUT");
+  if (!path)
+    path = "ze.trace";
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    fprintf(stderr, "ze_trace: cannot write %s, not tracing\n", path);
+    return;
+  }
+  uint32_t header[2] = {kTraceVersion, 0};
+  fwrite(kTraceMagic, 1, sizeof(kTraceMagic), file);
+  fwrite(header, 1, sizeof(header), file);
+  state().output = file;
+  std::atexit(flushTrace);
+}
+
+// One record under construction. Inputs are encoded before the real call,
+// outputs after it, and commit() writes the record.
+class Call {
+public:
+  explicit Call(TraceFunction function)
+      : function(function), entry(Clock::now()), payload(threadPayload()) {
+    payload.data.clear();
+  }
+
+  void u(uint64_t value) { payload.u(value); }
+  void bytes(const void *data, size_t size) { payload.bytes(data, size); }
+  void str(const char *text) { payload.str(text); }
+
+  void handle(const void *handle) {
+    if (!handle) {
+      u(0);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(state().mutex);
+    auto it = state().handles.find(handle);
+    u(it == state().handles.end() ? 0 : it->second);
+  }
+
+  void newHandle(const void *handle) {
+    std::lock_guard<std::mutex> lock(state().mutex);
+    uint64_t id = state().nextHandle++;
+    state().handles[handle] = id;
+    u(id);
+  }
+
+  // A pointer the call reads or writes `size` bytes at
+  void pointer(const void *ptr, size_t size) {
+    uint64_t id = 0;
+    uint64_t offset = 0;
+    lookup(ptr, id, offset);
+    u(id);
+    if (id) {
+      u(offset);
+    } else {
+      u(uintptr_t(ptr));
+      u(size);
+    }
+  }
+
+  // Allocation id and offset of ptr, false if the driver did not allocate it
+  static bool lookup(const void *ptr, uint64_t &id, uint64_t &offset) {
+    std::lock_guard<std::mutex> lock(state().mutex);
+    auto &regions = state().regions;
+    auto it = regions.upper_bound(uintptr_t(ptr));
+    if (it == regions.begin())
+      return false;
+    --it;
+    if (uintptr_t(ptr) >= it->first + it->second.size)
+      return false;
+    id = it->second.id;
+    offset = uintptr_t(ptr) - it->first;
+    return true;
+  }
+
+  void newRegion(const void *ptr, size_t size) {
+    std::lock_guard<std::mutex> lock(state().mutex);
+    uint64_t id = state().nextRegion++;
+    state().regions[uintptr_t(ptr)] = {id, size};
+    u(id);
+  }
+
+  void dropRegion(const void *ptr) {
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().regions.erase(uintptr_t(ptr));
+  }
+
+  void events(ze_event_handle_t signal, uint32_t numWaits,
+              const ze_event_handle_t *waits) {
+    handle(signal);
+    u(waits ? numWaits : 0);
+    for (uint32_t i = 0; waits && i < numWaits; i++)
+      handle(waits[i]);
+  }
+
+  ze_result_t commit(ze_result_t result) {
+    thread_local uint32_t thread = UINT32_MAX;
+    auto &s = state();
+    std::lock_guard<std::mutex> lock(s.outputMutex);
+    if (!s.output)
+      return result;
+    if (thread == UINT32_MAX)
+      thread = s.nextThread++;
+    TraceWriter header;
+    header.u(uint32_t(function));
+    header.u(thread);
+    header.u(std::chrono::duration_cast<std::chrono::nanoseconds>(entry -
+                                                                  s.start)
+                 .count());
+    header.u(uint32_t(result));
+    header.u(payload.data.size());
+    fwrite(header.data.data(), 1, header.data.size(), s.output);
+    fwrite(payload.data.data(), 1, payload.data.size(), s.output);
+    return result;
+  }
+
+private:
+  static TraceWriter &threadPayload() {
+    thread_local TraceWriter writer;
+    return writer;
+  }
+
+  TraceFunction function;
+  Clock::time_point entry;
+  TraceWriter &payload;
+};
+
+// Bytes spanned by a copy region
+size_t regionExtent(const ze_copy_region_t *region, uint32_t pitch,
+                    uint32_t slicePitch) {
+  uint32_t depth = region->depth ? region->depth : 1;
+  return size_t(region->originZ + depth - 1) * slicePitch +
+         size_t(region->originY + region->height - 1) * pitch +
+         region->originX + region->width;
+}
+
+void putRegion(Call &call, const ze_copy_region_t *region) {
+  call.u(region->originX);
+  call.u(region->originY);
+  call.u(region->originZ);
+  call.u(region->width);
+  call.u(region->height);
+  call.u(region->depth);
+}
+
+} // namespace
+
+#define ZE_TRACE_REAL(name)                                                    \
+  static auto real = reinterpret_cast<decltype(&name)>(realFunction(#name));   \
+  if (!real)                                                                   \
+    return ZE_RESULT_ERROR_UNINITIALIZED;                                      \
+  Call call(TraceFunction::name)
+
+// Driver and device
+
+ze_result_t zeInit(ze_init_flags_t flags) {
+  ZE_TRACE_REAL(zeInit);
+  call.u(flags);
+  return call.commit(real(flags));
+}
+
+ze_result_t zeDriverGet(uint32_t *pCount, ze_driver_handle_t *phDrivers) {
+  ZE_TRACE_REAL(zeDriverGet);
+  call.u(phDrivers != nullptr);
+  call.u(pCount ? *pCount : 0);
+  ze_result_t result = real(pCount, phDrivers);
+  if (result == ZE_RESULT_SUCCESS && phDrivers) {
+    call.u(*pCount);
+    for (uint32_t i = 0; i < *pCount; i++)
+      call.newHandle(phDrivers[i]);
+  }
+  return call.commit(result);
+}
+
+ze_result_t zeDeviceGet(ze_driver_handle_t hDriver, uint32_t *pCount,
+                        ze_device_handle_t *phDevices) {
+  ZE_TRACE_REAL(zeDeviceGet);
+  call.handle(hDriver);
+  call.u(phDevices != nullptr);
+  call.u(pCount ? *pCount : 0);
+  ze_result_t result = real(hDriver, pCount, phDevices);
+  if (result == ZE_RESULT_SUCCESS && phDevices) {
+    call.u(*pCount);
+    for (uint32_t i = 0; i < *pCount; i++)
+      call.newHandle(phDevices[i]);
+  }
+  return call.commit(result);
+}
+
+ze_result_t zeDeviceGetProperties(ze_device_handle_t hDevice,
+                                  ze_device_properties_t *pDeviceProperties) {
+  ZE_TRACE_REAL(zeDeviceGetProperties);
+  call.handle(hDevice);
+  return call.commit(real(hDevice, pDeviceProperties));
+}
+
+ze_result_t zeDeviceGetCommandQueueGroupProperties(
+    ze_device_handle_t hDevice, uint32_t *pCount,
+    ze_command_queue_group_properties_t *pCommandQueueGroupProperties) {
+  ZE_TRACE_REAL(zeDeviceGetCommandQueueGroupProperties);
+  call.handle(hDevice);
+  call.u(pCommandQueueGroupProperties != nullptr);
+  call.u(pCount ? *pCount : 0);
+  return call.commit(real(hDevice, pCount, pCommandQueueGroupProperties));
+}
+
+ze_result_t
+zeDeviceGetMemoryProperties(ze_device_handle_t hDevice, uint32_t *pCount,
+                            ze_device_memory_properties_t *pMemProperties) {
+  ZE_TRACE_REAL(zeDeviceGetMemoryProperties);
+  call.handle(hDevice);
+  call.u(pMemProperties != nullptr);
+  call.u(pCount ? *pCount : 0);
+  return call.commit(real(hDevice, pCount, pMemProperties));
+}
+
+ze_result_t zeDeviceGetGlobalTimestamps(ze_device_handle_t hDevice,
+                                        uint64_t *hostTimestamp,
+                                        uint64_t *deviceTimestamp) {
+  ZE_TRACE_REAL(zeDeviceGetGlobalTimestamps);
+  call.handle(hDevice);
+  return call.commit(real(hDevice, hostTimestamp, deviceTimestamp));
+}
+
+// Contexts
+
+ze_result_t zeContextCreate(ze_driver_handle_t hDriver,
+                            const ze_context_desc_t *desc,
+                            ze_context_handle_t *phContext) {
+  ZE_TRACE_REAL(zeContextCreate);
+  call.handle(hDriver);
+  call.u(desc->flags);
+  ze_result_t result = real(hDriver, desc, phContext);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phContext);
+  return call.commit(result);
+}
+
+ze_result_t zeContextDestroy(ze_context_handle_t hContext) {
+  ze_result_t result;
+  {
+    ZE_TRACE_REAL(zeContextDestroy);
+    call.handle(hContext);
+    result = call.commit(real(hContext));
+  }
+  flushTrace();
+  return result;
+}
+
+ze_result_t zeContextMakeMemoryResident(ze_context_handle_t hContext,
+                                        ze_device_handle_t hDevice, void *ptr,
+                                        size_t size) {
+  ZE_TRACE_REAL(zeContextMakeMemoryResident);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.pointer(ptr, size);
+  call.u(size);
+  return call.commit(real(hContext, hDevice, ptr, size));
+}
+
+ze_result_t zeContextEvictMemory(ze_context_handle_t hContext,
+                                 ze_device_handle_t hDevice, void *ptr,
+                                 size_t size) {
+  ZE_TRACE_REAL(zeContextEvictMemory);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.pointer(ptr, size);
+  call.u(size);
+  return call.commit(real(hContext, hDevice, ptr, size));
+}
+
+// Command queues and lists
+
+namespace {
+void putQueueDesc(Call &call, const ze_command_queue_desc_t *desc) {
+  call.u(desc->ordinal);
+  call.u(desc->index);
+  call.u(desc->flags);
+  call.u(desc->mode);
+  call.u(desc->priority);
+}
+} // namespace
+
+ze_result_t zeCommandQueueCreate(ze_context_handle_t hContext,
+                                 ze_device_handle_t hDevice,
+                                 const ze_command_queue_desc_t *desc,
+                                 ze_command_queue_handle_t *phCommandQueue) {
+  ZE_TRACE_REAL(zeCommandQueueCreate);
+  call.handle(hContext);
+  call.handle(hDevice);
+  putQueueDesc(call, desc);
+  ze_result_t result = real(hContext, hDevice, desc, phCommandQueue);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phCommandQueue);
+  return call.commit(result);
+}
+
+ze_result_t zeCommandQueueDestroy(ze_command_queue_handle_t hCommandQueue) {
+  ZE_TRACE_REAL(zeCommandQueueDestroy);
+  call.handle(hCommandQueue);
+  return call.commit(real(hCommandQueue));
+}
+
+ze_result_t
+zeCommandQueueExecuteCommandLists(ze_command_queue_handle_t hCommandQueue,
+                                  uint32_t numCommandLists,
+                                  ze_command_list_handle_t *phCommandLists,
+                                  ze_fence_handle_t hFence) {
+  ZE_TRACE_REAL(zeCommandQueueExecuteCommandLists);
+  call.handle(hCommandQueue);
+  call.u(numCommandLists);
+  for (uint32_t i = 0; i < numCommandLists; i++)
+    call.handle(phCommandLists[i]);
+  call.handle(hFence);
+  return call.commit(
+      real(hCommandQueue, numCommandLists, phCommandLists, hFence));
+}
+
+ze_result_t zeCommandQueueSynchronize(ze_command_queue_handle_t hCommandQueue,
+                                      uint64_t timeout) {
+  ZE_TRACE_REAL(zeCommandQueueSynchronize);
+  call.handle(hCommandQueue);
+  call.u(timeout);
+  return call.commit(real(hCommandQueue, timeout));
+}
+
+ze_result_t zeCommandListCreate(ze_context_handle_t hContext,
+                                ze_device_handle_t hDevice,
+                                const ze_command_list_desc_t *desc,
+                                ze_command_list_handle_t *phCommandList) {
+  ZE_TRACE_REAL(zeCommandListCreate);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.u(desc->commandQueueGroupOrdinal);
+  call.u(desc->flags);
+  ze_result_t result = real(hContext, hDevice, desc, phCommandList);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phCommandList);
+  return call.commit(result);
+}
+
+ze_result_t
+zeCommandListCreateImmediate(ze_context_handle_t hContext,
+                             ze_device_handle_t hDevice,
+                             const ze_command_queue_desc_t *altdesc,
+                             ze_command_list_handle_t *phCommandList) {
+  ZE_TRACE_REAL(zeCommandListCreateImmediate);
+  call.handle(hContext);
+  call.handle(hDevice);
+  putQueueDesc(call, altdesc);
+  ze_result_t result = real(hContext, hDevice, altdesc, phCommandList);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phCommandList);
+  return call.commit(result);
+}
+
+ze_result_t zeCommandListDestroy(ze_command_list_handle_t hCommandList) {
+  ZE_TRACE_REAL(zeCommandListDestroy);
+  call.handle(hCommandList);
+  return call.commit(real(hCommandList));
+}
+
+ze_result_t zeCommandListClose(ze_command_list_handle_t hCommandList) {
+  ZE_TRACE_REAL(zeCommandListClose);
+  call.handle(hCommandList);
+  return call.commit(real(hCommandList));
+}
+
+ze_result_t zeCommandListReset(ze_command_list_handle_t hCommandList) {
+  ZE_TRACE_REAL(zeCommandListReset);
+  call.handle(hCommandList);
+  return call.commit(real(hCommandList));
+}
+
+ze_result_t zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                                         uint64_t timeout) {
+  ZE_TRACE_REAL(zeCommandListHostSynchronize);
+  call.handle(hCommandList);
+  call.u(timeout);
+  return call.commit(real(hCommandList, timeout));
+}
+
+ze_result_t zeCommandListAppendBarrier(ze_command_list_handle_t hCommandList,
+                                       ze_event_handle_t hSignalEvent,
+                                       uint32_t numWaitEvents,
+                                       ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendBarrier);
+  call.handle(hCommandList);
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(
+      real(hCommandList, hSignalEvent, numWaitEvents, phWaitEvents));
+}
+
+ze_result_t zeCommandListAppendLaunchKernel(
+    ze_command_list_handle_t hCommandList, ze_kernel_handle_t hKernel,
+    const ze_group_count_t *pLaunchFuncArgs, ze_event_handle_t hSignalEvent,
+    uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendLaunchKernel);
+  call.handle(hCommandList);
+  call.handle(hKernel);
+  call.u(pLaunchFuncArgs->groupCountX);
+  call.u(pLaunchFuncArgs->groupCountY);
+  call.u(pLaunchFuncArgs->groupCountZ);
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(real(hCommandList, hKernel, pLaunchFuncArgs,
+                          hSignalEvent, numWaitEvents, phWaitEvents));
+}
+
+ze_result_t zeCommandListAppendMemAdvise(ze_command_list_handle_t hCommandList,
+                                         ze_device_handle_t hDevice,
+                                         const void *ptr, size_t size,
+                                         ze_memory_advice_t advice) {
+  ZE_TRACE_REAL(zeCommandListAppendMemAdvise);
+  call.handle(hCommandList);
+  call.handle(hDevice);
+  call.pointer(ptr, size);
+  call.u(size);
+  call.u(advice);
+  return call.commit(real(hCommandList, hDevice, ptr, size, advice));
+}
+
+ze_result_t zeCommandListAppendMemoryCopy(ze_command_list_handle_t hCommandList,
+                                          void *dstptr, const void *srcptr,
+                                          size_t size,
+                                          ze_event_handle_t hSignalEvent,
+                                          uint32_t numWaitEvents,
+                                          ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendMemoryCopy);
+  call.handle(hCommandList);
+  call.pointer(dstptr, size);
+  call.pointer(srcptr, size);
+  call.u(size);
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(real(hCommandList, dstptr, srcptr, size, hSignalEvent,
+                          numWaitEvents, phWaitEvents));
+}
+
+ze_result_t zeCommandListAppendMemoryCopyRegion(
+    ze_command_list_handle_t hCommandList, void *dstptr,
+    const ze_copy_region_t *dstRegion, uint32_t dstPitch,
+    uint32_t dstSlicePitch, const void *srcptr,
+    const ze_copy_region_t *srcRegion, uint32_t srcPitch,
+    uint32_t srcSlicePitch, ze_event_handle_t hSignalEvent,
+    uint32_t numWaitEvents, ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendMemoryCopyRegion);
+  call.handle(hCommandList);
+  call.pointer(dstptr, regionExtent(dstRegion, dstPitch, dstSlicePitch));
+  putRegion(call, dstRegion);
+  call.u(dstPitch);
+  call.u(dstSlicePitch);
+  call.pointer(srcptr, regionExtent(srcRegion, srcPitch, srcSlicePitch));
+  putRegion(call, srcRegion);
+  call.u(srcPitch);
+  call.u(srcSlicePitch);
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(real(hCommandList, dstptr, dstRegion, dstPitch,
+                          dstSlicePitch, srcptr, srcRegion, srcPitch,
+                          srcSlicePitch, hSignalEvent, numWaitEvents,
+                          phWaitEvents));
+}
+
+ze_result_t zeCommandListAppendMemoryFill(ze_command_list_handle_t hCommandList,
+                                          void *ptr, const void *pattern,
+                                          size_t pattern_size, size_t size,
+                                          ze_event_handle_t hSignalEvent,
+                                          uint32_t numWaitEvents,
+                                          ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendMemoryFill);
+  call.handle(hCommandList);
+  call.pointer(ptr, size);
+  call.bytes(pattern, pattern_size);
+  call.u(size);
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(real(hCommandList, ptr, pattern, pattern_size, size,
+                          hSignalEvent, numWaitEvents, phWaitEvents));
+}
+
+ze_result_t
+zeCommandListAppendMemoryPrefetch(ze_command_list_handle_t hCommandList,
+                                  const void *ptr, size_t size) {
+  ZE_TRACE_REAL(zeCommandListAppendMemoryPrefetch);
+  call.handle(hCommandList);
+  call.pointer(ptr, size);
+  call.u(size);
+  return call.commit(real(hCommandList, ptr, size));
+}
+
+ze_result_t zeCommandListAppendSignalEvent(ze_command_list_handle_t hCommandList,
+                                           ze_event_handle_t hEvent) {
+  ZE_TRACE_REAL(zeCommandListAppendSignalEvent);
+  call.handle(hCommandList);
+  call.handle(hEvent);
+  return call.commit(real(hCommandList, hEvent));
+}
+
+ze_result_t
+zeCommandListAppendWaitOnEvents(ze_command_list_handle_t hCommandList,
+                                uint32_t numEvents,
+                                ze_event_handle_t *phEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendWaitOnEvents);
+  call.handle(hCommandList);
+  call.u(numEvents);
+  for (uint32_t i = 0; i < numEvents; i++)
+    call.handle(phEvents[i]);
+  return call.commit(real(hCommandList, numEvents, phEvents));
+}
+
+ze_result_t zeCommandListAppendWriteGlobalTimestamp(
+    ze_command_list_handle_t hCommandList, uint64_t *dstptr,
+    ze_event_handle_t hSignalEvent, uint32_t numWaitEvents,
+    ze_event_handle_t *phWaitEvents) {
+  ZE_TRACE_REAL(zeCommandListAppendWriteGlobalTimestamp);
+  call.handle(hCommandList);
+  call.pointer(dstptr, sizeof(uint64_t));
+  call.events(hSignalEvent, numWaitEvents, phWaitEvents);
+  return call.commit(
+      real(hCommandList, dstptr, hSignalEvent, numWaitEvents, phWaitEvents));
+}
+
+// Events
+
+ze_result_t zeEventPoolCreate(ze_context_handle_t hContext,
+                              const ze_event_pool_desc_t *desc,
+                              uint32_t numDevices,
+                              ze_device_handle_t *phDevices,
+                              ze_event_pool_handle_t *phEventPool) {
+  ZE_TRACE_REAL(zeEventPoolCreate);
+  call.handle(hContext);
+  call.u(desc->flags);
+  call.u(desc->count);
+  call.u(phDevices ? numDevices : 0);
+  for (uint32_t i = 0; phDevices && i < numDevices; i++)
+    call.handle(phDevices[i]);
+  ze_result_t result =
+      real(hContext, desc, numDevices, phDevices, phEventPool);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phEventPool);
+  return call.commit(result);
+}
+
+ze_result_t zeEventPoolDestroy(ze_event_pool_handle_t hEventPool) {
+  ZE_TRACE_REAL(zeEventPoolDestroy);
+  call.handle(hEventPool);
+  return call.commit(real(hEventPool));
+}
+
+ze_result_t zeEventCreate(ze_event_pool_handle_t hEventPool,
+                          const ze_event_desc_t *desc,
+                          ze_event_handle_t *phEvent) {
+  ZE_TRACE_REAL(zeEventCreate);
+  call.handle(hEventPool);
+  call.u(desc->index);
+  call.u(desc->signal);
+  call.u(desc->wait);
+  ze_result_t result = real(hEventPool, desc, phEvent);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phEvent);
+  return call.commit(result);
+}
+
+ze_result_t zeEventDestroy(ze_event_handle_t hEvent) {
+  ZE_TRACE_REAL(zeEventDestroy);
+  call.handle(hEvent);
+  return call.commit(real(hEvent));
+}
+
+ze_result_t zeEventHostReset(ze_event_handle_t hEvent) {
+  ZE_TRACE_REAL(zeEventHostReset);
+  call.handle(hEvent);
+  return call.commit(real(hEvent));
+}
+
+ze_result_t zeEventHostSignal(ze_event_handle_t hEvent) {
+  ZE_TRACE_REAL(zeEventHostSignal);
+  call.handle(hEvent);
+  return call.commit(real(hEvent));
+}
+
+ze_result_t zeEventHostSynchronize(ze_event_handle_t hEvent,
+                                   uint64_t timeout) {
+  ZE_TRACE_REAL(zeEventHostSynchronize);
+  call.handle(hEvent);
+  call.u(timeout);
+  return call.commit(real(hEvent, timeout));
+}
+
+ze_result_t zeEventQueryStatus(ze_event_handle_t hEvent) {
+  ZE_TRACE_REAL(zeEventQueryStatus);
+  call.handle(hEvent);
+  return call.commit(real(hEvent));
+}
+
+ze_result_t zeEventQueryKernelTimestamp(ze_event_handle_t hEvent,
+                                        ze_kernel_timestamp_result_t *dstptr) {
+  ZE_TRACE_REAL(zeEventQueryKernelTimestamp);
+  call.handle(hEvent);
+  return call.commit(real(hEvent, dstptr));
+}
+
+// Kernels
+
+ze_result_t zeKernelCreate(ze_module_handle_t hModule,
+                           const ze_kernel_desc_t *desc,
+                           ze_kernel_handle_t *phKernel) {
+  ZE_TRACE_REAL(zeKernelCreate);
+  call.handle(hModule);
+  call.u(desc->flags);
+  call.str(desc->pKernelName);
+  ze_result_t result = real(hModule, desc, phKernel);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phKernel);
+  return call.commit(result);
+}
+
+ze_result_t zeKernelDestroy(ze_kernel_handle_t hKernel) {
+  ZE_TRACE_REAL(zeKernelDestroy);
+  call.handle(hKernel);
+  return call.commit(real(hKernel));
+}
+
+ze_result_t zeKernelSetArgumentValue(ze_kernel_handle_t hKernel,
+                                     uint32_t argIndex, size_t argSize,
+                                     const void *pArgValue) {
+  ZE_TRACE_REAL(zeKernelSetArgumentValue);
+  call.handle(hKernel);
+  call.u(argIndex);
+  call.u(argSize);
+  // Pointer-sized values that point into an allocation are remapped on
+  // replay; everything else is replayed byte for byte
+  const void *value = nullptr;
+  if (pArgValue && argSize == sizeof(void *))
+    memcpy(&value, pArgValue, sizeof(void *));
+  uint64_t id = 0;
+  uint64_t offset = 0;
+  if (!pArgValue) {
+    call.u(uint32_t(TraceArg::Local));
+  } else if (value && Call::lookup(value, id, offset)) {
+    call.u(uint32_t(TraceArg::Pointer));
+    call.u(id);
+    call.u(offset);
+  } else {
+    call.u(uint32_t(TraceArg::Bytes));
+    call.bytes(pArgValue, argSize);
+  }
+  return call.commit(real(hKernel, argIndex, argSize, pArgValue));
+}
+
+ze_result_t zeKernelSetGroupSize(ze_kernel_handle_t hKernel,
+                                 uint32_t groupSizeX, uint32_t groupSizeY,
+                                 uint32_t groupSizeZ) {
+  ZE_TRACE_REAL(zeKernelSetGroupSize);
+  call.handle(hKernel);
+  call.u(groupSizeX);
+  call.u(groupSizeY);
+  call.u(groupSizeZ);
+  return call.commit(real(hKernel, groupSizeX, groupSizeY, groupSizeZ));
+}
+
+ze_result_t zeKernelSuggestGroupSize(ze_kernel_handle_t hKernel,
+                                     uint32_t globalSizeX, uint32_t globalSizeY,
+                                     uint32_t globalSizeZ, uint32_t *groupSizeX,
+                                     uint32_t *groupSizeY,
+                                     uint32_t *groupSizeZ) {
+  ZE_TRACE_REAL(zeKernelSuggestGroupSize);
+  call.handle(hKernel);
+  call.u(globalSizeX);
+  call.u(globalSizeY);
+  call.u(globalSizeZ);
+  return call.commit(real(hKernel, globalSizeX, globalSizeY, globalSizeZ,
+                          groupSizeX, groupSizeY, groupSizeZ));
+}
+
+ze_result_t zeKernelSetIndirectAccess(ze_kernel_handle_t hKernel,
+                                      ze_kernel_indirect_access_flags_t flags) {
+  ZE_TRACE_REAL(zeKernelSetIndirectAccess);
+  call.handle(hKernel);
+  call.u(flags);
+  return call.commit(real(hKernel, flags));
+}
+
+// Memory
+
+ze_result_t zeMemAllocDevice(ze_context_handle_t hContext,
+                             const ze_device_mem_alloc_desc_t *device_desc,
+                             size_t size, size_t alignment,
+                             ze_device_handle_t hDevice, void **pptr) {
+  ZE_TRACE_REAL(zeMemAllocDevice);
+  call.handle(hContext);
+  call.u(device_desc->flags);
+  call.u(device_desc->ordinal);
+  call.u(size);
+  call.u(alignment);
+  call.handle(hDevice);
+  ze_result_t result =
+      real(hContext, device_desc, size, alignment, hDevice, pptr);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newRegion(*pptr, size);
+  return call.commit(result);
+}
+
+ze_result_t zeMemAllocHost(ze_context_handle_t hContext,
+                           const ze_host_mem_alloc_desc_t *host_desc,
+                           size_t size, size_t alignment, void **pptr) {
+  ZE_TRACE_REAL(zeMemAllocHost);
+  call.handle(hContext);
+  call.u(host_desc->flags);
+  call.u(size);
+  call.u(alignment);
+  ze_result_t result = real(hContext, host_desc, size, alignment, pptr);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newRegion(*pptr, size);
+  return call.commit(result);
+}
+
+ze_result_t zeMemAllocShared(ze_context_handle_t hContext,
+                             const ze_device_mem_alloc_desc_t *device_desc,
+                             const ze_host_mem_alloc_desc_t *host_desc,
+                             size_t size, size_t alignment,
+                             ze_device_handle_t hDevice, void **pptr) {
+  ZE_TRACE_REAL(zeMemAllocShared);
+  call.handle(hContext);
+  call.u(device_desc->flags);
+  call.u(device_desc->ordinal);
+  call.u(host_desc->flags);
+  call.u(size);
+  call.u(alignment);
+  call.handle(hDevice);
+  ze_result_t result =
+      real(hContext, device_desc, host_desc, size, alignment, hDevice, pptr);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newRegion(*pptr, size);
+  return call.commit(result);
+}
+
+ze_result_t zeMemFree(ze_context_handle_t hContext, void *ptr) {
+  ZE_TRACE_REAL(zeMemFree);
+  call.handle(hContext);
+  call.pointer(ptr, 0);
+  ze_result_t result = real(hContext, ptr);
+  if (result == ZE_RESULT_SUCCESS)
+    call.dropRegion(ptr);
+  return call.commit(result);
+}
+
+ze_result_t
+zeMemGetAllocProperties(ze_context_handle_t hContext, const void *ptr,
+                        ze_memory_allocation_properties_t *pMemAllocProperties,
+                        ze_device_handle_t *phDevice) {
+  ZE_TRACE_REAL(zeMemGetAllocProperties);
+  call.handle(hContext);
+  call.pointer(ptr, 0);
+  call.u(phDevice != nullptr);
+  return call.commit(real(hContext, ptr, pMemAllocProperties, phDevice));
+}
+
+// Modules
+
+ze_result_t zeModuleCreate(ze_context_handle_t hContext,
+                           ze_device_handle_t hDevice,
+                           const ze_module_desc_t *desc,
+                           ze_module_handle_t *phModule,
+                           ze_module_build_log_handle_t *phBuildLog) {
+  ZE_TRACE_REAL(zeModuleCreate);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.u(desc->format);
+  call.bytes(desc->pInputModule, desc->inputSize);
+  call.str(desc->pBuildFlags);
+  call.u(phBuildLog != nullptr);
+  ze_result_t result = real(hContext, hDevice, desc, phModule, phBuildLog);
+  if (result == ZE_RESULT_SUCCESS) {
+    call.newHandle(*phModule);
+    if (phBuildLog)
+      call.newHandle(*phBuildLog);
+  }
+  return call.commit(result);
+}
+
+ze_result_t zeModuleDestroy(ze_module_handle_t hModule) {
+  ZE_TRACE_REAL(zeModuleDestroy);
+  call.handle(hModule);
+  return call.commit(real(hModule));
+}
+
+ze_result_t zeModuleBuildLogGetString(ze_module_build_log_handle_t hModuleBuildLog,
+                                      size_t *pSize, char *pBuildLog) {
+  ZE_TRACE_REAL(zeModuleBuildLogGetString);
+  call.handle(hModuleBuildLog);
+  call.u(pBuildLog != nullptr);
+  return call.commit(real(hModuleBuildLog, pSize, pBuildLog));
+}
+
+ze_result_t zeModuleBuildLogDestroy(ze_module_build_log_handle_t hModuleBuildLog) {
+  ZE_TRACE_REAL(zeModuleBuildLogDestroy);
+  call.handle(hModuleBuildLog);
+  return call.commit(real(hModuleBuildLog));
+}
+
+// Virtual memory
+
+ze_result_t zeVirtualMemQueryPageSize(ze_context_handle_t hContext,
+                                      ze_device_handle_t hDevice, size_t size,
+                                      size_t *pagesize) {
+  ZE_TRACE_REAL(zeVirtualMemQueryPageSize);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.u(size);
+  return call.commit(real(hContext, hDevice, size, pagesize));
+}
+
+ze_result_t zeVirtualMemReserve(ze_context_handle_t hContext,
+                                const void *pStart, size_t size, void **pptr) {
+  ZE_TRACE_REAL(zeVirtualMemReserve);
+  call.handle(hContext);
+  call.u(size);
+  ze_result_t result = real(hContext, pStart, size, pptr);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newRegion(*pptr, size);
+  return call.commit(result);
+}
+
+ze_result_t zeVirtualMemFree(ze_context_handle_t hContext, const void *ptr,
+                             size_t size) {
+  ZE_TRACE_REAL(zeVirtualMemFree);
+  call.handle(hContext);
+  call.pointer(ptr, size);
+  call.u(size);
+  ze_result_t result = real(hContext, ptr, size);
+  if (result == ZE_RESULT_SUCCESS)
+    call.dropRegion(ptr);
+  return call.commit(result);
+}
+
+ze_result_t zePhysicalMemCreate(ze_context_handle_t hContext,
+                                ze_device_handle_t hDevice,
+                                ze_physical_mem_desc_t *desc,
+                                ze_physical_mem_handle_t *phPhysicalMemory) {
+  ZE_TRACE_REAL(zePhysicalMemCreate);
+  call.handle(hContext);
+  call.handle(hDevice);
+  call.u(desc->flags);
+  call.u(desc->size);
+  ze_result_t result = real(hContext, hDevice, desc, phPhysicalMemory);
+  if (result == ZE_RESULT_SUCCESS)
+    call.newHandle(*phPhysicalMemory);
+  return call.commit(result);
+}
+
+ze_result_t zePhysicalMemDestroy(ze_context_handle_t hContext,
+                                 ze_physical_mem_handle_t hPhysicalMemory) {
+  ZE_TRACE_REAL(zePhysicalMemDestroy);
+  call.handle(hContext);
+  call.handle(hPhysicalMemory);
+  return call.commit(real(hContext, hPhysicalMemory));
+}
+
+ze_result_t zeVirtualMemMap(ze_context_handle_t hContext, const void *ptr,
+                            size_t size,
+                            ze_physical_mem_handle_t hPhysicalMemory,
+                            size_t offset,
+                            ze_memory_access_attribute_t access) {
+  ZE_TRACE_REAL(zeVirtualMemMap);
+  call.handle(hContext);
+  call.pointer(ptr, size);
+  call.u(size);
+  call.handle(hPhysicalMemory);
+  call.u(offset);
+  call.u(access);
+  return call.commit(
+      real(hContext, ptr, size, hPhysicalMemory, offset, access));
+}
+
+ze_result_t zeVirtualMemUnmap(ze_context_handle_t hContext, const void *ptr,
+                              size_t size) {
+  ZE_TRACE_REAL(zeVirtualMemUnmap);
+  call.handle(hContext);
+  call.pointer(ptr, size);
+  call.u(size);
+  return call.commit(real(hContext, ptr, size));
+}
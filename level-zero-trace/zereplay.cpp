@@ -0,0 +1,885 @@
+// Re-issue a trace written by libze_trace.so against the current driver.
+//
+// Handles and allocations are remapped to the ones the replay creates;
+// memory the original driver did not allocate is replaced by host scratch
+// buffers of the recorded size. Each recorded thread gets a worker thread
+// that issues that thread's calls, so per-thread driver state such as the
+// thread an immediate command list is used from is reproduced. Across
+// workers, calls still go one at a time in the recorded (completion) order:
+// a call is issued once the previous one has returned. Calls that failed in
+// the recording are skipped, and any other call whose result differs from
+// the recorded one is reported.
+//
+// --timing=asap     issue every call as soon as the previous one returns
+// --timing=exact    hold each call until its recorded offset from the start,
+//                   so host gaps between submissions are reproduced
+//
+// Usage: ./zereplay TRACE [--timing=asap|exact] [--verbose]
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ze_api.h"
+#include "Trace.hpp"
+
+// zeCommandListHostSynchronize is newer than the in-tree v1.4 header but
+// level-zero-callbacks uses it
+extern "C" ZE_APIEXPORT ze_result_t ZE_APICALL
+zeCommandListHostSynchronize(ze_command_list_handle_t hCommandList,
+                             uint64_t timeout);
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceRecord {
+  TraceFunction function;
+  uint32_t thread;
+  uint64_t timeNs;
+  ze_result_t result;
+  const uint8_t *payload;
+  size_t size;
+};
+
+bool isError(ze_result_t result) { return uint32_t(result) >= 0x70000000u; }
+
+class Replayer {
+public:
+  // Returns the result of the replayed call
+  ze_result_t replay(const TraceRecord &record) {
+    TraceReader in(record.payload, record.payload + record.size);
+    bool outputs = record.result == ZE_RESULT_SUCCESS;
+    switch (record.function) {
+#define ZE_TRACE_CASE(name)                                                    \
+  case TraceFunction::name:                                                    \
+    return name##Replay(in, outputs);
+      ZE_TRACE_FUNCTIONS(ZE_TRACE_CASE)
+#undef ZE_TRACE_CASE
+    default:
+      return ZE_RESULT_ERROR_UNSUPPORTED_FEATURE;
+    }
+  }
+
+private:
+  template <typename T> T handle(TraceReader &in) {
+    uint64_t id = in.u();
+    auto it = handles.find(id);
+    return it == handles.end() ? nullptr : static_cast<T>(it->second);
+  }
+
+  void newHandle(TraceReader &in, void *handle) { handles[in.u()] = handle; }
+
+  void *pointer(TraceReader &in) {
+    uint64_t id = in.u();
+    if (id) {
+      uint64_t offset = in.u();
+      auto it = regions.find(id);
+      return it == regions.end() ? nullptr
+                                 : static_cast<char *>(it->second) + offset;
+    }
+    uint64_t address = in.u();
+    size_t size = in.u();
+    return scratch(address, size);
+  }
+
+  void newRegion(TraceReader &in, void *ptr) { regions[in.u()] = ptr; }
+
+  // Host stand-in for memory the application allocated itself. A buffer is
+  // never moved or freed before exit since queued copies may still use it.
+  void *scratch(uint64_t address, size_t size) {
+    auto &buffer = scratchBuffers[address];
+    if (!buffer || buffer->size() < size) {
+      scratchStorage.emplace_back(std::max<size_t>(size, 1));
+      buffer = &scratchStorage.back();
+    }
+    return buffer->data();
+  }
+
+  struct EventArgs {
+    ze_event_handle_t signal;
+    std::vector<ze_event_handle_t> waits;
+    uint32_t count() const { return uint32_t(waits.size()); }
+    ze_event_handle_t *data() { return waits.empty() ? nullptr : waits.data(); }
+  };
+
+  EventArgs events(TraceReader &in) {
+    EventArgs args;
+    args.signal = handle<ze_event_handle_t>(in);
+    args.waits.resize(in.u());
+    for (auto &wait : args.waits)
+      wait = handle<ze_event_handle_t>(in);
+    return args;
+  }
+
+  ze_command_queue_desc_t queueDesc(TraceReader &in) {
+    ze_command_queue_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC;
+    desc.ordinal = uint32_t(in.u());
+    desc.index = uint32_t(in.u());
+    desc.flags = ze_command_queue_flags_t(in.u());
+    desc.mode = ze_command_queue_mode_t(in.u());
+    desc.priority = ze_command_queue_priority_t(in.u());
+    return desc;
+  }
+
+  ze_copy_region_t region(TraceReader &in) {
+    ze_copy_region_t r;
+    r.originX = uint32_t(in.u());
+    r.originY = uint32_t(in.u());
+    r.originZ = uint32_t(in.u());
+    r.width = uint32_t(in.u());
+    r.height = uint32_t(in.u());
+    r.depth = uint32_t(in.u());
+    return r;
+  }
+
+  // Driver and device
+
+  ze_result_t zeInitReplay(TraceReader &in, bool) {
+    return zeInit(ze_init_flags_t(in.u()));
+  }
+
+  ze_result_t zeDriverGetReplay(TraceReader &in, bool outputs) {
+    bool array = in.u();
+    uint32_t count = uint32_t(in.u());
+    std::vector<ze_driver_handle_t> drivers(count);
+    ze_result_t result = zeDriverGet(&count, array ? drivers.data() : nullptr);
+    if (outputs && array) {
+      uint32_t recorded = uint32_t(in.u());
+      for (uint32_t i = 0; i < recorded; i++)
+        newHandle(in, i < count ? drivers[i] : nullptr);
+    }
+    return result;
+  }
+
+  ze_result_t zeDeviceGetReplay(TraceReader &in, bool outputs) {
+    auto driver = handle<ze_driver_handle_t>(in);
+    bool array = in.u();
+    uint32_t count = uint32_t(in.u());
+    std::vector<ze_device_handle_t> devices(count);
+    ze_result_t result =
+        zeDeviceGet(driver, &count, array ? devices.data() : nullptr);
+    if (outputs && array) {
+      uint32_t recorded = uint32_t(in.u());
+      for (uint32_t i = 0; i < recorded; i++)
+        newHandle(in, i < count ? devices[i] : nullptr);
+    }
+    return result;
+  }
+
+  ze_result_t zeDeviceGetPropertiesReplay(TraceReader &in, bool) {
+    ze_device_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    return zeDeviceGetProperties(handle<ze_device_handle_t>(in), &props);
+  }
+
+  ze_result_t zeDeviceGetCommandQueueGroupPropertiesReplay(TraceReader &in,
+                                                           bool) {
+    auto device = handle<ze_device_handle_t>(in);
+    bool array = in.u();
+    uint32_t count = uint32_t(in.u());
+    ze_command_queue_group_properties_t prop = {};
+    prop.stype = ZE_STRUCTURE_TYPE_COMMAND_QUEUE_GROUP_PROPERTIES;
+    std::vector<ze_command_queue_group_properties_t> props(count, prop);
+    return zeDeviceGetCommandQueueGroupProperties(
+        device, &count, array ? props.data() : nullptr);
+  }
+
+  ze_result_t zeDeviceGetMemoryPropertiesReplay(TraceReader &in, bool) {
+    auto device = handle<ze_device_handle_t>(in);
+    bool array = in.u();
+    uint32_t count = uint32_t(in.u());
+    ze_device_memory_properties_t prop = {};
+    prop.stype = ZE_STRUCTURE_TYPE_DEVICE_MEMORY_PROPERTIES;
+    std::vector<ze_device_memory_properties_t> props(count, prop);
+    return zeDeviceGetMemoryProperties(device, &count,
+                                       array ? props.data() : nullptr);
+  }
+
+  ze_result_t zeDeviceGetGlobalTimestampsReplay(TraceReader &in, bool) {
+    uint64_t host = 0;
+    uint64_t device = 0;
+    return zeDeviceGetGlobalTimestamps(handle<ze_device_handle_t>(in), &host,
+                                       &device);
+  }
+
+  // Contexts
+
+  ze_result_t zeContextCreateReplay(TraceReader &in, bool outputs) {
+    auto driver = handle<ze_driver_handle_t>(in);
+    ze_context_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_CONTEXT_DESC;
+    desc.flags = ze_context_flags_t(in.u());
+    ze_context_handle_t context = nullptr;
+    ze_result_t result = zeContextCreate(driver, &desc, &context);
+    if (outputs)
+      newHandle(in, context);
+    return result;
+  }
+
+  ze_result_t zeContextDestroyReplay(TraceReader &in, bool) {
+    return zeContextDestroy(handle<ze_context_handle_t>(in));
+  }
+
+  ze_result_t zeContextMakeMemoryResidentReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    void *ptr = pointer(in);
+    size_t size = in.u();
+    return zeContextMakeMemoryResident(context, device, ptr, size);
+  }
+
+  ze_result_t zeContextEvictMemoryReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    void *ptr = pointer(in);
+    size_t size = in.u();
+    return zeContextEvictMemory(context, device, ptr, size);
+  }
+
+  // Command queues and lists
+
+  ze_result_t zeCommandQueueCreateReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    ze_command_queue_desc_t desc = queueDesc(in);
+    ze_command_queue_handle_t queue = nullptr;
+    ze_result_t result = zeCommandQueueCreate(context, device, &desc, &queue);
+    if (outputs)
+      newHandle(in, queue);
+    return result;
+  }
+
+  ze_result_t zeCommandQueueDestroyReplay(TraceReader &in, bool) {
+    return zeCommandQueueDestroy(handle<ze_command_queue_handle_t>(in));
+  }
+
+  ze_result_t zeCommandQueueExecuteCommandListsReplay(TraceReader &in, bool) {
+    auto queue = handle<ze_command_queue_handle_t>(in);
+    std::vector<ze_command_list_handle_t> lists(in.u());
+    for (auto &list : lists)
+      list = handle<ze_command_list_handle_t>(in);
+    auto fence = handle<ze_fence_handle_t>(in);
+    return zeCommandQueueExecuteCommandLists(queue, uint32_t(lists.size()),
+                                             lists.data(), fence);
+  }
+
+  ze_result_t zeCommandQueueSynchronizeReplay(TraceReader &in, bool) {
+    auto queue = handle<ze_command_queue_handle_t>(in);
+    return zeCommandQueueSynchronize(queue, in.u());
+  }
+
+  ze_result_t zeCommandListCreateReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    ze_command_list_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC;
+    desc.commandQueueGroupOrdinal = uint32_t(in.u());
+    desc.flags = ze_command_list_flags_t(in.u());
+    ze_command_list_handle_t list = nullptr;
+    ze_result_t result = zeCommandListCreate(context, device, &desc, &list);
+    if (outputs)
+      newHandle(in, list);
+    return result;
+  }
+
+  ze_result_t zeCommandListCreateImmediateReplay(TraceReader &in,
+                                                 bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    ze_command_queue_desc_t desc = queueDesc(in);
+    ze_command_list_handle_t list = nullptr;
+    ze_result_t result =
+        zeCommandListCreateImmediate(context, device, &desc, &list);
+    if (outputs)
+      newHandle(in, list);
+    return result;
+  }
+
+  ze_result_t zeCommandListDestroyReplay(TraceReader &in, bool) {
+    return zeCommandListDestroy(handle<ze_command_list_handle_t>(in));
+  }
+
+  ze_result_t zeCommandListCloseReplay(TraceReader &in, bool) {
+    return zeCommandListClose(handle<ze_command_list_handle_t>(in));
+  }
+
+  ze_result_t zeCommandListResetReplay(TraceReader &in, bool) {
+    return zeCommandListReset(handle<ze_command_list_handle_t>(in));
+  }
+
+  ze_result_t zeCommandListHostSynchronizeReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    return zeCommandListHostSynchronize(list, in.u());
+  }
+
+  ze_result_t zeCommandListAppendBarrierReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    EventArgs e = events(in);
+    return zeCommandListAppendBarrier(list, e.signal, e.count(), e.data());
+  }
+
+  ze_result_t zeCommandListAppendLaunchKernelReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    auto kernel = handle<ze_kernel_handle_t>(in);
+    ze_group_count_t groups;
+    groups.groupCountX = uint32_t(in.u());
+    groups.groupCountY = uint32_t(in.u());
+    groups.groupCountZ = uint32_t(in.u());
+    EventArgs e = events(in);
+    return zeCommandListAppendLaunchKernel(list, kernel, &groups, e.signal,
+                                           e.count(), e.data());
+  }
+
+  ze_result_t zeCommandListAppendMemAdviseReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    void *ptr = pointer(in);
+    size_t size = in.u();
+    auto advice = ze_memory_advice_t(in.u());
+    return zeCommandListAppendMemAdvise(list, device, ptr, size, advice);
+  }
+
+  ze_result_t zeCommandListAppendMemoryCopyReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    void *dst = pointer(in);
+    void *src = pointer(in);
+    size_t size = in.u();
+    EventArgs e = events(in);
+    return zeCommandListAppendMemoryCopy(list, dst, src, size, e.signal,
+                                         e.count(), e.data());
+  }
+
+  ze_result_t zeCommandListAppendMemoryCopyRegionReplay(TraceReader &in,
+                                                        bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    void *dst = pointer(in);
+    ze_copy_region_t dstRegion = region(in);
+    uint32_t dstPitch = uint32_t(in.u());
+    uint32_t dstSlicePitch = uint32_t(in.u());
+    void *src = pointer(in);
+    ze_copy_region_t srcRegion = region(in);
+    uint32_t srcPitch = uint32_t(in.u());
+    uint32_t srcSlicePitch = uint32_t(in.u());
+    EventArgs e = events(in);
+    return zeCommandListAppendMemoryCopyRegion(
+        list, dst, &dstRegion, dstPitch, dstSlicePitch, src, &srcRegion,
+        srcPitch, srcSlicePitch, e.signal, e.count(), e.data());
+  }
+
+  ze_result_t zeCommandListAppendMemoryFillReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    void *ptr = pointer(in);
+    std::vector<uint8_t> pattern = in.bytes();
+    size_t size = in.u();
+    EventArgs e = events(in);
+    return zeCommandListAppendMemoryFill(list, ptr, pattern.data(),
+                                         pattern.size(), size, e.signal,
+                                         e.count(), e.data());
+  }
+
+  ze_result_t zeCommandListAppendMemoryPrefetchReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    void *ptr = pointer(in);
+    return zeCommandListAppendMemoryPrefetch(list, ptr, in.u());
+  }
+
+  ze_result_t zeCommandListAppendSignalEventReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    return zeCommandListAppendSignalEvent(list, handle<ze_event_handle_t>(in));
+  }
+
+  ze_result_t zeCommandListAppendWaitOnEventsReplay(TraceReader &in, bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    std::vector<ze_event_handle_t> waits(in.u());
+    for (auto &wait : waits)
+      wait = handle<ze_event_handle_t>(in);
+    return zeCommandListAppendWaitOnEvents(list, uint32_t(waits.size()),
+                                           waits.data());
+  }
+
+  ze_result_t zeCommandListAppendWriteGlobalTimestampReplay(TraceReader &in,
+                                                            bool) {
+    auto list = handle<ze_command_list_handle_t>(in);
+    auto dst = static_cast<uint64_t *>(pointer(in));
+    EventArgs e = events(in);
+    return zeCommandListAppendWriteGlobalTimestamp(list, dst, e.signal,
+                                                   e.count(), e.data());
+  }
+
+  // Events
+
+  ze_result_t zeEventPoolCreateReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    ze_event_pool_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_EVENT_POOL_DESC;
+    desc.flags = ze_event_pool_flags_t(in.u());
+    desc.count = uint32_t(in.u());
+    std::vector<ze_device_handle_t> devices(in.u());
+    for (auto &device : devices)
+      device = handle<ze_device_handle_t>(in);
+    ze_event_pool_handle_t pool = nullptr;
+    ze_result_t result = zeEventPoolCreate(
+        context, &desc, uint32_t(devices.size()),
+        devices.empty() ? nullptr : devices.data(), &pool);
+    if (outputs)
+      newHandle(in, pool);
+    return result;
+  }
+
+  ze_result_t zeEventPoolDestroyReplay(TraceReader &in, bool) {
+    return zeEventPoolDestroy(handle<ze_event_pool_handle_t>(in));
+  }
+
+  ze_result_t zeEventCreateReplay(TraceReader &in, bool outputs) {
+    auto pool = handle<ze_event_pool_handle_t>(in);
+    ze_event_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_EVENT_DESC;
+    desc.index = uint32_t(in.u());
+    desc.signal = ze_event_scope_flags_t(in.u());
+    desc.wait = ze_event_scope_flags_t(in.u());
+    ze_event_handle_t event = nullptr;
+    ze_result_t result = zeEventCreate(pool, &desc, &event);
+    if (outputs)
+      newHandle(in, event);
+    return result;
+  }
+
+  ze_result_t zeEventDestroyReplay(TraceReader &in, bool) {
+    return zeEventDestroy(handle<ze_event_handle_t>(in));
+  }
+
+  ze_result_t zeEventHostResetReplay(TraceReader &in, bool) {
+    return zeEventHostReset(handle<ze_event_handle_t>(in));
+  }
+
+  ze_result_t zeEventHostSignalReplay(TraceReader &in, bool) {
+    return zeEventHostSignal(handle<ze_event_handle_t>(in));
+  }
+
+  ze_result_t zeEventHostSynchronizeReplay(TraceReader &in, bool) {
+    auto event = handle<ze_event_handle_t>(in);
+    return zeEventHostSynchronize(event, in.u());
+  }
+
+  ze_result_t zeEventQueryStatusReplay(TraceReader &in, bool) {
+    return zeEventQueryStatus(handle<ze_event_handle_t>(in));
+  }
+
+  ze_result_t zeEventQueryKernelTimestampReplay(TraceReader &in, bool) {
+    ze_kernel_timestamp_result_t timestamps;
+    return zeEventQueryKernelTimestamp(handle<ze_event_handle_t>(in),
+                                       &timestamps);
+  }
+
+  // Kernels
+
+  ze_result_t zeKernelCreateReplay(TraceReader &in, bool outputs) {
+    auto module = handle<ze_module_handle_t>(in);
+    ze_kernel_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_KERNEL_DESC;
+    desc.flags = ze_kernel_flags_t(in.u());
+    std::string name = in.str();
+    desc.pKernelName = name.c_str();
+    ze_kernel_handle_t kernel = nullptr;
+    ze_result_t result = zeKernelCreate(module, &desc, &kernel);
+    if (outputs)
+      newHandle(in, kernel);
+    return result;
+  }
+
+  ze_result_t zeKernelDestroyReplay(TraceReader &in, bool) {
+    return zeKernelDestroy(handle<ze_kernel_handle_t>(in));
+  }
+
+  ze_result_t zeKernelSetArgumentValueReplay(TraceReader &in, bool) {
+    auto kernel = handle<ze_kernel_handle_t>(in);
+    uint32_t index = uint32_t(in.u());
+    size_t size = in.u();
+    switch (TraceArg(in.u())) {
+    case TraceArg::Local:
+      return zeKernelSetArgumentValue(kernel, index, size, nullptr);
+    case TraceArg::Pointer: {
+      uint64_t id = in.u();
+      uint64_t offset = in.u();
+      auto it = regions.find(id);
+      void *value = it == regions.end()
+                        ? nullptr
+                        : static_cast<char *>(it->second) + offset;
+      return zeKernelSetArgumentValue(kernel, index, sizeof(value), &value);
+    }
+    default: {
+      std::vector<uint8_t> value = in.bytes();
+      return zeKernelSetArgumentValue(kernel, index, value.size(),
+                                      value.data());
+    }
+    }
+  }
+
+  ze_result_t zeKernelSetGroupSizeReplay(TraceReader &in, bool) {
+    auto kernel = handle<ze_kernel_handle_t>(in);
+    uint32_t x = uint32_t(in.u());
+    uint32_t y = uint32_t(in.u());
+    uint32_t z = uint32_t(in.u());
+    return zeKernelSetGroupSize(kernel, x, y, z);
+  }
+
+  ze_result_t zeKernelSuggestGroupSizeReplay(TraceReader &in, bool) {
+    auto kernel = handle<ze_kernel_handle_t>(in);
+    uint32_t x = uint32_t(in.u());
+    uint32_t y = uint32_t(in.u());
+    uint32_t z = uint32_t(in.u());
+    uint32_t groupX, groupY, groupZ;
+    return zeKernelSuggestGroupSize(kernel, x, y, z, &groupX, &groupY,
+                                    &groupZ);
+  }
+
+  ze_result_t zeKernelSetIndirectAccessReplay(TraceReader &in, bool) {
+    auto kernel = handle<ze_kernel_handle_t>(in);
+    return zeKernelSetIndirectAccess(
+        kernel, ze_kernel_indirect_access_flags_t(in.u()));
+  }
+
+  // Memory
+
+  ze_result_t zeMemAllocDeviceReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    ze_device_mem_alloc_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
+    desc.flags = ze_device_mem_alloc_flags_t(in.u());
+    desc.ordinal = uint32_t(in.u());
+    size_t size = in.u();
+    size_t alignment = in.u();
+    auto device = handle<ze_device_handle_t>(in);
+    void *ptr = nullptr;
+    ze_result_t result =
+        zeMemAllocDevice(context, &desc, size, alignment, device, &ptr);
+    if (outputs)
+      newRegion(in, ptr);
+    return result;
+  }
+
+  ze_result_t zeMemAllocHostReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    ze_host_mem_alloc_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
+    desc.flags = ze_host_mem_alloc_flags_t(in.u());
+    size_t size = in.u();
+    size_t alignment = in.u();
+    void *ptr = nullptr;
+    ze_result_t result = zeMemAllocHost(context, &desc, size, alignment, &ptr);
+    if (outputs)
+      newRegion(in, ptr);
+    return result;
+  }
+
+  ze_result_t zeMemAllocSharedReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    ze_device_mem_alloc_desc_t deviceDesc = {};
+    deviceDesc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
+    deviceDesc.flags = ze_device_mem_alloc_flags_t(in.u());
+    deviceDesc.ordinal = uint32_t(in.u());
+    ze_host_mem_alloc_desc_t hostDesc = {};
+    hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
+    hostDesc.flags = ze_host_mem_alloc_flags_t(in.u());
+    size_t size = in.u();
+    size_t alignment = in.u();
+    auto device = handle<ze_device_handle_t>(in);
+    void *ptr = nullptr;
+    ze_result_t result = zeMemAllocShared(context, &deviceDesc, &hostDesc,
+                                          size, alignment, device, &ptr);
+    if (outputs)
+      newRegion(in, ptr);
+    return result;
+  }
+
+  ze_result_t zeMemFreeReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    return zeMemFree(context, pointer(in));
+  }
+
+  ze_result_t zeMemGetAllocPropertiesReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    void *ptr = pointer(in);
+    bool wantsDevice = in.u();
+    ze_memory_allocation_properties_t props = {};
+    props.stype = ZE_STRUCTURE_TYPE_MEMORY_ALLOCATION_PROPERTIES;
+    ze_device_handle_t device = nullptr;
+    return zeMemGetAllocProperties(context, ptr, &props,
+                                   wantsDevice ? &device : nullptr);
+  }
+
+  // Modules
+
+  ze_result_t zeModuleCreateReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    ze_module_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_MODULE_DESC;
+    desc.format = ze_module_format_t(in.u());
+    std::vector<uint8_t> input = in.bytes();
+    std::string flags = in.str();
+    bool wantsLog = in.u();
+    desc.inputSize = input.size();
+    desc.pInputModule = input.data();
+    desc.pBuildFlags = flags.c_str();
+    ze_module_handle_t module = nullptr;
+    ze_module_build_log_handle_t log = nullptr;
+    ze_result_t result = zeModuleCreate(context, device, &desc, &module,
+                                        wantsLog ? &log : nullptr);
+    if (outputs) {
+      newHandle(in, module);
+      if (wantsLog)
+        newHandle(in, log);
+    }
+    return result;
+  }
+
+  ze_result_t zeModuleDestroyReplay(TraceReader &in, bool) {
+    return zeModuleDestroy(handle<ze_module_handle_t>(in));
+  }
+
+  ze_result_t zeModuleBuildLogGetStringReplay(TraceReader &in, bool) {
+    auto log = handle<ze_module_build_log_handle_t>(in);
+    bool wantsText = in.u();
+    size_t size = 0;
+    ze_result_t result = zeModuleBuildLogGetString(log, &size, nullptr);
+    if (!wantsText || result != ZE_RESULT_SUCCESS)
+      return result;
+    std::vector<char> text(size);
+    return zeModuleBuildLogGetString(log, &size, text.data());
+  }
+
+  ze_result_t zeModuleBuildLogDestroyReplay(TraceReader &in, bool) {
+    return zeModuleBuildLogDestroy(handle<ze_module_build_log_handle_t>(in));
+  }
+
+  // Virtual memory
+
+  ze_result_t zeVirtualMemQueryPageSizeReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    size_t pageSize = 0;
+    return zeVirtualMemQueryPageSize(context, device, in.u(), &pageSize);
+  }
+
+  ze_result_t zeVirtualMemReserveReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    size_t size = in.u();
+    void *ptr = nullptr;
+    ze_result_t result = zeVirtualMemReserve(context, nullptr, size, &ptr);
+    if (outputs)
+      newRegion(in, ptr);
+    return result;
+  }
+
+  ze_result_t zeVirtualMemFreeReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    void *ptr = pointer(in);
+    return zeVirtualMemFree(context, ptr, in.u());
+  }
+
+  ze_result_t zePhysicalMemCreateReplay(TraceReader &in, bool outputs) {
+    auto context = handle<ze_context_handle_t>(in);
+    auto device = handle<ze_device_handle_t>(in);
+    ze_physical_mem_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_PHYSICAL_MEM_DESC;
+    desc.flags = ze_physical_mem_flags_t(in.u());
+    desc.size = in.u();
+    ze_physical_mem_handle_t physical = nullptr;
+    ze_result_t result = zePhysicalMemCreate(context, device, &desc, &physical);
+    if (outputs)
+      newHandle(in, physical);
+    return result;
+  }
+
+  ze_result_t zePhysicalMemDestroyReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    return zePhysicalMemDestroy(context,
+                                handle<ze_physical_mem_handle_t>(in));
+  }
+
+  ze_result_t zeVirtualMemMapReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    void *ptr = pointer(in);
+    size_t size = in.u();
+    auto physical = handle<ze_physical_mem_handle_t>(in);
+    size_t offset = in.u();
+    auto access = ze_memory_access_attribute_t(in.u());
+    return zeVirtualMemMap(context, ptr, size, physical, offset, access);
+  }
+
+  ze_result_t zeVirtualMemUnmapReplay(TraceReader &in, bool) {
+    auto context = handle<ze_context_handle_t>(in);
+    void *ptr = pointer(in);
+    return zeVirtualMemUnmap(context, ptr, in.u());
+  }
+
+  std::unordered_map<uint64_t, void *> handles;
+  std::unordered_map<uint64_t, void *> regions;
+  std::unordered_map<uint64_t, std::vector<char> *> scratchBuffers;
+  std::list<std::vector<char>> scratchStorage;
+};
+
+// Split a trace file into records, false if it is not a valid trace
+bool parseTrace(const std::vector<uint8_t> &data,
+                std::vector<TraceRecord> &records) {
+  if (data.size() < 16 || memcmp(data.data(), kTraceMagic, 8) != 0)
+    return false;
+  uint32_t version;
+  memcpy(&version, data.data() + 8, sizeof(version));
+  if (version != kTraceVersion)
+    return false;
+  TraceReader in(data.data() + 16, data.data() + data.size());
+  while (!in.done()) {
+    TraceRecord record;
+    record.function = TraceFunction(in.u());
+    record.thread = uint32_t(in.u());
+    record.timeNs = in.u();
+    record.result = ze_result_t(in.u());
+    record.size = in.u();
+    record.payload = in.current();
+    if (!in.ok() || record.size > size_t(data.data() + data.size() -
+                                         record.payload))
+      break; // partial last record of an interrupted run
+    if (record.function < TraceFunction::Count)
+      records.push_back(record);
+    in = TraceReader(record.payload + record.size,
+                     data.data() + data.size());
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *path = nullptr;
+  bool exact = false;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--timing=exact")
+      exact = true;
+    else if (arg == "--timing=asap")
+      exact = false;
+    else if (arg == "--verbose")
+      verbose = true;
+    else
+      path = argv[i];
+  }
+  if (!path) {
+    std::cout << "Usage: " << argv[0]
+              << " TRACE [--timing=asap|exact] [--verbose]\n";
+    return 1;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << path << " not found\n";
+    return 1;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  std::vector<TraceRecord> records;
+  if (!parseTrace(data, records)) {
+    std::cout << path << " is not a version " << kTraceVersion
+              << " Level Zero trace\n";
+    return 1;
+  }
+  if (records.empty()) {
+    std::cout << "Trace is empty\n";
+    return 0;
+  }
+
+  uint32_t threads = 0;
+  for (auto &record : records)
+    threads = std::max(threads, record.thread + 1);
+  std::cout << "Trace    : " << path << ", " << records.size() << " calls, "
+            << threads << " thread(s)\n";
+  if (threads > 1)
+    std::cout << "           replayed on " << threads
+              << " threads in completion order\n";
+
+  // Calls each recorded thread replays, as positions in the replay order
+  std::vector<const TraceRecord *> sequence;
+  std::vector<std::vector<size_t>> perThread(threads);
+  uint64_t skipped = 0;
+  for (auto &record : records) {
+    if (isError(record.result)) {
+      skipped++;
+      continue;
+    }
+    perThread[record.thread].push_back(sequence.size());
+    sequence.push_back(&record);
+  }
+
+  // The worker holding the turn is the only one touching the replayer and
+  // the mismatch counts
+  Replayer replayer;
+  std::map<std::string, uint64_t> mismatches;
+  std::mutex turnMutex;
+  std::condition_variable turnChanged;
+  size_t turn = 0;
+  uint64_t firstNs = records.front().timeNs;
+  auto begin = Clock::now();
+  auto worker = [&](const std::vector<size_t> &positions) {
+    for (size_t position : positions) {
+      {
+        std::unique_lock<std::mutex> lock(turnMutex);
+        turnChanged.wait(lock, [&] { return turn == position; });
+      }
+      const TraceRecord &record = *sequence[position];
+      if (exact) {
+        auto due = begin + std::chrono::nanoseconds(record.timeNs - firstNs);
+        std::this_thread::sleep_until(due);
+      }
+      ze_result_t result = replayer.replay(record);
+      if (result != record.result) {
+        const char *name = kTraceFunctionNames[size_t(record.function)];
+        mismatches[name]++;
+        if (verbose)
+          std::cout << name << ": recorded 0x" << std::hex << record.result
+                    << ", replayed 0x" << result << std::dec << "\n";
+      }
+      {
+        std::lock_guard<std::mutex> lock(turnMutex);
+        turn++;
+      }
+      turnChanged.notify_all();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (auto &positions : perThread)
+    if (!positions.empty())
+      workers.emplace_back(worker, std::cref(positions));
+  for (auto &thread : workers)
+    thread.join();
+  uint64_t replayed = sequence.size();
+  double replaySeconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+  double traceSeconds = (records.back().timeNs - firstNs) / 1e9;
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "Replayed : " << replayed << " calls, " << skipped
+            << " recorded failures skipped\n"
+            << "Time     : " << replaySeconds * 1e3 << " ms replay ("
+            << (exact ? "exact" : "asap") << " timing), "
+            << traceSeconds * 1e3 << " ms recorded\n";
+  if (mismatches.empty()) {
+    std::cout << "Results  : all match the recording\n";
+    return 0;
+  }
+  std::cout << "Results  : differ from the recording in\n";
+  for (auto &[name, count] : mismatches)
+    std::cout << "  " << std::left << std::setw(44) << name << std::right
+              << count << "\n";
+  return 2;
+}
@@ -0,0 +1,104 @@
+// Waits for OpenCL events with a deadline and without a thread per event.
+//
+// watch() registers a CL_COMPLETE callback on an event. The callback stamps
+// the completion time under a mutex and notifies a condition variable, so a
+// waiter wakes as soon as the runtime calls back and a hang is declared
+// exactly at the deadline rather than at the next polling tick. The state is
+// shared with the callbacks: a watch may go away while an event is stuck,
+// a callback that fires later still finds valid state, and one that never
+// fires leaks only its small token.
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class CompletionWatch {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  CompletionWatch() : state(std::make_shared<State>()) {}
+
+  // Start watching `event`; returns its index for the accessors below
+  size_t watch(cl_event event) {
+    size_t index;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      index = state->entries.size();
+      state->entries.emplace_back();
+      state->pending++;
+    }
+    // The callback may run before clSetEventCallback returns
+    CL_CHECK(clSetEventCallback(event, CL_COMPLETE, onComplete,
+                                new Token{state, index}));
+    return index;
+  }
+
+  // Block until every watched event completed or `deadline` passed. Returns
+  // true when nothing is pending any more.
+  bool waitUntil(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    return state->cv.wait_until(lock, deadline,
+                                [&] { return state->pending == 0; });
+  }
+
+  bool waitFor(std::chrono::milliseconds timeout) {
+    return waitUntil(Clock::now() + timeout);
+  }
+
+  bool done(size_t index) const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->entries[index].done;
+  }
+
+  // CL_COMPLETE, or the negative error the command terminated with
+  cl_int status(size_t index) const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->entries[index].status;
+  }
+
+  Clock::time_point completedAt(size_t index) const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->entries[index].completedAt;
+  }
+
+  size_t pending() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->pending;
+  }
+
+private:
+  struct Entry {
+    bool done = false;
+    cl_int status = CL_QUEUED;
+    Clock::time_point completedAt;
+  };
+
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Entry> entries;
+    size_t pending = 0;
+  };
+
+  struct Token {
+    std::shared_ptr<State> state;
+    size_t index;
+  };
+
+  static void CL_CALLBACK onComplete(cl_event, cl_int status, void *data) {
+    auto now = Clock::now();
+    std::unique_ptr<Token> token(static_cast<Token *>(data));
+    State &state = *token->state;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Entry &entry = state.entries[token->index];
+    entry.done = true;
+    entry.status = status;
+    entry.completedAt = now;
+    state.pending--;
+    state.cv.notify_all();
+  }
+
+  std::shared_ptr<State> state;
+};
@@ -0,0 +1,297 @@
+// Host-side dependency resolver in front of an OpenCL command queue.
+//
+// A command whose wait list holds a user event that has not been set yet is
+// not enqueued. It stays on the host, and a submitter thread enqueues it once
+// every such event is set, still waiting on them so that an event set to an
+// error fails the command the runtime's way. Everything else goes
+// straight to the queue, so one gated command no longer stalls the rest of
+// the stream, and the device never sees a barrier waiting on an unset user
+// event, the pattern that hangs in-order queues (minimal_repro.cpp).
+//
+// A held command hands out a user event standing in for the event it will
+// get; the stand-in is set when the real command completes. A command that
+// waits on a stand-in is held as long as the stand-in's command is, and
+// waits on the real event once that exists, so a chain behind a gate reaches
+// the device in one pass with its dependencies intact.
+//
+// Held commands give up the implicit ordering of an in-order queue against
+// commands enqueued after them: express such dependencies with events, as on
+// an out-of-order queue. A held kernel launch uses the kernel arguments set
+// when it is finally enqueued, so don't change them while it is held.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class DeferredQueue {
+public:
+  // Enqueues one command after the given events; returns the runtime status
+  using Enqueue = std::function<cl_int(cl_uint, const cl_event *, cl_event *)>;
+
+  DeferredQueue(cl_context context, cl_command_queue queue)
+      : context(context), queue(queue), wake(std::make_shared<Wake>()),
+        submitter([this] { submitLoop(); }) {}
+
+  // Held commands that never became ready are dropped, their stand-ins set
+  // to an error
+  ~DeferredQueue() {
+    {
+      std::lock_guard<std::mutex> lock(wake->mutex);
+      wake->stop = true;
+    }
+    wake->cv.notify_all();
+    submitter.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Held &command : held) {
+      CL_CHECK(clSetUserEventStatus(command.standIn,
+                                    CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST));
+      releaseAll(command.waits);
+      standIns.erase(command.standIn);
+      CL_CHECK(clReleaseEvent(command.standIn));
+    }
+    for (auto &entry : standIns) {
+      CL_CHECK(clReleaseEvent(entry.first));
+      CL_CHECK(clReleaseEvent(entry.second));
+    }
+  }
+
+  // Enqueue now, or hold until the user events in `waits` are set. Returns
+  // the command's event, a stand-in while it is held; the caller owns one
+  // reference either way.
+  cl_event submit(const std::vector<cl_event> &waits, Enqueue enqueue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    purgeCompleted();
+    std::vector<cl_event> resolved;
+    std::vector<cl_event> gates;
+    if (resolve(waits, resolved, &gates)) {
+      cl_event event = nullptr;
+      CL_CHECK(enqueue(cl_uint(resolved.size()),
+                       resolved.empty() ? nullptr : resolved.data(), &event));
+      return event;
+    }
+
+    cl_int err;
+    cl_event standIn = clCreateUserEvent(context, &err);
+    CL_CHECK(err);
+    CL_CHECK(clRetainEvent(standIn)); // Kept by standIns until purged
+    standIns[standIn] = nullptr;
+    for (cl_event event : waits)
+      CL_CHECK(clRetainEvent(event));
+    held.push_back({waits, std::move(enqueue), standIn});
+    for (cl_event gate : gates)
+      CL_CHECK(clSetEventCallback(gate, CL_COMPLETE, onGateSet,
+                                  new std::shared_ptr<Wake>(wake)));
+    return standIn;
+  }
+
+  cl_event barrier(const std::vector<cl_event> &waits) {
+    cl_command_queue q = queue;
+    return submit(waits, [q](cl_uint n, const cl_event *list, cl_event *event) {
+      return clEnqueueBarrierWithWaitList(q, n, list, event);
+    });
+  }
+
+  cl_event marker(const std::vector<cl_event> &waits) {
+    cl_command_queue q = queue;
+    return submit(waits, [q](cl_uint n, const cl_event *list, cl_event *event) {
+      return clEnqueueMarkerWithWaitList(q, n, list, event);
+    });
+  }
+
+  cl_event kernel(cl_kernel kernel, cl_uint dims, const size_t *global,
+                  const size_t *local, const std::vector<cl_event> &waits) {
+    cl_command_queue q = queue;
+    std::vector<size_t> globalSize(global, global + dims);
+    std::vector<size_t> localSize;
+    if (local)
+      localSize.assign(local, local + dims);
+    return submit(waits, [=](cl_uint n, const cl_event *list, cl_event *event) {
+      return clEnqueueNDRangeKernel(q, kernel, dims, nullptr, globalSize.data(),
+                                    localSize.empty() ? nullptr
+                                                      : localSize.data(),
+                                    n, list, event);
+    });
+  }
+
+  // Commands currently held on the host
+  size_t pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return held.size();
+  }
+
+  cl_command_queue commandQueue() const { return queue; }
+
+private:
+  struct Held {
+    std::vector<cl_event> waits;
+    Enqueue enqueue;
+    cl_event standIn;
+  };
+
+  // Shared with the callbacks, which may outlive the queue. Callbacks only
+  // take this mutex, never the queue's, since a runtime may run them inside
+  // clSetEventCallback.
+  struct Wake {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready = false;
+    bool stop = false;
+    std::vector<cl_event> completedStandIns;
+  };
+
+  struct Forward {
+    std::shared_ptr<Wake> wake;
+    cl_event standIn;
+  };
+
+  static void notify(Wake &wake) {
+    {
+      std::lock_guard<std::mutex> lock(wake.mutex);
+      wake.ready = true;
+    }
+    wake.cv.notify_all();
+  }
+
+  static void CL_CALLBACK onGateSet(cl_event, cl_int, void *data) {
+    std::unique_ptr<std::shared_ptr<Wake>> wake(
+        static_cast<std::shared_ptr<Wake> *>(data));
+    notify(**wake);
+  }
+
+  // The real command finished: pass its status on to the stand-in and
+  // have the next purge drop it from standIns
+  static void CL_CALLBACK onRealComplete(cl_event, cl_int status, void *data) {
+    std::unique_ptr<Forward> forward(static_cast<Forward *>(data));
+    clSetUserEventStatus(forward->standIn,
+                         status < 0 ? status : cl_int(CL_COMPLETE));
+    {
+      std::lock_guard<std::mutex> lock(forward->wake->mutex);
+      if (!forward->wake->stop)
+        forward->wake->completedStandIns.push_back(forward->standIn);
+    }
+    clReleaseEvent(forward->standIn);
+  }
+
+  static bool isUnsetUserEvent(cl_event event) {
+    cl_command_type type = 0;
+    CL_CHECK(clGetEventInfo(event, CL_EVENT_COMMAND_TYPE, sizeof(type), &type,
+                            nullptr));
+    if (type != CL_COMMAND_USER)
+      return false;
+    cl_int status = CL_COMPLETE;
+    CL_CHECK(clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS,
+                            sizeof(status), &status, nullptr));
+    return status > CL_COMPLETE;
+  }
+
+  // Maps `waits` to what the device should wait on. Returns false if the
+  // command must stay held; `gates` then gets the unset user events that
+  // are not our own stand-ins.
+  bool resolve(const std::vector<cl_event> &waits,
+               std::vector<cl_event> &resolved,
+               std::vector<cl_event> *gates) {
+    bool ready = true;
+    for (cl_event event : waits) {
+      auto it = standIns.find(event);
+      if (it != standIns.end()) {
+        if (!it->second)
+          ready = false; // Its command is still held
+        else
+          resolved.push_back(it->second);
+        continue;
+      }
+      if (isUnsetUserEvent(event)) {
+        ready = false;
+        if (gates)
+          gates->push_back(event);
+        continue;
+      }
+      resolved.push_back(event);
+    }
+    return ready;
+  }
+
+  static void releaseAll(const std::vector<cl_event> &events) {
+    for (cl_event event : events)
+      CL_CHECK(clReleaseEvent(event));
+  }
+
+  // Drop stand-ins whose real command completed. Caller holds `mutex`.
+  void purgeCompleted() {
+    std::vector<cl_event> completed;
+    {
+      std::lock_guard<std::mutex> lock(wake->mutex);
+      completed.swap(wake->completedStandIns);
+    }
+    for (cl_event standIn : completed) {
+      auto it = standIns.find(standIn);
+      CL_CHECK(clReleaseEvent(it->second));
+      CL_CHECK(clReleaseEvent(it->first));
+      standIns.erase(it);
+    }
+  }
+
+  // Enqueue every held command that became ready, in submission order, so a
+  // command freed here unblocks those behind it in the same pass, and flush
+  // them: nobody else will, since completion is only observed through
+  // callbacks and event queries. Caller holds `mutex`.
+  void submitReady() {
+    bool enqueued = false;
+    for (auto it = held.begin(); it != held.end();) {
+      std::vector<cl_event> resolved;
+      if (!resolve(it->waits, resolved, nullptr)) {
+        ++it;
+        continue;
+      }
+      cl_event event = nullptr;
+      cl_int status = it->enqueue(cl_uint(resolved.size()),
+                                  resolved.empty() ? nullptr : resolved.data(),
+                                  &event);
+      if (status != CL_SUCCESS) {
+        CL_CHECK(clSetUserEventStatus(it->standIn, status));
+        standIns.erase(it->standIn);
+        CL_CHECK(clReleaseEvent(it->standIn));
+      } else {
+        enqueued = true;
+        standIns[it->standIn] = event;
+        CL_CHECK(clRetainEvent(it->standIn)); // Released by onRealComplete
+        CL_CHECK(clSetEventCallback(event, CL_COMPLETE, onRealComplete,
+                                    new Forward{wake, it->standIn}));
+      }
+      releaseAll(it->waits);
+      it = held.erase(it);
+    }
+    if (enqueued)
+      CL_CHECK(clFlush(queue));
+  }
+
+  void submitLoop() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(wake->mutex);
+        wake->cv.wait(lock, [&] { return wake->ready || wake->stop; });
+        if (wake->stop)
+          return;
+        wake->ready = false;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      purgeCompleted();
+      submitReady();
+    }
+  }
+
+  cl_context context;
+  cl_command_queue queue;
+  mutable std::mutex mutex;
+  std::deque<Held> held;
+  // Stand-in -> real event, nullptr while the command is held
+  std::unordered_map<cl_event, cl_event> standIns;
+  std::shared_ptr<Wake> wake;
+  std::thread submitter;
+};
@@ -0,0 +1,91 @@
+// Shared helpers for the OpenCL reproducers in this directory.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#define CL_CHECK(myClCall)                                                     \
+  do {                                                                         \
+    cl_int clStatus = (myClCall);                                              \
+    if (clStatus != CL_SUCCESS) {                                              \
+      fprintf(stderr, "Error at %s: %s: %d\nExit with Error Code: %d\n",       \
+              #myClCall, __FUNCTION__, __LINE__, clStatus);                    \
+      std::terminate();                                                        \
+    }                                                                          \
+  } while (0)
+
+// Device type from a command line word: gpu, cpu or any (GPU first, then
+// CPU, then whatever the platforms offer). Returns 0 for anything else.
+inline cl_device_type parseDeviceType(const char *word) {
+  if (!word || !strcmp(word, "any"))
+    return CL_DEVICE_TYPE_ALL;
+  if (!strcmp(word, "gpu"))
+    return CL_DEVICE_TYPE_GPU;
+  if (!strcmp(word, "cpu"))
+    return CL_DEVICE_TYPE_CPU;
+  return 0;
+}
+
+// First device of `type` over all platforms, or nullptr
+inline cl_device_id findDevice(cl_device_type type) {
+  cl_uint numPlatforms = 0;
+  if (clGetPlatformIDs(0, nullptr, &numPlatforms) != CL_SUCCESS)
+    return nullptr;
+  std::vector<cl_platform_id> platforms(numPlatforms);
+  clGetPlatformIDs(numPlatforms, platforms.data(), nullptr);
+
+  cl_device_type order[] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_CPU,
+                            CL_DEVICE_TYPE_ALL};
+  for (cl_device_type candidate : order) {
+    if (type != CL_DEVICE_TYPE_ALL && candidate != type)
+      continue;
+    for (cl_platform_id platform : platforms) {
+      cl_device_id device = nullptr;
+      cl_uint numDevices = 0;
+      if (clGetDeviceIDs(platform, candidate, 1, &device, &numDevices) ==
+              CL_SUCCESS &&
+          numDevices > 0)
+        return device;
+    }
+  }
+  return nullptr;
+}
+
+inline const char *deviceTypeName(cl_device_id device) {
+  cl_device_type type = 0;
+  clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type, nullptr);
+  if (type & CL_DEVICE_TYPE_GPU)
+    return "GPU";
+  if (type & CL_DEVICE_TYPE_CPU)
+    return "CPU";
+  return "other";
+}
+
+inline void printDevice(cl_device_id device) {
+  char name[256] = {};
+  char version[256] = {};
+  clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, nullptr);
+  clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(version), version,
+                  nullptr);
+  printf("Device: %s (%s, driver %s)\n", name, deviceTypeName(device), version);
+}
+
+// Spin until `event` leaves the queued/submitted/running states or the
+// timeout passes. Spinning keeps the host-side observation of a completion
+// within a few microseconds; a blocking wait could not time out.
+inline bool pollComplete(cl_event event, std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  cl_int status = CL_QUEUED;
+  while (true) {
+    CL_CHECK(clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS,
+                            sizeof(status), &status, nullptr));
+    if (status <= CL_COMPLETE)
+      return true;
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::yield();
+  }
+}
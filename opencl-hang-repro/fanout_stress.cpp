@@ -0,0 +1,277 @@
+// User-event fan-out stress test: many queues, many barriers, several
+// signaling threads.
+//
+// minimal_repro.cpp arms one barrier on one user event per queue. Here each
+// of M queues gets K barriers spread round-robin over E user events, so every
+// event releases about M*K/E waiters across all queues, and T host threads
+// set the events concurrently. Per queue mode and per M x K it reports
+//
+//   wake-up   the time from a barrier becoming ready to its CL_COMPLETE
+//             callback (CompletionWatch). A barrier is ready once its own
+//             event is set, and on an in-order queue also every event the
+//             barriers before it wait on.
+//   finish    the time from the last clSetUserEventStatus a barrier waits on
+//             until clFinish has returned on every queue, called from a
+//             separate thread that is already blocked in clFinish when the
+//             events are set.
+//
+// Wake-up latencies are pooled over `reps` repetitions; finish is the median
+// over them. A configuration whose barriers do not all complete within 5 s
+// of the first signal is reported as HUNG and ends that queue mode: the
+// in-order bug minimal_repro.cpp detects shows up here as well.
+//
+// Usage: ./fanout_stress [gpu|cpu|any] [queues,...] [barriers,...] [events]
+//                        [threads] [reps]
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "CompletionWatch.hpp"
+
+using Clock = CompletionWatch::Clock;
+
+const std::chrono::milliseconds kHangTimeout(5000);
+
+struct Stress {
+  cl_context context;
+  cl_device_id device;
+  int events;
+  int threads;
+  int reps;
+};
+
+// Set once clFinish returned on every queue. Shared with the finishing
+// thread, which stays blocked forever on a hung queue.
+struct Finish {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  Clock::time_point at;
+};
+
+// Comma-separated positive integers, or an empty vector
+std::vector<int> parseList(const char *text) {
+  std::vector<int> values;
+  std::string word;
+  for (const char *c = text;; c++) {
+    if (*c && *c != ',') {
+      word += *c;
+      continue;
+    }
+    int value = std::atoi(word.c_str());
+    if (value < 1)
+      return {};
+    values.push_back(value);
+    word.clear();
+    if (!*c)
+      return values;
+  }
+}
+
+double percentile(const std::vector<double> &sorted, double q) {
+  return sorted[size_t(q * (sorted.size() - 1))];
+}
+
+// One repetition on `queues`. Appends the wake-up latencies and the finish
+// time; returns false if barriers were still pending at the deadline.
+bool runOnce(const std::vector<cl_command_queue> &queues, bool outOfOrder,
+             int barriers, const Stress &stress, std::vector<double> &wakeUpUs,
+             std::vector<double> &finishUs) {
+  cl_int err;
+  std::vector<cl_event> userEvents(stress.events);
+  for (cl_event &event : userEvents) {
+    event = clCreateUserEvent(stress.context, &err);
+    CL_CHECK(err);
+  }
+
+  // Barrier j of queue q waits on event (q * K + j) mod E
+  CompletionWatch watch;
+  std::vector<cl_event> barrierEvents;
+  std::vector<int> gate;
+  for (size_t q = 0; q < queues.size(); q++) {
+    for (int j = 0; j < barriers; j++) {
+      int e = int((q * barriers + j) % stress.events);
+      cl_event barrier;
+      CL_CHECK(clEnqueueBarrierWithWaitList(queues[q], 1, &userEvents[e],
+                                            &barrier));
+      watch.watch(barrier);
+      barrierEvents.push_back(barrier);
+      gate.push_back(e);
+    }
+    CL_CHECK(clFlush(queues[q]));
+  }
+
+  auto finish = std::make_shared<Finish>();
+  std::thread([queues, finish] {
+    for (cl_command_queue queue : queues)
+      CL_CHECK(clFinish(queue));
+    std::lock_guard<std::mutex> lock(finish->mutex);
+    finish->done = true;
+    finish->at = Clock::now();
+    finish->cv.notify_all();
+  }).detach();
+
+  // Each thread sets every T-th event, all starting together
+  std::vector<Clock::time_point> signaledAt(stress.events);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> signalers;
+  for (int t = 0; t < stress.threads; t++) {
+    signalers.emplace_back([&, t] {
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      for (int e = t; e < stress.events; e += stress.threads) {
+        signaledAt[e] = Clock::now();
+        CL_CHECK(clSetUserEventStatus(userEvents[e], CL_COMPLETE));
+      }
+    });
+  }
+  auto deadline = Clock::now() + kHangTimeout;
+  go.store(true, std::memory_order_release);
+  for (std::thread &signaler : signalers)
+    signaler.join();
+
+  bool completed = watch.waitUntil(deadline);
+  {
+    std::unique_lock<std::mutex> lock(finish->mutex);
+    completed = finish->cv.wait_until(lock, deadline,
+                                      [&] { return finish->done; }) &&
+                completed;
+  }
+  if (!completed) {
+    printf("%-14s %6zu %8d %8zu   HUNG, %zu barrier(s) pending\n",
+           outOfOrder ? "out-of-order" : "in-order", queues.size(), barriers,
+           barrierEvents.size(), watch.pending());
+    return false; // Stuck commands keep their events
+  }
+
+  // Events nobody waits on (E > M*K) don't delay the queues
+  Clock::time_point lastSignal;
+  for (int e : gate)
+    lastSignal = std::max(lastSignal, signaledAt[e]);
+  finishUs.push_back(
+      std::chrono::duration<double, std::micro>(finish->at - lastSignal)
+          .count());
+  for (size_t q = 0; q < queues.size(); q++) {
+    Clock::time_point ready;
+    for (int j = 0; j < barriers; j++) {
+      size_t i = q * barriers + j;
+      // In order, a barrier also waits for the ones before it
+      ready = outOfOrder || j == 0 ? signaledAt[gate[i]]
+                                   : std::max(ready, signaledAt[gate[i]]);
+      wakeUpUs.push_back(std::chrono::duration<double, std::micro>(
+                             watch.completedAt(i) - ready)
+                             .count());
+    }
+  }
+
+  for (cl_event event : barrierEvents)
+    CL_CHECK(clReleaseEvent(event));
+  for (cl_event event : userEvents)
+    CL_CHECK(clReleaseEvent(event));
+  return true;
+}
+
+// Returns false if a repetition hung; its queues are left alone
+bool runConfig(const Stress &stress, bool outOfOrder, int numQueues,
+               int barriers) {
+  cl_int err;
+  cl_queue_properties props[] = {
+      CL_QUEUE_PROPERTIES,
+      (cl_queue_properties)CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, 0};
+  std::vector<cl_command_queue> queues(numQueues);
+  for (cl_command_queue &queue : queues) {
+    queue = clCreateCommandQueueWithProperties(
+        stress.context, stress.device, outOfOrder ? props : nullptr, &err);
+    CL_CHECK(err);
+  }
+
+  std::vector<double> wakeUpUs;
+  std::vector<double> finishUs;
+  for (int rep = 0; rep < stress.reps; rep++) {
+    if (!runOnce(queues, outOfOrder, barriers, stress, wakeUpUs, finishUs))
+      return false;
+  }
+  for (cl_command_queue queue : queues)
+    CL_CHECK(clReleaseCommandQueue(queue));
+
+  std::sort(wakeUpUs.begin(), wakeUpUs.end());
+  std::sort(finishUs.begin(), finishUs.end());
+  printf("%-14s %6d %8d %8d %10.1f %10.1f %10.1f %12.1f\n",
+         outOfOrder ? "out-of-order" : "in-order", numQueues, barriers,
+         numQueues * barriers, percentile(wakeUpUs, 0.5),
+         percentile(wakeUpUs, 0.99), wakeUpUs.back(),
+         percentile(finishUs, 0.5));
+  return true;
+}
+
+int main(int argc, char **argv) {
+  cl_device_type type = parseDeviceType(argc > 1 ? argv[1] : nullptr);
+  std::vector<int> queueCounts = parseList(argc > 2 ? argv[2] : "1,8,32");
+  std::vector<int> barrierCounts = parseList(argc > 3 ? argv[3] : "1,8,64");
+  Stress stress;
+  stress.events = argc > 4 ? std::atoi(argv[4]) : 4;
+  stress.threads = argc > 5 ? std::atoi(argv[5]) : 4;
+  stress.reps = argc > 6 ? std::atoi(argv[6]) : 5;
+  if (!type || queueCounts.empty() || barrierCounts.empty() ||
+      stress.events < 1 || stress.threads < 1 || stress.reps < 1) {
+    fprintf(stderr,
+            "Usage: %s [gpu|cpu|any] [queues,...] [barriers,...] [events] "
+            "[threads] [reps]\n",
+            argv[0]);
+    return 1;
+  }
+  stress.threads = std::min(stress.threads, stress.events);
+
+  stress.device = findDevice(type);
+  if (!stress.device) {
+    fprintf(stderr, "No %s device found\n", argc > 1 ? argv[1] : "OpenCL");
+    return 1;
+  }
+  printDevice(stress.device);
+  printf("%d user event(s) set from %d thread(s), %d repetition(s)\n",
+         stress.events, stress.threads, stress.reps);
+
+  cl_int err;
+  stress.context =
+      clCreateContext(nullptr, 1, &stress.device, nullptr, nullptr, &err);
+  CL_CHECK(err);
+
+  printf("\n%-14s %6s %8s %8s %10s %10s %10s %12s\n", "queue", "queues",
+         "barriers", "waiters", "wake p50", "wake p99", "wake max",
+         "finish p50");
+  printf("%-14s %6s %8s %8s %10s %10s %10s %12s\n", "", "", "/queue", "",
+         "[us]", "[us]", "[us]", "[us]");
+  bool ok = true;
+  for (bool outOfOrder : {false, true}) {
+    bool hung = false;
+    for (int numQueues : queueCounts) {
+      for (int barriers : barrierCounts) {
+        if (!runConfig(stress, outOfOrder, numQueues, barriers)) {
+          hung = true;
+          break;
+        }
+      }
+      if (hung)
+        break;
+    }
+    ok = ok && !hung;
+  }
+
+  // A hung queue still references the context
+  if (ok)
+    CL_CHECK(clReleaseContext(stress.context));
+  return ok ? 0 : 1;
+}
@@ -6,17 +6,66 @@
 //
 // Fails on: Intel Data Center GPU Max
 // Works on: Intel Arc A770
+//
+// Every queue gets a thread that is already blocked in clFinish when the
+// user events are set, as in the original report, and all queues of a run
+// share one deadline. A queue passes only if clFinish returned in time and
+// the marker behind the barrier completed without error; a stuck clFinish
+// is reported as FAILED instead of blocking the reproducer. The last test
+// runs the in-order case through DeferredQueue, which keeps the barrier on
+// the host until the user event is set and so works around the bug.
+//
+// Usage: ./minimal_repro [gpu|cpu|any] [queues] [timeout-ms]
 
 #define CL_TARGET_OPENCL_VERSION 300
 #include <CL/cl.h>
 #include <stdio.h>
-#include <thread>
+#include <stdlib.h>
+#include <algorithm>
 #include <chrono>
-#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "CompletionWatch.hpp"
+#include "DeferredQueue.hpp"
+
+using Clock = CompletionWatch::Clock;
+
+// Time for the waiters to block in clFinish before the events are set; the
+// original reproducer signaled after the same delay
+const std::chrono::milliseconds kSettle(100);
 
-std::atomic<bool> finished{false};
+// One queue under test: a barrier on its own user event, then a marker that
+// completes only once everything before it has, which is what clFinish
+// waits for. With `deferred` both go through a DeferredQueue, which holds
+// them on the host until the user event is set.
+struct QueueCheck {
+  cl_command_queue queue;
+  std::unique_ptr<DeferredQueue> deferred;
+  cl_event userEvent;
+  cl_event barrier;
+  cl_event marker;
+  size_t watchIndex;
+};
+
+// Shared with the waiter threads, which stay blocked forever on a hung queue
+struct Waiters {
+  std::mutex mutex;
+  std::condition_variable cv;
+  int blocking = 0;
+  int returned = 0;
+  std::vector<bool> done;
+  std::vector<cl_int> status;
+  std::vector<Clock::time_point> at;
+};
 
-bool testQueue(cl_context context, cl_device_id device, bool outOfOrder) {
+bool testQueues(cl_context context, cl_device_id device, bool outOfOrder,
+                bool deferred, int numQueues,
+                std::chrono::milliseconds timeout) {
   cl_int err;
   cl_queue_properties props[] = {
     CL_QUEUE_PROPERTIES, 
@@ -24,70 +73,144 @@ bool testQueue(cl_context context, cl_device_id device, bool outOfOrder) {
     0
   };
   
-  cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, 
-                                                               outOfOrder ? props : nullptr, &err);
-  printf("\n=== Testing %s queue ===\n", outOfOrder ? "OUT-OF-ORDER" : "IN-ORDER");
-  
-  cl_event userEvent = clCreateUserEvent(context, &err);
-  
-  cl_event barrier;
-  clEnqueueBarrierWithWaitList(queue, 1, &userEvent, &barrier);
-  
-  finished.store(false);
-  
-  // Signal user event from another thread
-  std::thread([userEvent]() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    printf("Signaling user event...\n");
-    cl_int e = clSetUserEventStatus(userEvent, CL_COMPLETE);
-    printf("clSetUserEventStatus returned: %d\n", e);
-  }).detach();
-  
-  // Try clFinish with timeout
-  std::thread([&queue]() {
-    clFinish(queue);
-    finished.store(true);
-  }).detach();
+  printf("\n=== Testing %d %s queue(s)%s ===\n", numQueues,
+         outOfOrder ? "OUT-OF-ORDER" : "IN-ORDER",
+         deferred ? " behind the host resolver" : "");
+  
+  CompletionWatch watch;
+  std::vector<QueueCheck> checks(numQueues);
+  for (QueueCheck& check : checks) {
+    check.queue = clCreateCommandQueueWithProperties(context, device, 
+                                                     outOfOrder ? props : nullptr, &err);
+    CL_CHECK(err);
+    check.userEvent = clCreateUserEvent(context, &err);
+    CL_CHECK(err);
+    if (deferred) {
+      // Held commands lose in-order semantics, so the marker names the barrier
+      check.deferred.reset(new DeferredQueue(context, check.queue));
+      check.barrier = check.deferred->barrier({check.userEvent});
+      check.marker = check.deferred->marker({check.barrier});
+    } else {
+      CL_CHECK(clEnqueueBarrierWithWaitList(check.queue, 1, &check.userEvent, &check.barrier));
+      CL_CHECK(clEnqueueMarkerWithWaitList(check.queue, 0, nullptr, &check.marker));
+    }
+    CL_CHECK(clFlush(check.queue));
+    check.watchIndex = watch.watch(check.marker);
+  }
   
-  // Wait up to 3 seconds
-  for (int i = 0; i < 30; i++) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    if (finished.load()) {
-      printf("PASSED - clFinish returned\n");
-      clReleaseEvent(barrier);
-      clReleaseEvent(userEvent);
-      clReleaseCommandQueue(queue);
-      return true;
+  // Block a thread per queue in clFinish. The resolver keeps the commands
+  // on the host, where clFinish cannot see them, so there the thread waits
+  // for the marker first.
+  auto waiters = std::make_shared<Waiters>();
+  waiters->done.resize(numQueues);
+  waiters->status.resize(numQueues);
+  waiters->at.resize(numQueues);
+  for (int i = 0; i < numQueues; i++) {
+    cl_command_queue queue = checks[i].queue;
+    cl_event marker = deferred ? checks[i].marker : nullptr;
+    std::thread([waiters, i, queue, marker] {
+      {
+        std::lock_guard<std::mutex> lock(waiters->mutex);
+        waiters->blocking++;
+      }
+      waiters->cv.notify_all();
+      cl_int status = marker ? clWaitForEvents(1, &marker) : CL_SUCCESS;
+      if (status == CL_SUCCESS)
+        status = clFinish(queue);
+      std::lock_guard<std::mutex> lock(waiters->mutex);
+      waiters->done[i] = true;
+      waiters->status[i] = status;
+      waiters->at[i] = Clock::now();
+      waiters->returned++;
+      waiters->cv.notify_all();
+    }).detach();
+  }
+  {
+    std::unique_lock<std::mutex> lock(waiters->mutex);
+    waiters->cv.wait(lock, [&] { return waiters->blocking == numQueues; });
+  }
+  std::this_thread::sleep_for(kSettle);
+  
+  // Every queue is armed before the first signal, so all of them are
+  // checked against the same deadline
+  auto signaled = Clock::now();
+  for (QueueCheck& check : checks)
+    CL_CHECK(clSetUserEventStatus(check.userEvent, CL_COMPLETE));
+  auto deadline = signaled + timeout;
+  {
+    std::unique_lock<std::mutex> lock(waiters->mutex);
+    waiters->cv.wait_until(lock, deadline,
+                           [&] { return waiters->returned == numQueues; });
+  }
+  watch.waitUntil(deadline);
+  
+  int passed = 0;
+  double maxUs = 0.0;
+  for (int i = 0; i < numQueues; i++) {
+    QueueCheck& check = checks[i];
+    bool returned;
+    cl_int finishStatus;
+    Clock::time_point returnedAt;
+    {
+      std::lock_guard<std::mutex> lock(waiters->mutex);
+      returned = waiters->done[i];
+      finishStatus = waiters->status[i];
+      returnedAt = waiters->at[i];
+    }
+    if (!returned) {
+      if (numQueues <= 16)
+        printf("queue %d: FAILED - clFinish hung, %lld ms after "
+               "clSetUserEventStatus (marker %s)\n", i,
+               (long long)timeout.count(),
+               watch.done(check.watchIndex) ? "completed" : "pending");
+      // Don't cleanup - queue is stuck and its waiter still uses it
+      check.deferred.release();
+      continue;
     }
+    bool ok = finishStatus == CL_SUCCESS && watch.done(check.watchIndex) &&
+              watch.status(check.watchIndex) == CL_COMPLETE;
+    if (!ok) {
+      if (numQueues <= 16)
+        printf("queue %d: FAILED - clFinish returned %d, marker %s %d\n", i,
+               finishStatus,
+               watch.done(check.watchIndex) ? "status" : "never completed,",
+               watch.status(check.watchIndex));
+    } else {
+      double us = std::chrono::duration<double, std::micro>(
+                      returnedAt - signaled).count();
+      maxUs = std::max(maxUs, us);
+      passed++;
+    }
+    check.deferred.reset();
+    clReleaseEvent(check.marker);
+    clReleaseEvent(check.barrier);
+    clReleaseEvent(check.userEvent);
+    clReleaseCommandQueue(check.queue);
   }
   
-  printf("FAILED - clFinish hung (timeout after 3s)\n");
-  // Don't cleanup - queue is stuck
-  return false;
+  if (passed == numQueues)
+    printf("PASSED - clFinish returned on %d/%d queue(s), slowest %.1f us "
+           "after signaling\n", passed, numQueues, maxUs);
+  else
+    printf("FAILED - %d/%d queue(s) hung or failed\n", numQueues - passed,
+           numQueues);
+  return passed == numQueues;
 }
 
-int main() {
-  cl_platform_id platform = nullptr;
-  cl_device_id device = nullptr;
-  cl_int err;
-  
-  cl_uint numPlatforms;
-  clGetPlatformIDs(0, nullptr, &numPlatforms);
-  cl_platform_id* platforms = new cl_platform_id[numPlatforms];
-  clGetPlatformIDs(numPlatforms, platforms, nullptr);
-  
-  for (cl_uint i = 0; i < numPlatforms; i++) {
-    cl_uint numDevices;
-    if (clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, 0, nullptr, &numDevices) == CL_SUCCESS && numDevices > 0) {
-      platform = platforms[i];
-      clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr);
-      break;
-    }
+int main(int argc, char** argv) {
+  // Default to any device, GPU first; "cpu" runs on a CPU OpenCL platform
+  cl_device_type type = parseDeviceType(argc > 1 ? argv[1] : nullptr);
+  int numQueues = argc > 2 ? atoi(argv[2]) : 1;
+  int timeoutMs = argc > 3 ? atoi(argv[3]) : 3000;
+  if (!type || numQueues < 1 || timeoutMs < 1) {
+    fprintf(stderr, "Usage: %s [gpu|cpu|any] [queues] [timeout-ms]\n", argv[0]);
+    return 1;
   }
-  delete[] platforms;
+  cl_device_id device = findDevice(type);
+  cl_int err;
   
   if (!device) {
-    fprintf(stderr, "No GPU found\n");
+    fprintf(stderr, "No %s device found\n", argc > 1 ? argv[1] : "OpenCL");
     return 1;
   }
   
@@ -97,13 +220,16 @@ int main() {
   
   cl_context context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
   
-  bool inOrderOk = testQueue(context, device, false);   // in-order
-  bool outOfOrderOk = testQueue(context, device, true); // out-of-order
+  std::chrono::milliseconds timeout(timeoutMs);
+  bool inOrderOk = testQueues(context, device, false, false, numQueues, timeout);
+  bool outOfOrderOk = testQueues(context, device, true, false, numQueues, timeout);
+  bool deferredOk = testQueues(context, device, false, true, numQueues, timeout);
   
   printf("\n=== Summary ===\n");
   printf("In-order queue:     %s\n", inOrderOk ? "PASS" : "FAIL (BUG!)");
   printf("Out-of-order queue: %s\n", outOfOrderOk ? "PASS" : "FAIL");
+  printf("In-order, resolver: %s\n", deferredOk ? "PASS" : "FAIL");
   
   clReleaseContext(context);
-  return (inOrderOk && outOfOrderOk) ? 0 : 1;
+  return (inOrderOk && outOfOrderOk && deferredOk) ? 0 : 1;
 }
@@ -0,0 +1,289 @@
+// In-order vs out-of-order command queue throughput on any OpenCL device.
+//
+// Grown out of minimal_repro.cpp: the same barrier-on-user-event pattern,
+// but measured instead of merely checked, and on GPU or CPU devices.
+// Per queue mode it enqueues `depth` commands as
+//
+//   kernel chain    each kernel depends on the previous one (implicitly on
+//                   an in-order queue, through its wait list otherwise)
+//   kernel fan      independent kernels, each on its own slice of the
+//                   buffer; only an out-of-order queue may overlap them
+//   kernel+barrier  every kernel followed by a barrier
+//   user-gated      a barrier on an unsignaled user event heads a kernel
+//                   chain; the chain is enqueued, then the event is set
+//   host-gated      the same through DeferredQueue, which holds the gated
+//                   chain on the host and enqueues it once the event is set
+//
+// and reports commands per second from the first enqueue to the observed
+// completion of the last command. User-event wake-up latency is the time
+// from clSetUserEventStatus to the completion of a barrier waiting on it,
+// observed by polling, over `reps` repetitions. A test whose commands do not
+// complete within 5 s is reported as HUNG (the in-order bug that
+// minimal_repro.cpp detects) and ends that queue mode.
+//
+// Usage: ./queue_bench [gpu|cpu|any] [depth] [reps]
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "DeferredQueue.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const std::chrono::milliseconds kHangTimeout(5000);
+
+const char *kSource = R"(
+__kernel void inc(__global int *data) { data[get_global_id(0)] += 1; }
+)";
+
+const size_t kWorkItems = 64;
+
+struct Bench {
+  cl_context context;
+  cl_device_id device;
+  cl_kernel kernel;
+  cl_mem buffer;
+  int depth;
+  int reps;
+};
+
+// Enqueue one kernel on slice `slice` of the buffer, chained on `wait` when
+// given. Returns its event. Kernels that may overlap need distinct slices.
+cl_event enqueueKernel(cl_command_queue queue, const Bench &bench,
+                       cl_event wait, size_t slice = 0) {
+  size_t offset = slice * kWorkItems;
+  cl_event event;
+  CL_CHECK(clEnqueueNDRangeKernel(queue, bench.kernel, 1, &offset, &kWorkItems,
+                                  nullptr, wait ? 1 : 0,
+                                  wait ? &wait : nullptr, &event));
+  return event;
+}
+
+// Replace `last` with `next`, dropping our reference to the old event
+void advance(cl_event &last, cl_event next) {
+  if (last)
+    CL_CHECK(clReleaseEvent(last));
+  last = next;
+}
+
+enum class Test { KernelChain, KernelFan, KernelBarrier, UserGated, HostGated };
+
+const char *testName(Test test) {
+  switch (test) {
+  case Test::KernelChain:
+    return "kernel chain";
+  case Test::KernelFan:
+    return "kernel fan";
+  case Test::KernelBarrier:
+    return "kernel+barrier";
+  case Test::UserGated:
+    return "user-gated";
+  case Test::HostGated:
+    return "host-gated";
+  }
+  return "";
+}
+
+// Returns false if the commands never completed
+bool runThroughput(cl_command_queue queue, bool outOfOrder, const Bench &bench,
+                   Test test) {
+  // An out-of-order queue needs explicit edges to express a chain, and so
+  // do commands the resolver holds back
+  bool chain =
+      (outOfOrder && test != Test::KernelFan) || test == Test::HostGated;
+  std::unique_ptr<DeferredQueue> deferred;
+  cl_event last = nullptr;
+  cl_event userEvent = nullptr;
+  int commands = 0;
+
+  auto begin = Clock::now();
+  if (test == Test::UserGated || test == Test::HostGated) {
+    cl_int err;
+    userEvent = clCreateUserEvent(bench.context, &err);
+    CL_CHECK(err);
+    cl_event gate;
+    if (test == Test::HostGated) {
+      deferred.reset(new DeferredQueue(bench.context, queue));
+      gate = deferred->barrier({userEvent});
+    } else {
+      CL_CHECK(clEnqueueBarrierWithWaitList(queue, 1, &userEvent, &gate));
+    }
+    advance(last, gate);
+    commands++;
+  }
+  std::vector<cl_event> fan;
+  while (commands < bench.depth) {
+    if (deferred) {
+      advance(last, deferred->kernel(bench.kernel, 1, &kWorkItems, nullptr,
+                                     {last}));
+      commands++;
+      continue;
+    }
+    if (test == Test::KernelFan) {
+      fan.push_back(enqueueKernel(queue, bench, nullptr, fan.size()));
+      commands++;
+      continue;
+    }
+    advance(last, enqueueKernel(queue, bench, chain ? last : nullptr));
+    commands++;
+    if (test == Test::KernelBarrier && commands < bench.depth) {
+      cl_event barrier;
+      CL_CHECK(clEnqueueBarrierWithWaitList(queue, 0, nullptr, &barrier));
+      advance(last, barrier);
+      commands++;
+    }
+  }
+  if (test == Test::KernelFan) {
+    cl_event all;
+    CL_CHECK(clEnqueueMarkerWithWaitList(queue, cl_uint(fan.size()),
+                                         fan.data(), &all));
+    for (cl_event event : fan)
+      CL_CHECK(clReleaseEvent(event));
+    last = all;
+  }
+  CL_CHECK(clFlush(queue));
+  auto enqueued = Clock::now();
+  if (userEvent)
+    CL_CHECK(clSetUserEventStatus(userEvent, CL_COMPLETE));
+
+  bool completed = pollComplete(last, kHangTimeout);
+  auto end = Clock::now();
+  if (!completed) {
+    printf("%-14s %-16s HUNG after %d commands\n",
+           outOfOrder ? "out-of-order" : "in-order", testName(test), commands);
+    deferred.release();
+    return false;
+  }
+  deferred.reset();
+  CL_CHECK(clReleaseEvent(last));
+  if (userEvent)
+    CL_CHECK(clReleaseEvent(userEvent));
+  CL_CHECK(clFinish(queue));
+
+  double enqueueMs =
+      std::chrono::duration<double, std::milli>(enqueued - begin).count();
+  double totalMs = std::chrono::duration<double, std::milli>(end - begin).count();
+  printf("%-14s %-16s %9d %12.3f %12.3f %14.0f\n",
+         outOfOrder ? "out-of-order" : "in-order", testName(test), commands,
+         enqueueMs, totalMs, commands / (totalMs / 1e3));
+  return true;
+}
+
+// Returns false if a gated barrier never completed
+bool runWakeUp(cl_command_queue queue, bool outOfOrder, const Bench &bench) {
+  std::vector<double> latenciesUs;
+  for (int rep = 0; rep < bench.reps; rep++) {
+    cl_int err;
+    cl_event userEvent = clCreateUserEvent(bench.context, &err);
+    CL_CHECK(err);
+    cl_event barrier;
+    CL_CHECK(clEnqueueBarrierWithWaitList(queue, 1, &userEvent, &barrier));
+    CL_CHECK(clFlush(queue));
+
+    auto signaled = Clock::now();
+    CL_CHECK(clSetUserEventStatus(userEvent, CL_COMPLETE));
+    if (!pollComplete(barrier, kHangTimeout)) {
+      printf("%-14s %-16s HUNG on repetition %d\n",
+             outOfOrder ? "out-of-order" : "in-order", "wake-up", rep);
+      return false;
+    }
+    latenciesUs.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - signaled)
+            .count());
+    CL_CHECK(clReleaseEvent(barrier));
+    CL_CHECK(clReleaseEvent(userEvent));
+  }
+  CL_CHECK(clFinish(queue));
+
+  std::sort(latenciesUs.begin(), latenciesUs.end());
+  auto percentile = [&](double q) {
+    return latenciesUs[size_t(q * (latenciesUs.size() - 1))];
+  };
+  printf("%-14s %-16s %9d %12.2f %12.2f %14.2f\n",
+         outOfOrder ? "out-of-order" : "in-order", "wake-up [us]",
+         bench.reps, percentile(0.5), percentile(0.99), latenciesUs.back());
+  return true;
+}
+
+void runQueue(const Bench &bench, bool outOfOrder) {
+  cl_int err;
+  cl_queue_properties props[] = {
+      CL_QUEUE_PROPERTIES,
+      (cl_queue_properties)CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, 0};
+  cl_command_queue queue = clCreateCommandQueueWithProperties(
+      bench.context, bench.device, outOfOrder ? props : nullptr, &err);
+  CL_CHECK(err);
+
+  // Warm up the kernel and the queue
+  cl_event warmUp = enqueueKernel(queue, bench, nullptr);
+  CL_CHECK(clWaitForEvents(1, &warmUp));
+  CL_CHECK(clReleaseEvent(warmUp));
+
+  for (Test test : {Test::KernelChain, Test::KernelFan, Test::KernelBarrier,
+                    Test::HostGated, Test::UserGated}) {
+    if (!runThroughput(queue, outOfOrder, bench, test))
+      return; // A stuck queue cannot be released
+  }
+  if (!runWakeUp(queue, outOfOrder, bench))
+    return;
+  CL_CHECK(clReleaseCommandQueue(queue));
+}
+
+int main(int argc, char **argv) {
+  cl_device_type type = parseDeviceType(argc > 1 ? argv[1] : nullptr);
+  int depth = argc > 2 ? std::atoi(argv[2]) : 10000;
+  int reps = argc > 3 ? std::atoi(argv[3]) : 1000;
+  if (!type || depth < 1 || reps < 1) {
+    fprintf(stderr, "Usage: %s [gpu|cpu|any] [depth] [reps]\n", argv[0]);
+    return 1;
+  }
+
+  Bench bench;
+  bench.device = findDevice(type);
+  if (!bench.device) {
+    fprintf(stderr, "No %s device found\n", argc > 1 ? argv[1] : "OpenCL");
+    return 1;
+  }
+  printDevice(bench.device);
+  bench.depth = depth;
+  bench.reps = reps;
+
+  cl_int err;
+  bench.context =
+      clCreateContext(nullptr, 1, &bench.device, nullptr, nullptr, &err);
+  CL_CHECK(err);
+  cl_program program =
+      clCreateProgramWithSource(bench.context, 1, &kSource, nullptr, &err);
+  CL_CHECK(err);
+  CL_CHECK(clBuildProgram(program, 1, &bench.device, nullptr, nullptr, nullptr));
+  bench.kernel = clCreateKernel(program, "inc", &err);
+  CL_CHECK(err);
+  // One slice per fan kernel
+  bench.buffer =
+      clCreateBuffer(bench.context, CL_MEM_READ_WRITE,
+                     size_t(depth) * kWorkItems * sizeof(int), nullptr, &err);
+  CL_CHECK(err);
+  CL_CHECK(clSetKernelArg(bench.kernel, 0, sizeof(cl_mem), &bench.buffer));
+
+  printf("\n%-14s %-16s %9s %12s %12s %14s\n", "queue", "test", "commands",
+         "enqueue [ms]", "total [ms]", "commands/s");
+  printf("%-14s %-16s %9s %12s %12s %14s\n", "", "", "reps", "p50", "p99",
+         "max");
+  runQueue(bench, false);
+  runQueue(bench, true);
+
+  CL_CHECK(clReleaseMemObject(bench.buffer));
+  CL_CHECK(clReleaseKernel(bench.kernel));
+  CL_CHECK(clReleaseProgram(program));
+  CL_CHECK(clReleaseContext(bench.context));
+  return 0;
+}
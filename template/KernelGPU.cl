@@ -8,4 +8,20 @@ __kernel void mxm(__global int* a, __global int* b, __global int *c, const int n
 	}
 
 	c[idx * n + jdx] = sum;
-}
\ No newline at end of file
+}
+
+// One step of a tiled product on packed tile x tile blocks:
+// c (+)= a * b, overwriting c when accumulate is 0
+__kernel void mxmTile(__global int *c, __global const int *a,
+                      __global const int *b, const int tile,
+                      const int accumulate) {
+	uint idx = get_global_id(0);
+	uint jdx = get_global_id(1);
+
+	int sum = accumulate ? c[idx * tile + jdx] : 0;
+	for (int k = 0; k < tile; k++) {
+		sum += a[idx * tile + k] * b[k * tile + jdx];
+	}
+
+	c[idx * tile + jdx] = sum;
+}
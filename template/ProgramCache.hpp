@@ -0,0 +1,236 @@
+// On-disk cache of built OpenCL programs.
+//
+// clBuildProgram compiles the kernels on every start, the same cost
+// zeModuleCreate pays in main.cpp. build() looks for the device binary of a
+// program first: an entry is keyed by the device name, the driver version and
+// a hash of the program input and the build options, so a driver update, a
+// different device or a changed kernel never picks up a stale binary. On a
+// hit the program comes from clCreateProgramWithBinary, on a miss it is built
+// from its input and CL_PROGRAM_BINARIES is written back.
+//
+// Processes share the directory through flock on a lock file per entry:
+// lookups hold it shared, a miss rebuilds and stores under the exclusive lock
+// and looks again first, so concurrent processes build an entry only once.
+// Entries are written to a temporary file and renamed into place, so even a
+// reader that skips the lock never sees a partial binary. A binary the
+// runtime rejects counts as a miss and is replaced. If the directory cannot
+// be used the program is simply built every time.
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ProgramCache {
+public:
+  // CL_PROGRAM_CACHE_DIR, else .clcache in the working directory
+  ProgramCache() : ProgramCache(defaultDirectory()) {}
+
+  explicit ProgramCache(std::string directory)
+      : directory(std::move(directory)) {
+    if (mkdir(this->directory.c_str(), 0755) != 0 && errno != EEXIST) {
+      std::cout << "ProgramCache: cannot create " << this->directory
+                << ", building without cache" << std::endl;
+      this->directory.clear();
+    }
+  }
+
+  // Returns a built program for `device`. `input` is OpenCL C source, or
+  // SPIR-V when `il` is set. `hit`, when given, tells whether the binary came
+  // from the cache.
+  cl_program build(cl_context context, cl_device_id device,
+                   const std::vector<char> &input, bool il,
+                   const std::string &options, bool *hit = nullptr) {
+    if (hit)
+      *hit = false;
+    if (directory.empty())
+      return buildFromInput(context, device, input, il, options);
+
+    std::string path = entryPath(device, input, il, options);
+    int lockFd = open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFd < 0)
+      return buildFromInput(context, device, input, il, options);
+
+    flock(lockFd, LOCK_SH);
+    cl_program program = load(context, device, path, options);
+    if (!program) {
+      // Upgrading is not atomic: another process may have stored the entry
+      // between the two locks
+      flock(lockFd, LOCK_EX);
+      program = load(context, device, path, options);
+    }
+    if (program) {
+      if (hit)
+        *hit = true;
+    } else {
+      program = buildFromInput(context, device, input, il, options);
+      store(program, device, path);
+    }
+    flock(lockFd, LOCK_UN);
+    close(lockFd);
+    return program;
+  }
+
+private:
+  static std::string defaultDirectory() {
+    const char *env = getenv("CL_PROGRAM_CACHE_DIR");
+    return env && *env ? env : ".clcache";
+  }
+
+  static std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    CL_CHECK(clGetDeviceInfo(device, param, 0, nullptr, &size));
+    std::string value(size, '\0');
+    CL_CHECK(clGetDeviceInfo(device, param, size, &value[0], nullptr));
+    value.resize(value.find('\0') == std::string::npos ? value.size()
+                                                        : value.find('\0'));
+    return value;
+  }
+
+  // Keeps file names portable
+  static std::string sanitize(const std::string &text) {
+    std::string result;
+    for (char c : text)
+      result += isalnum(static_cast<unsigned char>(c)) || c == '.' ? c : '_';
+    return result;
+  }
+
+  // FNV-1a, 64 bit
+  static uint64_t hash(const char *data, size_t size, uint64_t h) {
+    for (size_t i = 0; i < size; i++)
+      h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+    return h;
+  }
+
+  std::string entryPath(cl_device_id device, const std::vector<char> &input,
+                        bool il, const std::string &options) const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = hash(input.data(), input.size(), h);
+    h = hash(il ? "\1" : "\0", 1, h);
+    h = hash(options.data(), options.size(), h);
+    char digest[17];
+    snprintf(digest, sizeof(digest), "%016llx",
+             static_cast<unsigned long long>(h));
+    return directory + "/" + sanitize(deviceString(device, CL_DEVICE_NAME)) +
+           "-" + sanitize(deviceString(device, CL_DRIVER_VERSION)) + "-" +
+           digest + ".bin";
+  }
+
+  // The cached program, or nullptr on a miss or a binary the runtime rejects
+  static cl_program load(cl_context context, cl_device_id device,
+                         const std::string &path, const std::string &options) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return nullptr;
+    std::vector<unsigned char> binary((std::istreambuf_iterator<char>(file)),
+                                      std::istreambuf_iterator<char>());
+    if (binary.empty())
+      return nullptr;
+
+    const unsigned char *data = binary.data();
+    size_t size = binary.size();
+    cl_int status;
+    cl_int err;
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &size,
+                                                   &data, &status, &err);
+    if (err != CL_SUCCESS || status != CL_SUCCESS) {
+      if (program)
+        CL_CHECK(clReleaseProgram(program));
+      return nullptr;
+    }
+    if (clBuildProgram(program, 1, &device, options.c_str(), nullptr,
+                       nullptr) != CL_SUCCESS) {
+      CL_CHECK(clReleaseProgram(program));
+      return nullptr;
+    }
+    return program;
+  }
+
+  static cl_program buildFromInput(cl_context context, cl_device_id device,
+                                   const std::vector<char> &input, bool il,
+                                   const std::string &options) {
+    cl_int err;
+    cl_program program;
+    if (il) {
+      program = clCreateProgramWithIL(context, input.data(), input.size(), &err);
+    } else {
+      const char *text = input.data();
+      size_t length = input.size();
+      program = clCreateProgramWithSource(context, 1, &text, &length, &err);
+    }
+    CL_CHECK(err);
+    if (clBuildProgram(program, 1, &device, options.c_str(), nullptr,
+                       nullptr) != CL_SUCCESS) {
+      size_t szLog = 0;
+      clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr,
+                            &szLog);
+      std::vector<char> stringLog(szLog + 1);
+      clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, szLog,
+                            stringLog.data(), nullptr);
+      std::cout << "clBuildProgram failed: Build log: " << stringLog.data()
+                << std::endl;
+      std::abort();
+    }
+    return program;
+  }
+
+  // Write the binary for `device` next to `path` and rename it into place.
+  // Caller holds the entry's exclusive lock.
+  static void store(cl_program program, cl_device_id device,
+                    const std::string &path) {
+    cl_uint numDevices = 0;
+    CL_CHECK(clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES,
+                              sizeof(numDevices), &numDevices, nullptr));
+    std::vector<cl_device_id> devices(numDevices);
+    CL_CHECK(clGetProgramInfo(program, CL_PROGRAM_DEVICES,
+                              numDevices * sizeof(cl_device_id),
+                              devices.data(), nullptr));
+    std::vector<size_t> sizes(numDevices);
+    CL_CHECK(clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES,
+                              numDevices * sizeof(size_t), sizes.data(),
+                              nullptr));
+    std::vector<std::vector<unsigned char>> binaries(numDevices);
+    std::vector<unsigned char *> pointers(numDevices);
+    size_t index = numDevices;
+    for (cl_uint i = 0; i < numDevices; i++) {
+      binaries[i].resize(sizes[i]);
+      pointers[i] = binaries[i].data();
+      if (devices[i] == device)
+        index = i;
+    }
+    if (index == numDevices || sizes[index] == 0)
+      return; // Nothing to cache for this device
+    CL_CHECK(clGetProgramInfo(program, CL_PROGRAM_BINARIES,
+                              numDevices * sizeof(unsigned char *),
+                              pointers.data(), nullptr));
+
+    std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char *>(binaries[index].data()),
+                 binaries[index].size());
+      if (!file.good()) {
+        std::cout << "ProgramCache: cannot write " << temporary << std::endl;
+        file.close();
+        unlink(temporary.c_str());
+        return;
+      }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+      unlink(temporary.c_str());
+  }
+
+  std::string directory;
+};
@@ -0,0 +1,259 @@
+// Out-of-core matrix multiply, C = A * B with n x n int matrices in host
+// memory that do not have to fit on the device.
+//
+// The device only holds a fixed working set of tile x tile blocks: two A
+// tiles, two B tiles and two C tiles. For every C tile (i, j) the k loop
+// streams A(i, k) and B(k, j) through the A/B double buffer on the copy
+// engine while mxmTile accumulates into the C tile on the compute engine,
+// so the upload of step k + 1 overlaps the compute of step k. Finished C
+// tiles go back to the host on a second copy list while the next C tile is
+// being computed. Host tiles are addressed in place with
+// zeCommandListAppendMemoryCopyRegion, so nothing is packed on the host.
+//
+// Immediate lists do not order their commands, so the dependencies are
+// explicit: a barrier on the upload list signals a slot's uploaded event
+// once both of its tiles have landed, and a barrier on the compute list
+// keeps every accumulation into a C tile behind the previous one. The last
+// step of a C tile therefore completes after all of them, and its download
+// only has to wait for that step.
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "ze_api.h"
+
+class TiledGemm {
+public:
+  TiledGemm(ze_context_handle_t context, ze_device_handle_t device,
+            ze_module_handle_t module, uint32_t tile)
+      : context(context), tile(tile) {
+    uint32_t computeOrdinal = 0;
+    uint32_t copyOrdinal = 0;
+    bool dedicatedCopy = false;
+    uint32_t numQueueGroups = 0;
+    ZE_CHECK(zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups,
+                                                    nullptr));
+    std::vector<ze_command_queue_group_properties_t> queueProperties(
+        numQueueGroups);
+    ZE_CHECK(zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups,
+                                                    queueProperties.data()));
+    for (uint32_t i = 0; i < numQueueGroups; i++) {
+      auto flags = queueProperties[i].flags;
+      if (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE)
+        computeOrdinal = i;
+      else if (!dedicatedCopy &&
+               (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY)) {
+        copyOrdinal = i;
+        dedicatedCopy = true;
+      }
+    }
+    if (!dedicatedCopy)
+      copyOrdinal = computeOrdinal;
+    std::cout << "Tile uploads on "
+              << (dedicatedCopy ? "dedicated copy engine" : "compute engine")
+              << std::endl;
+
+    computeList = createList(device, computeOrdinal);
+    uploadList = createList(device, copyOrdinal);
+    downloadList = createList(device, copyOrdinal);
+
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 6};
+    ZE_CHECK(
+        zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                 ZE_EVENT_SCOPE_FLAG_HOST,
+                                 ZE_EVENT_SCOPE_FLAG_HOST};
+    for (int s = 0; s < 2; s++) {
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &uploaded[s]));
+      eventDesc.index++;
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &computed[s]));
+      eventDesc.index++;
+      ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &downloaded[s]));
+      eventDesc.index++;
+    }
+
+    size_t tileBytes = size_t(tile) * tile * sizeof(int);
+    ze_device_mem_alloc_desc_t deviceDesc = {
+        ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+    for (int s = 0; s < 2; s++) {
+      ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, tileBytes, 64, device,
+                                &aTile[s]));
+      ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, tileBytes, 64, device,
+                                &bTile[s]));
+      ZE_CHECK(zeMemAllocDevice(context, &deviceDesc, tileBytes, 64, device,
+                                &cTile[s]));
+    }
+
+    ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+    kernelDesc.pKernelName = "mxmTile";
+    ZE_CHECK(zeKernelCreate(module, &kernelDesc, &kernel));
+    uint32_t groupSizeX = 16u;
+    uint32_t groupSizeY = 16u;
+    uint32_t groupSizeZ = 1u;
+    ZE_CHECK(zeKernelSuggestGroupSize(kernel, tile, tile, 1U, &groupSizeX,
+                                      &groupSizeY, &groupSizeZ));
+    ZE_CHECK(zeKernelSetGroupSize(kernel, groupSizeX, groupSizeY, groupSizeZ));
+    dispatch = {tile / groupSizeX, tile / groupSizeY, 1};
+    int tileArg = tile;
+    ZE_CHECK(zeKernelSetArgumentValue(kernel, 3, sizeof(int), &tileArg));
+  }
+
+  // Device memory held by the working set
+  size_t workingSetBytes() const {
+    return 6 * size_t(tile) * tile * sizeof(int);
+  }
+
+  // Must run before the module and the context are destroyed
+  void release() {
+    ZE_CHECK(zeKernelDestroy(kernel));
+    for (int s = 0; s < 2; s++) {
+      ZE_CHECK(zeMemFree(context, aTile[s]));
+      ZE_CHECK(zeMemFree(context, bTile[s]));
+      ZE_CHECK(zeMemFree(context, cTile[s]));
+      ZE_CHECK(zeEventDestroy(uploaded[s]));
+      ZE_CHECK(zeEventDestroy(computed[s]));
+      ZE_CHECK(zeEventDestroy(downloaded[s]));
+    }
+    ZE_CHECK(zeEventPoolDestroy(eventPool));
+    ZE_CHECK(zeCommandListDestroy(computeList));
+    ZE_CHECK(zeCommandListDestroy(uploadList));
+    ZE_CHECK(zeCommandListDestroy(downloadList));
+  }
+
+  // c = a * b for n x n row-major host matrices, n a multiple of the tile.
+  // With overlap off every step waits for its compute before the next
+  // upload starts, which gives the serialized baseline.
+  void multiply(int *c, const int *a, const int *b, uint32_t n,
+                bool overlap = true) {
+    uint32_t tiles = n / tile;
+    uint32_t rowBytes = tile * sizeof(int);
+    uint32_t pitch = n * sizeof(int);
+    ze_copy_region_t tileRegion = {0, 0, 0, rowBytes, tile, 0};
+
+    bool slotBusy[2] = {false, false};
+    bool cBusy[2] = {false, false};
+    int slotDownload[2] = {-1, -1}; // C slot whose download waits on computed
+    uint64_t step = 0;
+    uint32_t cIndex = 0;
+
+    for (uint32_t i = 0; i < tiles; i++) {
+      for (uint32_t j = 0; j < tiles; j++, cIndex++) {
+        int cs = cIndex % 2;
+        if (cBusy[cs]) {
+          sync(downloaded[cs]);
+          ZE_CHECK(zeEventHostReset(downloaded[cs]));
+        }
+
+        int lastSlot = 0;
+        for (uint32_t k = 0; k < tiles; k++, step++) {
+          int s = step % 2;
+          if (slotBusy[s]) {
+            sync(computed[s]);
+            // The download of a finished C tile may still wait on this event
+            if (slotDownload[s] >= 0)
+              sync(downloaded[slotDownload[s]]);
+            slotDownload[s] = -1;
+            ZE_CHECK(zeEventHostReset(uploaded[s]));
+            ZE_CHECK(zeEventHostReset(computed[s]));
+          }
+
+          // A(i, k) and B(k, j) straight out of the row-major host matrices
+          const char *aRows =
+              reinterpret_cast<const char *>(a) + size_t(i) * tile * pitch;
+          const char *bRows =
+              reinterpret_cast<const char *>(b) + size_t(k) * tile * pitch;
+          ze_copy_region_t aRegion = {k * rowBytes, 0, 0, rowBytes, tile, 0};
+          ze_copy_region_t bRegion = {j * rowBytes, 0, 0, rowBytes, tile, 0};
+          ZE_CHECK(zeCommandListAppendMemoryCopyRegion(
+              uploadList, aTile[s], &tileRegion, rowBytes, 0, aRows, &aRegion,
+              pitch, 0, nullptr, 0, nullptr));
+          ZE_CHECK(zeCommandListAppendMemoryCopyRegion(
+              uploadList, bTile[s], &tileRegion, rowBytes, 0, bRows, &bRegion,
+              pitch, 0, nullptr, 0, nullptr));
+          ZE_CHECK(zeCommandListAppendBarrier(uploadList, uploaded[s], 0,
+                                              nullptr));
+
+          // Steps k - 1 and k read and write the same C tile. A barrier
+          // rather than a wait on the previous computed event, which the
+          // host may reset for the next step before this launch starts.
+          int accumulate = k > 0;
+          if (accumulate)
+            ZE_CHECK(zeCommandListAppendBarrier(computeList, nullptr, 0,
+                                                nullptr));
+          ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(void *),
+                                            &cTile[cs]));
+          ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(void *),
+                                            &aTile[s]));
+          ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(void *),
+                                            &bTile[s]));
+          ZE_CHECK(zeKernelSetArgumentValue(kernel, 4, sizeof(int),
+                                            &accumulate));
+          ZE_CHECK(zeCommandListAppendLaunchKernel(
+              computeList, kernel, &dispatch, computed[s], 1, &uploaded[s]));
+          slotBusy[s] = true;
+          lastSlot = s;
+          if (!overlap)
+            sync(computed[s]);
+        }
+
+        // The compute barriers make the last step complete after the others
+        char *cRows = reinterpret_cast<char *>(c) + size_t(i) * tile * pitch;
+        ze_copy_region_t cRegion = {j * rowBytes, 0, 0, rowBytes, tile, 0};
+        ZE_CHECK(zeCommandListAppendMemoryCopyRegion(
+            downloadList, cRows, &cRegion, pitch, 0, cTile[cs], &tileRegion,
+            rowBytes, 0, downloaded[cs], 1, &computed[lastSlot]));
+        slotDownload[lastSlot] = cs;
+        cBusy[cs] = true;
+        if (!overlap)
+          sync(downloaded[cs]);
+      }
+    }
+
+    for (int cs = 0; cs < 2; cs++)
+      if (cBusy[cs]) {
+        sync(downloaded[cs]);
+        ZE_CHECK(zeEventHostReset(downloaded[cs]));
+      }
+    for (int s = 0; s < 2; s++)
+      if (slotBusy[s]) {
+        sync(computed[s]);
+        ZE_CHECK(zeEventHostReset(uploaded[s]));
+        ZE_CHECK(zeEventHostReset(computed[s]));
+      }
+  }
+
+private:
+  ze_command_list_handle_t createList(ze_device_handle_t device,
+                                      uint32_t ordinal) {
+    ze_command_queue_desc_t cmdQueueDesc = {
+        ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+    cmdQueueDesc.ordinal = ordinal;
+    cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    ze_command_list_handle_t cmdList;
+    ZE_CHECK(
+        zeCommandListCreateImmediate(context, device, &cmdQueueDesc, &cmdList));
+    return cmdList;
+  }
+
+  void sync(ze_event_handle_t event) {
+    ZE_CHECK(zeEventHostSynchronize(event, std::numeric_limits<uint64_t>::max()));
+  }
+
+  ze_context_handle_t context;
+  uint32_t tile;
+  ze_kernel_handle_t kernel = nullptr;
+  ze_group_count_t dispatch = {1, 1, 1};
+  ze_command_list_handle_t computeList = nullptr;
+  ze_command_list_handle_t uploadList = nullptr;
+  ze_command_list_handle_t downloadList = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t uploaded[2] = {};
+  ze_event_handle_t computed[2] = {};
+  ze_event_handle_t downloaded[2] = {};
+  void *aTile[2] = {};
+  void *bTile[2] = {};
+  void *cTile[2] = {};
+};
@@ -6,3 +6,11 @@
               << "0x" << std::hex << myZeCall << std::dec << std::endl;   \
     std::terminate();                                                     \
   }
+
+#define CL_CHECK(myClCall)                                                \
+  if (cl_int clStatus = (myClCall); clStatus != CL_SUCCESS) {             \
+    std::cout << "Error at " << #myClCall << ": " << __FUNCTION__ << ": " \
+              << __LINE__ << std::endl;                                   \
+    std::cout << "Exit with Error Code: " << clStatus << std::endl;       \
+    std::terminate();                                                     \
+  }
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Run the Level Zero driver and its OpenCL port side by side and compare
+them.
+
+Both programs run the same mxm kernel on the same inputs and print the same
+metrics: Launch (host cost of the launch call), Device (kernel time from the
+device timestamps) and GPU Kernel (launch to observed completion on the host).
+Each program runs --repeat times, alternating so that clock and thermal drift
+hit both alike; the table shows the medians and the OpenCL/Level Zero ratio.
+A run that fails validation or exits non-zero is reported and left out of the
+medians.
+
+Usage: compare.py [--repeat N] [--ze PROGRAM] [--ocl PROGRAM] [--il]
+
+Run it from the build directory, next to KernelGPU.spv and KernelGPU.cl.
+--il makes the OpenCL port load KernelGPU.spv too, so both run the same
+binary instead of the OpenCL compiler's build of the source.
+"""
+
+import argparse
+import re
+import statistics
+import subprocess
+import sys
+
+METRICS = [
+    ("launch [ns]", re.compile(r"^Launch\s+= (\d+) \[ns\]$", re.MULTILINE)),
+    ("device [ns]", re.compile(r"^Device\s+= (\d+) \[ns\]$", re.MULTILINE)),
+    ("total [ns]", re.compile(r"^GPU Kernel = (\d+) \[ns\]$", re.MULTILINE)),
+]
+
+PASSED = re.compile(r"^Matrix Multiply validation PASSED$", re.MULTILINE)
+
+
+def run(command):
+    """Returns the metrics of one run, or None if it failed."""
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0 or not PASSED.search(result.stdout):
+        sys.stderr.write("%s failed (exit %d):\n%s%s" %
+                         (" ".join(command), result.returncode, result.stdout,
+                          result.stderr))
+        return None
+    values = {}
+    for name, pattern in METRICS:
+        match = pattern.search(result.stdout)
+        if match:
+            values[name] = int(match.group(1))
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--repeat", type=int, default=10)
+    parser.add_argument("--ze", default="./driver")
+    parser.add_argument("--ocl", default="./driverOCL")
+    parser.add_argument("--il", action="store_true")
+    args = parser.parse_args()
+
+    programs = [("Level Zero", [args.ze]),
+                ("OpenCL", [args.ocl] + (["--il"] if args.il else []))]
+    samples = {label: [] for label, _ in programs}
+    failures = {label: 0 for label, _ in programs}
+    for _ in range(args.repeat):
+        for label, command in programs:
+            values = run(command)
+            if values is None:
+                failures[label] += 1
+            else:
+                samples[label].append(values)
+
+    def median(label, metric):
+        values = [s[metric] for s in samples[label] if metric in s]
+        return statistics.median(values) if values else None
+
+    print("%-12s %14s %14s %8s" % ("metric", "Level Zero", "OpenCL", "ratio"))
+    for metric, _ in METRICS:
+        ze = median("Level Zero", metric)
+        ocl = median("OpenCL", metric)
+        ratio = "%7.2fx" % (ocl / ze) if ze and ocl is not None else "-"
+        print("%-12s %14s %14s %8s" %
+              (metric, "-" if ze is None else "%d" % ze,
+               "-" if ocl is None else "%d" % ocl, ratio))
+    print("%-12s %14s %14s" %
+          ("runs ok", "%d/%d" % (len(samples["Level Zero"]), args.repeat),
+           "%d/%d" % (len(samples["OpenCL"]), args.repeat)))
+    return 1 if any(failures.values()) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
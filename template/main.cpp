@@ -45,7 +45,8 @@ int main(int argc, char **argv) {
   ZE_CHECK(zeDeviceGet(driverHandle, &deviceCount, &device));
 
   // Print basic properties of the device
-  ze_device_properties_t deviceProperties = {};
+  ze_device_properties_t deviceProperties = {
+      ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
   ZE_CHECK(zeDeviceGetProperties(device, &deviceProperties));
   std::cout << "Device   : " << deviceProperties.name << "\n"
             << "Type     : "
@@ -202,11 +203,11 @@ int main(int argc, char **argv) {
   std::cout << "Group X: " << groupSizeX << std::endl;
   std::cout << "Group Y: " << groupSizeY << std::endl;
 
-  // Push arguments
+  // Push arguments in the kernel's mxm(a, b, c, n) order, as mainOCL.cpp
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 0, sizeof(sharedA), &sharedA));
+  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(sharedB), &sharedB));
   ZE_CHECK(
-      zeKernelSetArgumentValue(kernel, 0, sizeof(dstResult), &dstResult));
-  ZE_CHECK(zeKernelSetArgumentValue(kernel, 1, sizeof(sharedA), &sharedA));
-  ZE_CHECK(zeKernelSetArgumentValue(kernel, 2, sizeof(sharedB), &sharedB));
+      zeKernelSetArgumentValue(kernel, 2, sizeof(dstResult), &dstResult));
   ZE_CHECK(zeKernelSetArgumentValue(kernel, 3, sizeof(int), &items));
 
   // Kernel thread-dispatch
@@ -216,6 +217,7 @@ int main(int argc, char **argv) {
   dispatch.groupCountZ = 1;
 
   // Launch kernel on the GPU
+  auto launchBegin = std::chrono::steady_clock::now();
   ZE_CHECK(zeCommandListAppendLaunchKernel(cmdList, kernel, &dispatch,
                                                Event, 0, nullptr));
 
@@ -235,6 +237,23 @@ int main(int argc, char **argv) {
   ZE_CHECK(zeEventQueryKernelTimestamp(Event, &res));
   std::cout << "Kernel Event Query: " << res.context.kernelEnd << std::endl;
 
+  // Same metrics as mainOCL.cpp, for compare.py: host cost of the launch
+  // call and kernel time from the event timestamps
+  uint64_t timestampMask =
+      deviceProperties.kernelTimestampValidBits >= 64
+          ? ~0ull
+          : (1ull << deviceProperties.kernelTimestampValidBits) - 1;
+  uint64_t kernelTicks =
+      (res.global.kernelEnd - res.global.kernelStart) & timestampMask;
+  std::cout << "Launch   = "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   begin - launchBegin)
+                   .count()
+            << " [ns]" << std::endl;
+  std::cout << "Device   = "
+            << uint64_t(kernelTicks * deviceProperties.timerResolution)
+            << " [ns]" << std::endl;
+
   // Validate
   bool outputValidationSuccessful = true;
 
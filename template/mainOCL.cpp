@@ -0,0 +1,239 @@
+// OpenCL port of main.cpp: the same mxm kernel from KernelGPU.cl, the same
+// 1024 x 1024 inputs and CPU validation, and the same metrics, so the two
+// backends can be compared run for run (see compare.py).
+//
+// The matrices live in coarse-grained SVM the host fills in place, the
+// OpenCL counterpart of main.cpp's zeMemAllocShared buffers, and are bound in
+// the same (a, b, c, n) order. The program is built from KernelGPU.cl with
+// clCreateProgramWithSource, or with --il from the KernelGPU.spv main.cpp
+// loads. Beyond main.cpp's output it prints "Launch" (host cost of
+// clEnqueueNDRangeKernel) and "Device" (kernel time from the event's
+// profiling counters); main.cpp prints the same two lines from its command
+// list append and kernel timestamps. The clFlush that submits the kernel
+// counts towards "GPU Kernel", like the submission of main.cpp's
+// non-immediate list.
+//
+// Built programs are kept in ProgramCache's directory (CL_PROGRAM_CACHE_DIR,
+// default .clcache), so only the first run pays clBuildProgram; "Build"
+// shows the time and whether the binary came from the cache.
+//
+// Usage: ./driverOCL [--il]
+
+#define CL_TARGET_OPENCL_VERSION 300
+#include <CL/cl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "KernelGPU.hpp"
+#include "common.hpp"
+#include "ProgramCache.hpp"
+
+// First GPU of any platform, else the first device of any type
+cl_device_id findDevice() {
+  cl_uint numPlatforms = 0;
+  CL_CHECK(clGetPlatformIDs(0, nullptr, &numPlatforms));
+  std::vector<cl_platform_id> platforms(numPlatforms);
+  CL_CHECK(clGetPlatformIDs(numPlatforms, platforms.data(), nullptr));
+  for (cl_device_type type : {cl_device_type(CL_DEVICE_TYPE_GPU),
+                              cl_device_type(CL_DEVICE_TYPE_ALL)}) {
+    for (cl_platform_id platform : platforms) {
+      cl_device_id device = nullptr;
+      cl_uint numDevices = 0;
+      if (clGetDeviceIDs(platform, type, 1, &device, &numDevices) ==
+              CL_SUCCESS &&
+          numDevices > 0)
+        return device;
+    }
+  }
+  std::cout << "No OpenCL device found\n";
+  std::terminate();
+}
+
+std::vector<char> readFile(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << path << " not found\n";
+    std::terminate();
+  }
+  return std::vector<char>((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv) {
+  bool useIL = argc > 1 && !strcmp(argv[1], "--il");
+  std::cout << "Using OpenCL, program from "
+            << (useIL ? "KernelGPU.spv" : "KernelGPU.cl") << "\n";
+
+  cl_device_id device = findDevice();
+  char name[256] = {};
+  cl_device_type type = 0;
+  CL_CHECK(clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name,
+                           nullptr));
+  CL_CHECK(clGetDeviceInfo(device, CL_DEVICE_TYPE, sizeof(type), &type,
+                           nullptr));
+  std::cout << "Device   : " << name << "\n"
+            << "Type     : "
+            << ((type & CL_DEVICE_TYPE_GPU)   ? "GPU"
+                : (type & CL_DEVICE_TYPE_CPU) ? "CPU"
+                                              : "other")
+            << "\n";
+
+  cl_int err;
+  cl_context context =
+      clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
+  CL_CHECK(err);
+  cl_queue_properties queueProps[] = {CL_QUEUE_PROPERTIES,
+                                      CL_QUEUE_PROFILING_ENABLE, 0};
+  cl_command_queue queue =
+      clCreateCommandQueueWithProperties(context, device, queueProps, &err);
+  CL_CHECK(err);
+
+  // Inputs as in main.cpp, in shared virtual memory
+  cl_device_svm_capabilities svmCapabilities = 0;
+  CL_CHECK(clGetDeviceInfo(device, CL_DEVICE_SVM_CAPABILITIES,
+                           sizeof(svmCapabilities), &svmCapabilities,
+                           nullptr));
+  if (!(svmCapabilities & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER)) {
+    std::cout << "Device does not support shared virtual memory\n";
+    std::terminate();
+  }
+  const uint32_t items = 1024;
+  constexpr size_t allocSize = items * items * sizeof(int);
+  auto svmAlloc = [&] {
+    void *ptr = clSVMAlloc(context, CL_MEM_READ_WRITE, allocSize, 0);
+    if (!ptr) {
+      std::cout << "clSVMAlloc failed\n";
+      std::terminate();
+    }
+    return ptr;
+  };
+  void *sharedA = svmAlloc();
+  void *sharedB = svmAlloc();
+  void *dstResult = svmAlloc();
+
+  // memory initialization; coarse-grained SVM is host-accessible while mapped
+  auto fill = [&](void *ptr, int value) {
+    CL_CHECK(clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                             ptr, allocSize, 0, nullptr, nullptr));
+    memset(ptr, value, allocSize);
+    CL_CHECK(clEnqueueSVMUnmap(queue, ptr, 0, nullptr, nullptr));
+  };
+  fill(sharedA, 2);
+  fill(sharedB, 3);
+  fill(dstResult, 0);
+  CL_CHECK(clFinish(queue));
+
+  // Program Initialization, from the binary cache when possible
+  ProgramCache programCache;
+  bool cacheHit = false;
+  auto buildBegin = std::chrono::steady_clock::now();
+  cl_program program =
+      programCache.build(context, device,
+                         readFile(useIL ? "KernelGPU.spv" : "KernelGPU.cl"),
+                         useIL, "", &cacheHit);
+  auto buildEnd = std::chrono::steady_clock::now();
+  std::cout << "Build    = "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   buildEnd - buildBegin)
+                   .count()
+            << " [ns] (" << (cacheHit ? "cached" : "built") << ")"
+            << std::endl;
+
+  cl_kernel kernel = clCreateKernel(program, "mxm", &err);
+  CL_CHECK(err);
+  int n = items;
+  CL_CHECK(clSetKernelArgSVMPointer(kernel, 0, sharedA));
+  CL_CHECK(clSetKernelArgSVMPointer(kernel, 1, sharedB));
+  CL_CHECK(clSetKernelArgSVMPointer(kernel, 2, dstResult));
+  CL_CHECK(clSetKernelArg(kernel, 3, sizeof(int), &n));
+
+  // Let the runtime pick the work-group size, as zeKernelSuggestGroupSize
+  // does for main.cpp
+  size_t globalSize[2] = {items, items};
+  cl_event event;
+  auto launchBegin = std::chrono::steady_clock::now();
+  CL_CHECK(clEnqueueNDRangeKernel(queue, kernel, 2, nullptr, globalSize,
+                                  nullptr, 0, nullptr, &event));
+
+  auto begin = std::chrono::steady_clock::now();
+  CL_CHECK(clFlush(queue));
+  CL_CHECK(clWaitForEvents(1, &event));
+  auto end = std::chrono::steady_clock::now();
+
+  cl_ulong kernelStart = 0;
+  cl_ulong kernelEnd = 0;
+  CL_CHECK(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                                   sizeof(kernelStart), &kernelStart,
+                                   nullptr));
+  CL_CHECK(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                                   sizeof(kernelEnd), &kernelEnd, nullptr));
+  std::cout << "Launch   = "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   begin - launchBegin)
+                   .count()
+            << " [ns]" << std::endl;
+  std::cout << "Device   = " << (kernelEnd - kernelStart) << " [ns]"
+            << std::endl;
+
+  for (void *ptr : {sharedA, sharedB, dstResult})
+    CL_CHECK(clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_READ, ptr, allocSize, 0,
+                             nullptr, nullptr));
+
+  // Validate
+  bool outputValidationSuccessful = true;
+
+  std::vector<uint32_t> resultSeq(items * items);
+  uint32_t *dstInt = static_cast<uint32_t *>(dstResult);
+  uint32_t *srcA = static_cast<uint32_t *>(sharedA);
+  uint32_t *srcB = static_cast<uint32_t *>(sharedB);
+
+  std::chrono::steady_clock::time_point beginSeq =
+      std::chrono::steady_clock::now();
+  KernelCPU(srcA, srcB, resultSeq.data(), items);
+  std::chrono::steady_clock::time_point endSeq =
+      std::chrono::steady_clock::now();
+
+  auto elapsedParallel =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+  auto elapsedSequential =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(endSeq - beginSeq)
+          .count();
+  std::cout << "GPU Kernel = " << elapsedParallel << " [ns]" << std::endl;
+  std::cout << "SEQ Kernel = " << elapsedSequential << " [ns]" << std::endl;
+  auto speedup = elapsedSequential / std::max<decltype(elapsedParallel)>(
+                                         elapsedParallel, 1);
+  std::cout << "Speedup = " << speedup << "x" << std::endl;
+
+  for (int i = 0; i < n && outputValidationSuccessful; i++) {
+    for (int j = 0; j < n; j++) {
+      if (resultSeq[i * n + j] != dstInt[i * n + j]) {
+        outputValidationSuccessful = false;
+        break;
+      }
+    }
+  }
+
+  std::cout << "\nMatrix Multiply validation "
+            << (outputValidationSuccessful ? "PASSED" : "FAILED") << "\n";
+
+  // Cleanup
+  for (void *ptr : {sharedA, sharedB, dstResult})
+    CL_CHECK(clEnqueueSVMUnmap(queue, ptr, 0, nullptr, nullptr));
+  CL_CHECK(clFinish(queue));
+  CL_CHECK(clReleaseEvent(event));
+  CL_CHECK(clReleaseKernel(kernel));
+  CL_CHECK(clReleaseProgram(program));
+  clSVMFree(context, dstResult);
+  clSVMFree(context, sharedB);
+  clSVMFree(context, sharedA);
+  CL_CHECK(clReleaseCommandQueue(queue));
+  CL_CHECK(clReleaseContext(context));
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Out-of-core mxm: n x n matrices that need not fit in device memory are
+// multiplied through a fixed working set of tiles (see TiledGemm.hpp). The
+// product is computed twice, with tile uploads overlapping compute and fully
+// serialized, and a sample of C entries is checked against the CPU.
+//
+// Usage: ./outOfCore [n=8192] [tile=1024]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "common.hpp"
+#include "TiledGemm.hpp"
+#include "ze_api.h"
+
+// A and B entries stay small so sampled sums cannot overflow
+int valueA(size_t row, size_t col) { return int((row + col) % 5); }
+int valueB(size_t row, size_t col) { return int((3 * row + col) % 7); }
+
+int main(int argc, char **argv) {
+  // Parsed signed, so a negative value is rejected instead of wrapping; the
+  // kernels take the sizes as int
+  long nArg = argc > 1 ? std::atol(argv[1]) : 8192;
+  long tileArg = argc > 2 ? std::atol(argv[2]) : 1024;
+  if (nArg < 1 || tileArg < 1 || nArg > std::numeric_limits<int>::max() ||
+      tileArg > std::numeric_limits<int>::max()) {
+    std::cout << "Usage: " << argv[0] << " [n=8192] [tile=1024], both > 0\n";
+    return 1;
+  }
+  uint32_t n = uint32_t(nArg);
+  uint32_t tile = uint32_t(tileArg);
+  if (n % tile != 0) {
+    std::cout << "n (" << n << ") must be a multiple of the tile size ("
+              << tile << ")\n";
+    return 1;
+  }
+
+  // Initialization
+  ZE_CHECK(zeInit(ZE_INIT_FLAG_GPU_ONLY));
+  uint32_t driverCount = 1;
+  ze_driver_handle_t driverHandle;
+  ZE_CHECK(zeDriverGet(&driverCount, &driverHandle));
+  ze_context_desc_t contextDescription = {};
+  contextDescription.stype = ZE_STRUCTURE_TYPE_CONTEXT_DESC;
+  ze_context_handle_t context;
+  ZE_CHECK(zeContextCreate(driverHandle, &contextDescription, &context));
+  uint32_t deviceCount = 1;
+  ze_device_handle_t device;
+  ZE_CHECK(zeDeviceGet(driverHandle, &deviceCount, &device));
+
+  ze_device_properties_t deviceProperties = {
+      ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
+  ZE_CHECK(zeDeviceGetProperties(device, &deviceProperties));
+  uint32_t memoryCount = 0;
+  ZE_CHECK(zeDeviceGetMemoryProperties(device, &memoryCount, nullptr));
+  std::vector<ze_device_memory_properties_t> memoryProperties(memoryCount);
+  for (auto &props : memoryProperties)
+    props.stype = ZE_STRUCTURE_TYPE_DEVICE_MEMORY_PROPERTIES;
+  ZE_CHECK(zeDeviceGetMemoryProperties(device, &memoryCount,
+                                       memoryProperties.data()));
+  uint64_t deviceMemory = 0;
+  for (auto &props : memoryProperties)
+    deviceMemory += props.totalSize;
+
+  size_t matrixBytes = size_t(n) * n * sizeof(int);
+  std::cout << "Device   : " << deviceProperties.name << "\n"
+            << "Memory   : " << (deviceMemory >> 20) << " MB\n"
+            << "Matrices : 3 x " << (matrixBytes >> 20) << " MB (n = " << n
+            << ")\n";
+
+  // Module Initialization
+  std::ifstream file("KernelGPU.spv", std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "binary file not found\n";
+    std::terminate();
+  }
+  std::vector<char> spirv((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  ze_module_desc_t moduleDesc = {ZE_STRUCTURE_TYPE_MODULE_DESC};
+  moduleDesc.format = ZE_MODULE_FORMAT_IL_SPIRV;
+  moduleDesc.pInputModule = reinterpret_cast<const uint8_t *>(spirv.data());
+  moduleDesc.inputSize = spirv.size();
+  moduleDesc.pBuildFlags = "";
+  ze_module_handle_t module = nullptr;
+  ZE_CHECK(zeModuleCreate(context, device, &moduleDesc, &module, nullptr));
+
+  TiledGemm gemm(context, device, module, tile);
+  std::cout << "Tiles    : " << tile << " x " << tile << ", working set "
+            << (gemm.workingSetBytes() >> 20) << " MB\n";
+
+  // Pinned host matrices so tile copies run at copy-engine speed
+  ze_host_mem_alloc_desc_t hostDesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
+  void *hostA = nullptr;
+  void *hostB = nullptr;
+  void *hostC = nullptr;
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, matrixBytes, 4096, &hostA));
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, matrixBytes, 4096, &hostB));
+  ZE_CHECK(zeMemAllocHost(context, &hostDesc, matrixBytes, 4096, &hostC));
+  int *a = static_cast<int *>(hostA);
+  int *b = static_cast<int *>(hostB);
+  int *c = static_cast<int *>(hostC);
+  for (size_t row = 0; row < n; row++)
+    for (size_t col = 0; col < n; col++) {
+      a[row * n + col] = valueA(row, col);
+      b[row * n + col] = valueB(row, col);
+    }
+
+  bool outputValidationSuccessful = true;
+  for (bool overlap : {true, false}) {
+    memset(c, 0, matrixBytes);
+    auto begin = std::chrono::steady_clock::now();
+    gemm.multiply(c, a, b, n, overlap);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << (overlap ? "Overlapped" : "Serialized") << " = "
+              << seconds * 1e3 << " [ms], "
+              << 2.0 * n * n * n / seconds / 1e9 << " GOP/s" << std::endl;
+
+    // Full CPU reference is O(n^3); check a random sample of entries
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> index(0, n - 1);
+    for (int sample = 0; sample < 256; sample++) {
+      uint32_t i = index(rng);
+      uint32_t j = index(rng);
+      int sum = 0;
+      for (uint32_t k = 0; k < n; k++)
+        sum += a[size_t(i) * n + k] * b[size_t(k) * n + j];
+      if (c[size_t(i) * n + j] != sum) {
+        outputValidationSuccessful = false;
+        break;
+      }
+    }
+  }
+
+  std::cout << "\nMatrix Multiply validation "
+            << (outputValidationSuccessful ? "PASSED" : "FAILED") << "\n";
+
+  // Cleanup
+  gemm.release();
+  ZE_CHECK(zeMemFree(context, hostA));
+  ZE_CHECK(zeMemFree(context, hostB));
+  ZE_CHECK(zeMemFree(context, hostC));
+  ZE_CHECK(zeModuleDestroy(module));
+  ZE_CHECK(zeContextDestroy(context));
+
+  return outputValidationSuccessful ? 0 : 1;
+}
@@ -0,0 +1 @@
+__kernel void emptyKernel() {}
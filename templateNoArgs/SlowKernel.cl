@@ -1,13 +1,14 @@
-__kernel void myKernel() {
+// Spins for `loops` dependent iterations. OpenCL C has no portable device
+// clock, so the host converts a target duration into a loop count calibrated
+// against kernel timestamps at startup (see spin.hpp). The result is written
+// to `sink` so the loop cannot be optimized away.
+__kernel void spinKernel(ulong loops, __global float *sink) {
     float val = 0.0f;
-    for (int i = 0; i < 10000; i++) {
-        for (int j = 0; j < 10000; j++) {
-            val += sqrt(val + i + j);
-        }
+    for (ulong i = 0; i < loops; i++) {
+        val = sqrt(val + (float)i);
     }
 
-//     if (get_global_id(0) == 0 && get_local_id(0) == 0) {
-//         printf("complete\n");
-//     }
-
-}
\ No newline at end of file
+    if (get_global_id(0) == 0) {
+        sink[0] = val;
+    }
+}
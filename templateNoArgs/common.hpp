@@ -9,6 +9,7 @@ ze_command_list_handle_t cmdList;
 ze_module_build_log_handle_t buildLog;
 ze_module_handle_t module = nullptr;
 ze_kernel_handle_t kernel = nullptr;
+uint32_t computeOrdinal = 0;
 
 std::string resultToString(ze_result_t Status) {
   switch (Status) {
@@ -159,6 +160,8 @@ void setupLevelZero() {
     }
   }
 
+  computeOrdinal = cmdQueueDesc.ordinal;
+
   cmdQueueDesc.index = 0;
   cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
   ZE_CHECK(zeCommandQueueCreate(context, device, &cmdQueueDesc, &cmdQueue));
@@ -192,7 +195,7 @@ void execCmdList(ze_command_list_handle_t cmdList) {
 
 void compileKernel(std::string kernelFile, std::string kernelName) {
   // Module Initialization
-  std::ifstream file("SlowKernel.spv", std::ios::binary);
+  std::ifstream file(kernelFile, std::ios::binary);
   if (!file.is_open()) {
     std::cout << "binary file not found\n";
     std::terminate();
@@ -228,7 +231,7 @@ void compileKernel(std::string kernelFile, std::string kernelName) {
   ZE_CHECK(zeModuleBuildLogDestroy(buildLog));
 
   ze_kernel_desc_t kernelDesc = {};
-  kernelDesc.pKernelName = "myKernel";
+  kernelDesc.pKernelName = kernelName.c_str();
   ZE_CHECK(zeKernelCreate(module, &kernelDesc, &kernel));
 }
 
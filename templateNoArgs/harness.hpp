@@ -0,0 +1,128 @@
+// Multi-threaded submission harness on top of common.hpp.
+//
+// The driver, context, device and module stay the process-wide globals set up
+// by setupLevelZero()/compileKernel(). Every host thread that calls local()
+// gets its own command queue, command list, kernel clone and completion event,
+// so appends and argument updates never race on a shared handle.
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ze_api.h"
+
+struct ThreadSlot {
+  ze_command_queue_handle_t cmdQueue = nullptr;
+  ze_command_list_handle_t cmdList = nullptr;
+  ze_kernel_handle_t kernel = nullptr;
+  ze_event_pool_handle_t eventPool = nullptr;
+  ze_event_handle_t event = nullptr;
+};
+
+class Harness {
+public:
+  Harness(ze_module_handle_t module, std::string kernelName, bool immediate)
+      : module(module), kernelName(kernelName), immediate(immediate) {
+    uint32_t numQueueGroups = 0;
+    ZE_CHECK(zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups,
+                                                    nullptr));
+    std::vector<ze_command_queue_group_properties_t> queueProperties(
+        numQueueGroups);
+    ZE_CHECK(zeDeviceGetCommandQueueGroupProperties(device, &numQueueGroups,
+                                                    queueProperties.data()));
+    numQueues = queueProperties[computeOrdinal].numQueues;
+  }
+
+  ~Harness() {
+    for (auto &entry : slots) {
+      ThreadSlot &slot = *entry.second;
+      ZE_CHECK(zeEventDestroy(slot.event));
+      ZE_CHECK(zeEventPoolDestroy(slot.eventPool));
+      ZE_CHECK(zeKernelDestroy(slot.kernel));
+      ZE_CHECK(zeCommandListDestroy(slot.cmdList));
+      ZE_CHECK(zeCommandQueueDestroy(slot.cmdQueue));
+    }
+  }
+
+  bool isImmediate() const { return immediate; }
+
+  // Returns the calling thread's slot, creating it on first use. The lock only
+  // covers the lookup; the returned slot is owned by the caller's thread.
+  ThreadSlot &local() {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &slot = slots[std::this_thread::get_id()];
+    if (!slot) {
+      slot.reset(new ThreadSlot);
+      createSlot(*slot, nextQueueIndex++ % numQueues);
+    }
+    return *slot;
+  }
+
+  void launch(ThreadSlot &slot, const ze_group_count_t &dispatch) {
+    ZE_CHECK(zeCommandListAppendLaunchKernel(slot.cmdList, slot.kernel,
+                                             &dispatch, nullptr, 0, nullptr));
+  }
+
+  // Submit whatever was appended since the last flush and wait for it.
+  void flush(ThreadSlot &slot) {
+    if (immediate) {
+      ZE_CHECK(zeCommandListAppendBarrier(slot.cmdList, slot.event, 0, nullptr));
+      ZE_CHECK(zeEventHostSynchronize(slot.event,
+                                      std::numeric_limits<uint64_t>::max()));
+      ZE_CHECK(zeEventHostReset(slot.event));
+    } else {
+      ZE_CHECK(zeCommandListClose(slot.cmdList));
+      ZE_CHECK(zeCommandQueueExecuteCommandLists(slot.cmdQueue, 1,
+                                                 &slot.cmdList, nullptr));
+      ZE_CHECK(zeCommandQueueSynchronize(slot.cmdQueue,
+                                         std::numeric_limits<uint64_t>::max()));
+      ZE_CHECK(zeCommandListReset(slot.cmdList));
+    }
+  }
+
+private:
+  void createSlot(ThreadSlot &slot, uint32_t queueIndex) {
+    ze_command_queue_desc_t cmdQueueDesc = {
+        ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+    cmdQueueDesc.ordinal = computeOrdinal;
+    cmdQueueDesc.index = queueIndex;
+    cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    ZE_CHECK(
+        zeCommandQueueCreate(context, device, &cmdQueueDesc, &slot.cmdQueue));
+
+    if (immediate) {
+      ZE_CHECK(zeCommandListCreateImmediate(context, device, &cmdQueueDesc,
+                                            &slot.cmdList));
+    } else {
+      ze_command_list_desc_t cmdListDesc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC};
+      cmdListDesc.commandQueueGroupOrdinal = computeOrdinal;
+      ZE_CHECK(
+          zeCommandListCreate(context, device, &cmdListDesc, &slot.cmdList));
+    }
+
+    ze_kernel_desc_t kernelDesc = {ZE_STRUCTURE_TYPE_KERNEL_DESC};
+    kernelDesc.pKernelName = kernelName.c_str();
+    ZE_CHECK(zeKernelCreate(module, &kernelDesc, &slot.kernel));
+
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr,
+                                          ZE_EVENT_POOL_FLAG_HOST_VISIBLE, 1};
+    ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr,
+                               &slot.eventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                                 ZE_EVENT_SCOPE_FLAG_HOST,
+                                 ZE_EVENT_SCOPE_FLAG_HOST};
+    ZE_CHECK(zeEventCreate(slot.eventPool, &eventDesc, &slot.event));
+  }
+
+  ze_module_handle_t module;
+  std::string kernelName;
+  bool immediate;
+  uint32_t numQueues = 1;
+  uint32_t nextQueueIndex = 0;
+  std::mutex mutex;
+  std::map<std::thread::id, std::unique_ptr<ThreadSlot>> slots;
+};
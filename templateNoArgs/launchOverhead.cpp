@@ -0,0 +1,204 @@
+// Kernel launch overhead microbenchmarks.
+//
+// Launches the argument-free emptyKernel and separates the costs of
+//   - a single launch round trip (append, submit, wait)
+//   - back-to-back launches amortized over a batch
+//   - adding a signal event, a wait event or a timestamp event to each launch
+// on both immediate and regular command lists. All numbers are host wall-clock
+// microseconds summarized as percentile tables.
+//
+// Usage: ./launchOverhead [iterations=1000] [batch=100]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "harness.hpp"
+#include "stats.hpp"
+#include "ze_api.h"
+
+enum class Variant { Plain, SignalEvent, WaitEvent, Timestamp };
+
+const char *variantName(Variant variant) {
+  switch (variant) {
+  case Variant::Plain:
+    return "plain";
+  case Variant::SignalEvent:
+    return "+signal event";
+  case Variant::WaitEvent:
+    return "+wait event";
+  case Variant::Timestamp:
+    return "+timestamp event";
+  }
+  return "";
+}
+
+// One pool per variant: host-visible events for signal/wait, and a pool with
+// ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP for the timestamp case.
+struct EventSet {
+  ze_event_pool_handle_t pool = nullptr;
+  std::vector<ze_event_handle_t> events;
+
+  EventSet(uint32_t count, bool timestamps) {
+    ze_event_pool_flags_t flags = ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+    if (timestamps)
+      flags |= ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP;
+    ze_event_pool_desc_t eventPoolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                          nullptr, flags, count};
+    ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &pool));
+    events.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, i,
+                                   ZE_EVENT_SCOPE_FLAG_HOST,
+                                   ZE_EVENT_SCOPE_FLAG_HOST};
+      ZE_CHECK(zeEventCreate(pool, &eventDesc, &events[i]));
+    }
+  }
+
+  ~EventSet() {
+    for (auto event : events)
+      ZE_CHECK(zeEventDestroy(event));
+    ZE_CHECK(zeEventPoolDestroy(pool));
+  }
+
+  void reset() {
+    for (auto event : events)
+      ZE_CHECK(zeEventHostReset(event));
+  }
+};
+
+class LaunchBench {
+public:
+  LaunchBench(Harness &harness, uint32_t batch)
+      : harness(harness), slot(harness.local()), signalEvents(batch, false),
+        timestampEvents(batch, true), waitEvents(1, false) {
+    // The wait event is signaled once up front so waiting on it never blocks;
+    // what remains is the cost of carrying the dependency.
+    ZE_CHECK(zeEventHostSignal(waitEvents.events[0]));
+  }
+
+  // Append, submit and wait for `count` launches. Returns elapsed microseconds.
+  double run(Variant variant, uint32_t count) {
+    ze_group_count_t dispatch = {1, 1, 1};
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++) {
+      ze_event_handle_t signal = nullptr;
+      uint32_t numWait = 0;
+      ze_event_handle_t *wait = nullptr;
+      switch (variant) {
+      case Variant::Plain:
+        break;
+      case Variant::SignalEvent:
+        signal = signalEvents.events[i];
+        break;
+      case Variant::WaitEvent:
+        numWait = 1;
+        wait = &waitEvents.events[0];
+        break;
+      case Variant::Timestamp:
+        signal = timestampEvents.events[i];
+        break;
+      }
+      ZE_CHECK(zeCommandListAppendLaunchKernel(slot.cmdList, slot.kernel,
+                                               &dispatch, signal, numWait,
+                                               wait));
+    }
+    harness.flush(slot);
+    auto end = std::chrono::steady_clock::now();
+
+    // Event resets are bookkeeping, not launch overhead
+    if (variant == Variant::SignalEvent)
+      signalEvents.reset();
+    if (variant == Variant::Timestamp)
+      timestampEvents.reset();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+  }
+
+private:
+  Harness &harness;
+  ThreadSlot &slot;
+  EventSet signalEvents;
+  EventSet timestampEvents;
+  EventSet waitEvents;
+};
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+  int batchArg = argc > 2 ? std::atoi(argv[2]) : 100;
+  // batch divides the amortized times and both size the percentile samples
+  if (iterations < 1 || batchArg < 1) {
+    std::cout << "Usage: " << argv[0] << " [iterations=1000] [batch=100]\n";
+    return 1;
+  }
+  uint32_t batch = batchArg;
+
+  setupLevelZero();
+  compileKernel("EmptyKernel.spv", "emptyKernel");
+
+  const Variant variants[] = {Variant::Plain, Variant::SignalEvent,
+                              Variant::WaitEvent, Variant::Timestamp};
+
+  struct Row {
+    std::string name;
+    Percentiles latency;
+    Percentiles amortized;
+  };
+  std::vector<Row> rows;
+
+  for (bool immediate : {true, false}) {
+    Harness harness(module, "emptyKernel", immediate);
+    LaunchBench bench(harness, batch);
+    for (Variant variant : variants) {
+      // warm up caches, residency and the submission path
+      bench.run(variant, batch);
+
+      std::vector<double> latency, amortized;
+      for (int i = 0; i < iterations; i++)
+        latency.push_back(bench.run(variant, 1));
+      for (int i = 0; i < iterations / (int)batch + 1; i++)
+        amortized.push_back(bench.run(variant, batch) / batch);
+
+      rows.push_back({std::string(immediate ? "imm " : "reg ") +
+                          variantName(variant),
+                      summarize(latency), summarize(amortized)});
+    }
+  }
+
+  std::cout << "\nIterations: " << iterations << ", batch: " << batch << "\n";
+  printPercentileHeader("Single launch round trip (append + submit + wait)",
+                        "us");
+  for (auto &row : rows)
+    printPercentileRow(row.name, row.latency);
+  printPercentileHeader("Back-to-back launches, per launch amortized over batch",
+                        "us");
+  for (auto &row : rows)
+    printPercentileRow(row.name, row.amortized);
+
+  // Cost of each add-on relative to the plain launch on the same list type
+  std::cout << "\nAdded cost over plain launch (p50) [us]\n";
+  std::cout << std::left << std::setw(28) << "case" << std::right
+            << std::setw(12) << "round trip" << std::setw(12) << "amortized"
+            << std::endl;
+  size_t perList = sizeof(variants) / sizeof(variants[0]);
+  for (size_t i = 0; i < rows.size(); i++) {
+    const Row &plain = rows[i - i % perList];
+    if (&plain == &rows[i])
+      continue;
+    std::cout << std::left << std::setw(28) << rows[i].name << std::right
+              << std::setw(12) << rows[i].latency.p50 - plain.latency.p50
+              << std::setw(12) << rows[i].amortized.p50 - plain.amortized.p50
+              << std::endl;
+  }
+
+  ZE_CHECK(zeKernelDestroy(kernel));
+  ZE_CHECK(zeModuleDestroy(module));
+  cleanupLevelZero();
+  return 0;
+}
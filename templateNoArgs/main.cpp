@@ -3,6 +3,7 @@
 //      https://github.com/intel/compute-runtime/blob/master/level_zero/core/test/black_box_tests/zello_world_gpu.cpp
 
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -13,11 +14,19 @@
 
 // #define IMMEDIATE
 #include "common.hpp"
+#include "spin.hpp"
 #include "ze_api.h"
 
 int main(int argc, char **argv) {
+  // Requested kernel duration in microseconds
+  double targetUs = argc > 1 ? std::atof(argv[1]) : 1000000.0;
+
   setupLevelZero();
-  compileKernel("SlowKernel.spv", "myKernel");
+  compileKernel("SlowKernel.spv", "spinKernel");
+  SpinKernel spin = createSpinKernel(kernel);
+  uint64_t loops = setSpinDuration(spin, targetUs);
+  std::cout << "Target kernel duration: " << targetUs << " us (" << loops
+            << " loops)" << std::endl;
 
   ze_event_pool_handle_t EventPool_;
   unsigned int PoolFlags =
@@ -154,6 +163,8 @@ int main(int argc, char **argv) {
   std::cout << "zeEventQueryKernelTimestamp Global: "
             << timestampToMsKernel(res.global.kernelStart, res.global.kernelEnd)
             << " ms" << std::endl;
+  std::cout << "Requested kernel duration: " << targetUs / 1000.0 << " ms"
+            << std::endl;
 
   ze_device_properties_t devProperties = {ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES};
   zeDeviceGetProperties(device, &devProperties);
@@ -168,6 +179,7 @@ int main(int argc, char **argv) {
   //             << timestampToMs(startTimeHost, endTimeHost) << " ms" <<
   //             std::endl;
 
+  destroySpinKernel(spin);
   cleanupLevelZero();
   return 0;
 }
\ No newline at end of file
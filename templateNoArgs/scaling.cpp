@@ -0,0 +1,101 @@
+// Multi-threaded submission scaling benchmark.
+//
+// Every thread launches emptyKernel through its own command list and kernel
+// clone (see harness.hpp) over one shared context. Reports aggregate launches
+// per second for 1, 2, 4, ... maxThreads threads on immediate and regular lists.
+//
+// Usage: ./scaling [launchesPerThread=1000] [maxThreads=64] [batch=100]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "harness.hpp"
+#include "ze_api.h"
+
+double launchesPerSecond(Harness &harness, int numThreads,
+                         int launchesPerThread, int batch) {
+  ze_group_count_t dispatch = {1, 1, 1};
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&]() {
+      // Create the per-thread objects and warm up outside the timed region
+      ThreadSlot &slot = harness.local();
+      harness.launch(slot, dispatch);
+      harness.flush(slot);
+
+      ready++;
+      while (!go.load())
+        std::this_thread::yield();
+
+      for (int i = 0; i < launchesPerThread; i++) {
+        harness.launch(slot, dispatch);
+        if ((i + 1) % batch == 0 || i + 1 == launchesPerThread)
+          harness.flush(slot);
+      }
+    });
+  }
+
+  while (ready.load() != numThreads)
+    std::this_thread::yield();
+  auto start = std::chrono::steady_clock::now();
+  go.store(true);
+  for (auto &thread : threads)
+    thread.join();
+  auto end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return numThreads * launchesPerThread / seconds;
+}
+
+int main(int argc, char **argv) {
+  int launchesPerThread = argc > 1 ? std::atoi(argv[1]) : 1000;
+  int maxThreads = argc > 2 ? std::atoi(argv[2]) : 64;
+  int batch = argc > 3 ? std::atoi(argv[3]) : 100;
+  if (launchesPerThread < 1 || maxThreads < 1 || batch < 1) {
+    std::cout << "Usage: " << argv[0]
+              << " [launchesPerThread=1000] [maxThreads=64] [batch=100]\n";
+    return 1;
+  }
+
+  setupLevelZero();
+  compileKernel("EmptyKernel.spv", "emptyKernel");
+
+  std::cout << "Launches per thread: " << launchesPerThread
+            << ", flush every " << batch << " launches\n\n";
+  std::cout << std::setw(8) << "threads" << std::setw(20) << "immediate [l/s]"
+            << std::setw(20) << "regular [l/s]" << std::endl;
+
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    // Fresh harness per row so every thread count starts from new lists
+    double imm, reg;
+    {
+      Harness harness(module, "emptyKernel", true);
+      imm = launchesPerSecond(harness, numThreads, launchesPerThread, batch);
+    }
+    {
+      Harness harness(module, "emptyKernel", false);
+      reg = launchesPerSecond(harness, numThreads, launchesPerThread, batch);
+    }
+    std::cout << std::setw(8) << numThreads << std::setw(20) << std::fixed
+              << std::setprecision(0) << imm << std::setw(20) << reg
+              << std::endl;
+  }
+
+  ZE_CHECK(zeKernelDestroy(kernel));
+  ZE_CHECK(zeModuleDestroy(module));
+  cleanupLevelZero();
+  return 0;
+}
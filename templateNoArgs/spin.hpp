@@ -0,0 +1,114 @@
+// Calibrated-duration spin kernel.
+//
+// spinKernel runs a fixed number of dependent sqrt iterations. At startup we
+// time it with kernel timestamps (converted via timerResolution) at two loop
+// counts and fit duration = floorUs + loops / loopsPerUs. setSpinDuration()
+// then inverts the fit, so callers ask for microseconds instead of loops.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ze_api.h"
+
+struct SpinKernel {
+  ze_kernel_handle_t kernel = nullptr;
+  void *sink = nullptr;
+  double loopsPerUs = 0;
+  double floorUs = 0;   // duration of a zero-iteration launch
+  uint64_t loops = 0;   // currently programmed loop count
+};
+
+void setSpinLoops(SpinKernel &spin, uint64_t loops) {
+  spin.loops = loops;
+  ZE_CHECK(zeKernelSetArgumentValue(spin.kernel, 0, sizeof(loops), &loops));
+}
+
+// Device-side duration of one launch with the given loop count, in us
+double measureSpinUs(SpinKernel &spin, uint64_t loops) {
+  ze_command_queue_desc_t cmdQueueDesc = {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+  cmdQueueDesc.ordinal = computeOrdinal;
+  cmdQueueDesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+  ze_command_list_handle_t immList;
+  ZE_CHECK(
+      zeCommandListCreateImmediate(context, device, &cmdQueueDesc, &immList));
+
+  ze_event_pool_desc_t eventPoolDesc = {
+      ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr,
+      ZE_EVENT_POOL_FLAG_HOST_VISIBLE | ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP, 1};
+  ze_event_pool_handle_t eventPool;
+  ZE_CHECK(zeEventPoolCreate(context, &eventPoolDesc, 0, nullptr, &eventPool));
+  ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0,
+                               ZE_EVENT_SCOPE_FLAG_HOST,
+                               ZE_EVENT_SCOPE_FLAG_HOST};
+  ze_event_handle_t event;
+  ZE_CHECK(zeEventCreate(eventPool, &eventDesc, &event));
+
+  setSpinLoops(spin, loops);
+  ze_group_count_t dispatch = {1, 1, 1};
+  ZE_CHECK(zeCommandListAppendLaunchKernel(immList, spin.kernel, &dispatch,
+                                           event, 0, nullptr));
+  ZE_CHECK(zeEventHostSynchronize(event, std::numeric_limits<uint64_t>::max()));
+
+  ze_kernel_timestamp_result_t res{};
+  ZE_CHECK(zeEventQueryKernelTimestamp(event, &res));
+
+  ZE_CHECK(zeEventDestroy(event));
+  ZE_CHECK(zeEventPoolDestroy(eventPool));
+  ZE_CHECK(zeCommandListDestroy(immList));
+  return timestampToMsKernel(res.global.kernelStart, res.global.kernelEnd) *
+         1000.0;
+}
+
+// Calibrate a spinKernel handle (e.g. from compileKernel) on the current
+// device. `calibrationUs` is the length of the longer calibration run; longer
+// runs give a better fit at the cost of startup time.
+SpinKernel createSpinKernel(ze_kernel_handle_t kernel,
+                            double calibrationUs = 20000) {
+  SpinKernel spin;
+  spin.kernel = kernel;
+  ZE_CHECK(zeKernelSetGroupSize(spin.kernel, 1, 1, 1));
+
+  ze_device_mem_alloc_desc_t deviceMemDesc = {
+      ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+  ZE_CHECK(zeMemAllocDevice(context, &deviceMemDesc, sizeof(float),
+                            sizeof(float), device, &spin.sink));
+  ZE_CHECK(zeKernelSetArgumentValue(spin.kernel, 1, sizeof(spin.sink),
+                                    &spin.sink));
+
+  // First launch pays for residency and JIT, keep it out of the fit
+  measureSpinUs(spin, 0);
+
+  // Grow the loop count until one run takes at least calibrationUs
+  uint64_t small = 1024;
+  double smallUs = measureSpinUs(spin, small);
+  uint64_t large = small;
+  double largeUs = smallUs;
+  while (largeUs < calibrationUs && large < (1ull << 40)) {
+    large *= 2;
+    largeUs = measureSpinUs(spin, large);
+  }
+
+  double slopeUs = largeUs - smallUs;
+  spin.loopsPerUs = slopeUs > 0 ? (large - small) / slopeUs
+                                : large / std::max(largeUs, 1e-3);
+  spin.floorUs = std::max(0.0, smallUs - small / spin.loopsPerUs);
+
+  std::cout << "spinKernel calibration: " << spin.loopsPerUs
+            << " loops/us, launch floor " << spin.floorUs << " us"
+            << std::endl;
+  return spin;
+}
+
+// Program the kernel to run for roughly `us` microseconds on the device.
+// Durations below the launch floor clamp to zero loops.
+uint64_t setSpinDuration(SpinKernel &spin, double us) {
+  double loops = std::max(0.0, (us - spin.floorUs) * spin.loopsPerUs);
+  setSpinLoops(spin, static_cast<uint64_t>(std::llround(loops)));
+  return spin.loops;
+}
+
+// The kernel handle stays with the caller, only the sink is released
+void destroySpinKernel(SpinKernel &spin) {
+  ZE_CHECK(zeMemFree(context, spin.sink));
+}
@@ -0,0 +1,53 @@
+// Percentile summaries for benchmark samples.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+struct Percentiles {
+  double min = 0, p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0, mean = 0;
+};
+
+// Nearest-rank percentile on a sorted sample set
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+Percentiles summarize(std::vector<double> samples) {
+  Percentiles result;
+  if (samples.empty())
+    return result;
+  std::sort(samples.begin(), samples.end());
+  result.min = samples.front();
+  result.max = samples.back();
+  result.p50 = percentile(samples, 50);
+  result.p90 = percentile(samples, 90);
+  result.p99 = percentile(samples, 99);
+  result.p999 = percentile(samples, 99.9);
+  result.mean =
+      std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+  return result;
+}
+
+void printPercentileHeader(const std::string &title, const std::string &unit) {
+  std::cout << "\n" << title << " [" << unit << "]\n";
+  std::cout << std::left << std::setw(28) << "case" << std::right
+            << std::setw(10) << "min" << std::setw(10) << "p50"
+            << std::setw(10) << "p90" << std::setw(10) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(10) << "max"
+            << std::setw(10) << "mean" << std::endl;
+}
+
+void printPercentileRow(const std::string &name, const Percentiles &p) {
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << p.min << std::setw(10)
+            << p.p50 << std::setw(10) << p.p90 << std::setw(10) << p.p99
+            << std::setw(10) << p.p999 << std::setw(10) << p.max
+            << std::setw(10) << p.mean << std::endl;
+}